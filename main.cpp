@@ -25,8 +25,13 @@
 #include <QQuickView>
 #include <QtWebEngine>
 #include <QWebEngineUrlScheme>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 #include <iostream>
 #include <cstdio>
+#include <functional>
+#include <vector>
 
 // to be able to use dc_msg_t* and dc_jsonrpc_instance_t* in QML and in
 // signals/slots; for that, a call to qRegisterMetaType is necessary as
@@ -36,6 +41,147 @@ struct dc_jsonrpc_instance_t;
 Q_DECLARE_OPAQUE_POINTER(dc_msg_t*);
 Q_DECLARE_OPAQUE_POINTER(dc_jsonrpc_instance_t*);
 
+// One log message as received by myMessageOutput(). Formatting
+// and writing happen later in the LogWriter thread.
+struct LogRecord {
+    // ms since epoch
+    qint64 timestamp;
+    QtMsgType type;
+    // copied as context.file is not guaranteed to outlive
+    // the call (e.g., for messages from QML)
+    QByteArray file;
+    int line;
+    QString msg;
+    // If set, msg is empty and the message is created by calling
+    // this function in the LogWriter thread, see enqueueDeferredLogMessage()
+    std::function<QString()> formatMsg;
+};
+
+// Writes the log messages to std::cerr (which is bound to logfile.txt,
+// see main()) in a background thread, so the threads that call qDebug()
+// etc. neither have to wait for the formatting nor for the file I/O.
+class LogWriter : public QThread {
+
+public:
+    LogWriter() : m_stop {false}, m_dropped {0} {}
+
+    // can be called from any thread
+    void enqueue(LogRecord &&record) {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.size() >= maxPending) {
+            // The writer can't keep up. Better lose some messages
+            // than let the memory grow without limit.
+            ++m_dropped;
+            return;
+        }
+        m_pending.push_back(std::move(record));
+        m_condition.wakeOne();
+    }
+
+    // writes all pending messages and terminates the thread
+    void flushAndStop() {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stop = true;
+            m_condition.wakeOne();
+        }
+        wait();
+    }
+
+    static void writeRecord(const LogRecord &record) {
+        QString logHeading(QDateTime::fromMSecsSinceEpoch(record.timestamp).toString("MMM dd hh:mm:ss "));
+
+        if (!record.file.isEmpty()) {
+            logHeading.append(record.file);
+            logHeading.append(":");
+            logHeading.append(QString::number(record.line));
+            logHeading.append(": ");
+        }
+
+        switch (record.type) {
+        case QtDebugMsg:
+            break;
+        case QtInfoMsg:
+            logHeading.append("Info: ");
+            break;
+        case QtWarningMsg:
+            logHeading.append("Warning: ");
+            break;
+        case QtCriticalMsg:
+            logHeading.append("Critical: ");
+            break;
+        case QtFatalMsg:
+            // not passed to the writer, see myMessageOutput()
+            break;
+        }
+
+        if (record.formatMsg) {
+            std::cerr << logHeading.toLocal8Bit().constData() << record.formatMsg().toLocal8Bit().constData() << "\n";
+        } else {
+            std::cerr << logHeading.toLocal8Bit().constData() << record.msg.toLocal8Bit().constData() << "\n";
+        }
+    }
+
+protected:
+    void run() override {
+        std::vector<LogRecord> records;
+        bool stop {false};
+        int dropped {0};
+
+        while (!stop) {
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_pending.empty() && !m_stop) {
+                    m_condition.wait(&m_mutex);
+                }
+                records.swap(m_pending);
+                stop = m_stop;
+                dropped = m_dropped;
+                m_dropped = 0;
+            }
+
+            for (size_t i = 0; i < records.size(); ++i) {
+                writeRecord(records[i]);
+            }
+            records.clear();
+
+            if (dropped > 0) {
+                std::cerr << "LogWriter: " << dropped << " log messages dropped\n";
+            }
+
+            std::cerr.flush();
+        }
+    }
+
+private:
+    static constexpr size_t maxPending = 20000;
+
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    std::vector<LogRecord> m_pending;
+    bool m_stop;
+    int m_dropped;
+};
+
+// set in main(), messages are written synchronously if it's not running
+static LogWriter* logWriter {nullptr};
+
+// For log messages that are frequent and expensive to format, like
+// the core events in the DeltaHandler plugin (see EventLog). Only the
+// raw data is passed to the LogWriter thread, which does the formatting.
+// The plugin gets the address of this function via the application
+// property "deferredLogSink" (set in main()), the signature has to
+// match DeferredLogSink in plugins/DeltaHandler/eventLog.h.
+static void enqueueDeferredLogMessage(qint64 timestamp, QtMsgType type, std::function<QString()> &&formatMsg)
+{
+    LogRecord record { timestamp, type, QByteArray(), 0, QString(), std::move(formatMsg) };
+    if (logWriter && logWriter->isRunning()) {
+        logWriter->enqueue(std::move(record));
+    } else {
+        LogWriter::writeRecord(record);
+    }
+}
+
 // QtMessageHandler, a typedef for a pointer to a function with the following signature:
 //
 // void myMessageHandler(QtMsgType, const QMessageLogContext &, const QString &);
@@ -43,56 +189,39 @@ Q_DECLARE_OPAQUE_POINTER(dc_jsonrpc_instance_t*);
 // For further info see the comment re logging in main()
 void myMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-    QByteArray logMessage = msg.toLocal8Bit();
-
-    QString logHeading(QDateTime::currentDateTime().toString("MMM dd hh:mm:ss "));
-
-    if (context.file) {
-        logHeading.append(context.file);
-        logHeading.append(":");
-        logHeading.append(QString::number(context.line));
-        logHeading.append(": ");
-    }
-
-    // Currently not logging the function in which the message was generated
-//    if (context.function) {
-//        logHeading.append("in: ");
-//        logHeading.append(context.function);
-//    }
-
     // only needed for QtFatalMsg, to be able to rm -rf the cache dir
     QDir cachepath;
 
     // everything except qFatal messages will be redirected to std::cerr because
     // cerr is bound to logfile.txt via freopen in main()
-    switch (type) {
-    case QtDebugMsg:
-        std::cerr << logHeading.toLocal8Bit().constData() << logMessage.constData() << "\n";
-        break;
-    case QtInfoMsg:
-        std::cerr << logHeading.toLocal8Bit().constData() << "Info: " << logMessage.constData() << "\n";
-        break;
-    case QtWarningMsg:
-        std::cerr << logHeading.toLocal8Bit().constData() << "Warning: " << logMessage.constData() << "\n";
-        break;
-    case QtCriticalMsg:
-        std::cerr << logHeading.toLocal8Bit().constData() << "Critical: " << logMessage.constData() << "\n";
-        break;
-    case QtFatalMsg:
-        // take care of removing the cache as DeltaHandler::shutdownTasks()
-        // will not be called
-        cachepath.setPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
-        cachepath.removeRecursively();
-
-        // Maybe not the best solution, but as we want this message to persist,
-        // we can't send this message to cerr because cerr is bound to the
-        // logfile in the cache which will be deleted when the app is exiting.
-        // Feeding the message to std::cout will cause it to be logged by
-        // journald.
-        // No need for logHeading as journald will put a timestamp on it.
-        std::cout << "Fatal: " << logMessage.constData() << std::endl;
-        break;
+    if (type != QtFatalMsg) {
+        LogRecord record { QDateTime::currentMSecsSinceEpoch(), type, QByteArray(context.file), context.line, msg };
+        if (logWriter && logWriter->isRunning()) {
+            logWriter->enqueue(std::move(record));
+        } else {
+            LogWriter::writeRecord(record);
+        }
+        return;
+    }
+
+    // Fatal: write everything that is still pending first, the
+    // app will be terminated after this function
+    if (logWriter && logWriter->isRunning() && QThread::currentThread() != logWriter) {
+        logWriter->flushAndStop();
     }
+
+    // take care of removing the cache as DeltaHandler::shutdownTasks()
+    // will not be called
+    cachepath.setPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    cachepath.removeRecursively();
+
+    // Maybe not the best solution, but as we want this message to persist,
+    // we can't send this message to cerr because cerr is bound to the
+    // logfile in the cache which will be deleted when the app is exiting.
+    // Feeding the message to std::cout will cause it to be logged by
+    // journald.
+    // No need for logHeading as journald will put a timestamp on it.
+    std::cout << "Fatal: " << msg.toLocal8Bit().constData() << std::endl;
 } // myMessageOutput
 
 int main(int argc, char *argv[])
@@ -213,11 +342,19 @@ int main(int argc, char *argv[])
         exit(1);
     }
 
+    // Messages are formatted and written in the background,
+    // see LogWriter
+    logWriter = new LogWriter();
+    logWriter->start(QThread::LowPriority);
+
     // install a different message handler for Qt, this
     // will redirect Qt and QML console output and log messages
     // (via qDebug(), qWarning() etc.
     qInstallMessageHandler(myMessageOutput);
 
+    // see enqueueDeferredLogMessage()
+    app->setProperty("deferredLogSink", QVariant::fromValue(reinterpret_cast<quintptr>(&enqueueDeferredLogMessage)));
+
     // end logging part
 
     qRegisterMetaType<uint32_t>("uint32_t");
@@ -248,5 +385,10 @@ int main(int argc, char *argv[])
     // first for any QML file
     QQmlFileSelector* selector = new QQmlFileSelector(view->engine());
 
-    return app->exec();
+    int retval = app->exec();
+
+    // make sure everything is written before exiting
+    logWriter->flushAndStop();
+
+    return retval;
 }
@@ -22,6 +22,13 @@
 AccountsModel::AccountsModel(QObject* parent)
     : QAbstractListModel(parent), m_accountsManager {nullptr}, m_accountsArray {nullptr}
 {
+    m_reconcileTimer = new QTimer(this);
+    m_reconcileTimer->setInterval(reconcileInterval);
+
+    bool connectSuccess = connect(m_reconcileTimer, SIGNAL(timeout()), this, SLOT(reconcileCounters()));
+    if (!connectSuccess) {
+        qFatal("AccountsModel::AccountsModel(): Could not connect signal timeout of m_reconcileTimer to slot reconcileCounters");
+    }
 }
 
 
@@ -76,77 +83,38 @@ QVariant AccountsModel::data(const QModelIndex &index, int role) const
     }
 
     uint32_t accID = dc_array_get_id(m_accountsArray, row);
-    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
 
-    if (0 == dc_context_is_open(tempContext)) {
-        qDebug() << "AccountsModel::data(): ERROR: Context of account with ID " << accID << " is closed, cannot obtain data";
-    }
-    
-    QVariant retval;
-    QString tempQString;
-    bool tempBool;
-    char* tempText {nullptr};
-    size_t i;
+    // Everything that needs the core is taken from the snapshot, see
+    // refreshSnapshot(). QStrings are implicitly shared, so the copy
+    // is cheap.
+    AccountSnapshot snapshot = m_accountSnapshots.value(accID);
 
-    // for jsonrpc
-    QString paramString;
-    QString requestString;
-    QByteArray jsonResponseByteArray;
-    QJsonObject jsonObj;
+    QVariant retval;
+    QHash<uint32_t, AccountCounters>::const_iterator countersIt;
 
     switch(role) {
         case AccountsModel::AddrRole:
-            tempText = dc_get_config(tempContext, "addr");
-            if (tempText) {
-                tempQString = tempText;
-                if (tempQString == "") {
-                    tempQString = "Unconfigured";
-                    tempQString.append(QString::number(accID));
-                }
-            }
-            else {
-                tempQString = "Unconfigured";
-                tempQString.append(QString::number(accID));
-            }
-            retval = tempQString;
+            retval = snapshot.addr;
             break;
 
         case AccountsModel::IsConfiguredRole:
-            tempBool = dc_is_configured(tempContext);
-            retval = tempBool;
+            retval = snapshot.isConfigured;
             break;
 
         case AccountsModel::IsMutedRole:
-            tempText = dc_get_config(tempContext, "ui.desktop.muted");
-            tempQString = tempText;
-            if (tempQString == "1") {
-                retval = true;
-            } else {
-                retval = false;
-            }
+            retval = snapshot.isMuted;
             break;
 
         case AccountsModel::ProfilePicRole:
-            tempText = dc_get_config(tempContext, "selfavatar");
-            tempQString = tempText;
-            if (tempQString.length() > QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length()) {
-                tempQString.remove(0, QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length());
-            }
-            else {
-                tempQString = "";
-            }
-            retval = tempQString;
+            retval = snapshot.profilePic;
             break;
 
         case AccountsModel::UsernameRole:
-            tempText = dc_get_config(tempContext, "displayname");
-            tempQString = tempText;
-            retval = tempQString;
+            retval = snapshot.username;
             break;
 
         case AccountsModel::IsClosedRole:
-            tempBool = m_deltaHandler->isClosedAccount(accID);
-            retval = tempBool;
+            retval = m_deltaHandler->isClosedAccount(accID);
             break;
 
         case AccountsModel::IsCurrentActiveRole:
@@ -158,39 +126,25 @@ QVariant AccountsModel::data(const QModelIndex &index, int role) const
             break;
 
         case AccountsModel::ColorRole:
-            // looks like the color of an account can only be obtained via jsonrpc
-            paramString.setNum(accID);
-
-            requestString = m_deltaHandler->constructJsonrpcRequestString("get_account_info", paramString);
-            jsonResponseByteArray = m_deltaHandler->sendJsonrpcBlockingCall(requestString).toLocal8Bit();
-
-            jsonObj = QJsonDocument::fromJson(jsonResponseByteArray).object();
-
-            jsonObj = jsonObj.value("result").toObject();
-            if (jsonObj.value("kind").toString() == "Configured") {
-                retval = jsonObj.value("color").toString();
-            } else {
-                retval = "#000000";
-            }
+            retval = snapshot.color;
             break;
 
         case AccountsModel::FreshMsgCountRole:
-            if (dc_is_configured(tempContext)) {
-                retval = getNumberOfFreshMsgs(accID);
+            // the counters of unconfigured accounts are always 0
+            countersIt = m_accountCounters.constFind(accID);
+            if (countersIt != m_accountCounters.constEnd()) {
+                retval = countersIt.value().freshMsgs.size();
             } else {
                 retval = 0;
             }
             break;
 
         case AccountsModel::ChatRequestCountRole:
-            retval = 0;
-            if (dc_is_configured(tempContext)) {
-                for (i = 0; i < m_chatRequests.size(); ++i) {
-                    if (m_chatRequests[i].accID == accID) {
-                        retval = static_cast<int>(m_chatRequests[i].contactRequestChatIDs.size());
-                        break;
-                    }
-                }
+            countersIt = m_accountCounters.constFind(accID);
+            if (countersIt != m_accountCounters.constEnd()) {
+                retval = static_cast<int>(countersIt.value().contactRequestChats.size());
+            } else {
+                retval = 0;
             }
             break;
 
@@ -200,14 +154,6 @@ QVariant AccountsModel::data(const QModelIndex &index, int role) const
             break;
     }
 
-    if (tempText) {
-        dc_str_unref(tempText);
-    }
-
-    if (tempContext) {
-        dc_context_unref(tempContext);
-    }
-
     return retval;
 }
 
@@ -225,29 +171,20 @@ void AccountsModel::configure(dc_accounts_t* accMngr, DeltaHandler* dHandler)
     }
     m_accountsArray = dc_accounts_get_all(m_accountsManager);
 
-    {
-        // build up m_chatRequests
-        m_chatRequests.resize(0);
-
-        // Check for chat requests in the chatlist entries for each
-        // account.
-        if (m_accountsArray) {
-            // call generateOrRefreshChatRequestEntries for each account
-            for (size_t i = 0; i < dc_array_get_cnt(m_accountsArray); ++i) {
-                uint32_t tempAccID = dc_array_get_id(m_accountsArray, i);
-                generateOrRefreshChatRequestEntries(tempAccID);
-            }
-        }
-    }
+    rebuildAllSnapshots();
+    rebuildAllCounters();
 
     endResetModel();
 
+    m_reconcileTimer->start();
+
     // disconnect in case configure() is not called for the first time. Otherwise, multiple
     // connections would be created.
     disconnect(m_deltaHandler, SIGNAL(newUnconfiguredAccount()), this, SLOT(newAccount()));
     disconnect(m_deltaHandler, SIGNAL(newConfiguredAccount()), this, SLOT(newAccount()));
     disconnect(m_deltaHandler, SIGNAL(accountIsConfiguredChanged(uint32_t)), this, SLOT(updatedAccount(uint32_t)));
     disconnect(m_deltaHandler, SIGNAL(accountChanged()), this, SLOT(reset()));
+    disconnect(m_deltaHandler, SIGNAL(accountDataChanged()), this, SLOT(currentAccountDataChanged()));
 
     bool connectSuccess = connect(m_deltaHandler, SIGNAL(newUnconfiguredAccount()), this, SLOT(newAccount()));
     if (!connectSuccess) {
@@ -269,6 +206,11 @@ void AccountsModel::configure(dc_accounts_t* accMngr, DeltaHandler* dHandler)
         qDebug() << "AccountsModel::configure(): ERROR: Could not connect signal accountChanged of m_deltaHandler with slot reset";
     }  
 
+    connectSuccess = connect(m_deltaHandler, SIGNAL(accountDataChanged()), this, SLOT(currentAccountDataChanged()));
+    if (!connectSuccess) {
+        qDebug() << "AccountsModel::configure(): ERROR: Could not connect signal accountDataChanged of m_deltaHandler with slot currentAccountDataChanged";
+    }
+
     emit inactiveFreshMsgsMayHaveChanged();
 }
 
@@ -291,13 +233,8 @@ void AccountsModel::reset()
         m_accountsArray = dc_accounts_get_all(m_accountsManager);
     }
 
-    // recreate m_chatRequests
-    if (m_accountsArray) {
-        for (size_t i = 0; i < dc_array_get_cnt(m_accountsArray); ++i) {
-            uint32_t tempAccID = dc_array_get_id(m_accountsArray, i);
-            generateOrRefreshChatRequestEntries(tempAccID);
-        }
-    }
+    rebuildAllSnapshots();
+    rebuildAllCounters();
 
     endResetModel();
 
@@ -327,39 +264,88 @@ void AccountsModel::notifyViewForAccount(uint32_t accID)
 }
 
 
-// Parameter passed by reference, the queue will be empty after calling this method!
-void AccountsModel::updateFreshMsgCountAndContactRequests(const std::vector<uint32_t>& accountsToRefresh)
+void AccountsModel::updateAccountCounters(const QHash<uint32_t, AccountDirtyState> &dirtyStates)
 {
-    for (size_t i = 0; i < accountsToRefresh.size(); ++i) {
-        uint32_t accID = accountsToRefresh[i];
-        generateOrRefreshChatRequestEntries(accID);
+    bool countersChanged {false};
 
-        // notify the view that the model has changed for this accID
-        notifyViewForAccount(accID);
+    QHash<uint32_t, AccountDirtyState>::const_iterator it;
+    for (it = dirtyStates.constBegin(); it != dirtyStates.constEnd(); ++it) {
+        uint32_t accID = it.key();
+        const AccountDirtyState &state = it.value();
+
+        if (!state.contactRequestsStale && state.contactRequestCandidates.isEmpty() && !state.freshMsgCountStale && state.incomingMsgs.isEmpty() && state.freshMsgCandidates.isEmpty()) {
+            continue;
+        }
+
+        // account not (or not anymore) in the model
+        if (!m_accountCounters.contains(accID)) {
+            continue;
+        }
+
+        AccountCounters oldCounters = m_accountCounters.value(accID);
+
+        if (state.contactRequestsStale) {
+            generateOrRefreshChatRequestEntries(accID);
+        } else if (!state.contactRequestCandidates.isEmpty()) {
+            updateContactRequestEntries(accID, state.contactRequestCandidates);
+        }
+
+        if (state.freshMsgCountStale) {
+            m_accountCounters[accID].freshMsgs = getFreshMsgs(accID);
+        } else {
+            if (!state.incomingMsgs.isEmpty()) {
+                addFreshIncomingMsgs(accID, state.incomingMsgs, m_accountCounters[accID].freshMsgs);
+            }
+            if (!state.freshMsgCandidates.isEmpty()) {
+                removeNotFreshMsgs(accID, state.freshMsgCandidates, m_accountCounters[accID].freshMsgs);
+            }
+        }
+
+        const AccountCounters &newCounters = m_accountCounters[accID];
+        if (newCounters.freshMsgs.size() != oldCounters.freshMsgs.size() || newCounters.contactRequestChats != oldCounters.contactRequestChats) {
+            // notify the view that the model has changed for this accID
+            notifyViewForAccount(accID);
+            countersChanged = true;
+        }
+    }
+
+    if (countersChanged) {
+        emit inactiveFreshMsgsMayHaveChanged();
+    }
+}
+
+
+void AccountsModel::reconcileCounters()
+{
+    bool countersChanged {false};
+
+    QHash<uint32_t, AccountCounters>::iterator it;
+    for (it = m_accountCounters.begin(); it != m_accountCounters.end(); ++it) {
+        QSet<uint32_t> freshMsgs = getFreshMsgs(it.key());
+        if (freshMsgs != it.value().freshMsgs) {
+            qDebug() << "AccountsModel::reconcileCounters(): Fresh message count of account " << it.key() << " was " << it.value().freshMsgs.size() << ", corrected to " << freshMsgs.size();
+            it.value().freshMsgs = freshMsgs;
+            notifyViewForAccount(it.key());
+            countersChanged = true;
+        }
+    }
+
+    if (countersChanged) {
+        emit inactiveFreshMsgsMayHaveChanged();
     }
-    
-    emit inactiveFreshMsgsMayHaveChanged();
 }
 
 
 // Removes the chat ID from the list of contact requests for this accID.
 void AccountsModel::removeChatIdFromContactRequestList(uint32_t accID, uint32_t chatID)
 {
-    // find the account
-    for (size_t i = 0; i < m_chatRequests.size(); ++i) {
-        if (m_chatRequests[i].accID == accID) {
-
-            // find the chat ID and remove the chat from the vector
-            std::vector<uint32_t>::iterator it;
-            for (it = m_chatRequests[i].contactRequestChatIDs.begin(); it != m_chatRequests[i].contactRequestChatIDs.end(); ++it) {
-                if (*it == chatID) {
-                    m_chatRequests[i].contactRequestChatIDs.erase(it);
-                    // TODO: remove the complete entry from m_chatRequests if contactRequestChatIDs is empty?
-                    break;
-                }
-            }
-            break;
-        }
+    QHash<uint32_t, AccountCounters>::iterator countersIt = m_accountCounters.find(accID);
+    if (countersIt != m_accountCounters.end()) {
+        countersIt.value().contactRequestChats.remove(chatID);
+
+        // the messages of an accepted chat are now
+        // counted as fresh messages
+        countersIt.value().freshMsgs = getFreshMsgs(accID);
     }
 
     // notify the view that the model has changed
@@ -385,29 +371,8 @@ void AccountsModel::configureAccount(int myindex)
 
 QString AccountsModel::getAddressOfIndex(int myindex)
 {
-
-    QString tempQString;
-
     uint32_t accID = dc_array_get_id(m_accountsArray, myindex);
-    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
-    char* tempText = dc_get_config(tempContext, "addr");
-
-    if (tempText) {
-        tempQString = tempText;
-        if (tempQString == "") {
-            tempQString = "Unconfigured";
-            tempQString.append(QString::number(accID));
-        }
-    }
-    else {
-        tempQString = "Unconfigured";
-        tempQString.append(QString::number(accID));
-    }
-
-    dc_context_unref(tempContext);
-    dc_str_unref(tempText);
-
-    return tempQString;
+    return m_accountSnapshots.value(accID).addr;
 }
 
 
@@ -467,10 +432,10 @@ int AccountsModel::noOfChatRequestsInInactiveAccounts()
     int retval {0};
     uint32_t currentAccID = m_deltaHandler->getCurrentAccountId();
 
-    for (size_t i = 0; i < m_chatRequests.size(); ++i) {
-        uint32_t tempAccId = m_chatRequests[i].accID;
-        if (tempAccId != currentAccID && !accountIsMuted(tempAccId)) {
-            retval += static_cast<int>(m_chatRequests[i].contactRequestChatIDs.size());
+    QHash<uint32_t, AccountCounters>::const_iterator it;
+    for (it = m_accountCounters.constBegin(); it != m_accountCounters.constEnd(); ++it) {
+        if (it.key() != currentAccID && !it.value().contactRequestChats.isEmpty() && !accountIsMuted(it.key())) {
+            retval += static_cast<int>(it.value().contactRequestChats.size());
         }
     }
 
@@ -483,10 +448,11 @@ int AccountsModel::noOfFreshMsgsInInactiveAccounts()
     int retval {0};
     uint32_t currentAccID = m_deltaHandler->getCurrentAccountId();
 
-    for (size_t i = 0; i < dc_array_get_cnt(m_accountsArray); ++i) {
-        uint32_t tempAccID = dc_array_get_id(m_accountsArray, i);
-        if (tempAccID != currentAccID && !accountIsMuted(tempAccID) && accountIsConfigured(tempAccID)) {
-            retval += getNumberOfFreshMsgs(tempAccID);
+    // the counters of unconfigured accounts are always 0
+    QHash<uint32_t, AccountCounters>::const_iterator it;
+    for (it = m_accountCounters.constBegin(); it != m_accountCounters.constEnd(); ++it) {
+        if (it.key() != currentAccID && !it.value().freshMsgs.isEmpty() && !accountIsMuted(it.key())) {
+            retval += it.value().freshMsgs.size();
         }
     }
 
@@ -519,6 +485,8 @@ int AccountsModel::deleteAccount(int myindex)
         qDebug() << "AccountsModel::deleteAccount: ...done.";
         dc_array_unref(m_accountsArray);
         m_accountsArray = dc_accounts_get_all(m_accountsManager);
+        m_accountCounters.remove(accID);
+        m_accountSnapshots.remove(accID);
     } else {
         qDebug() << "AccountsModel::deleteAccount: ...Error: Deleting account did not work.";
     }
@@ -549,7 +517,10 @@ void AccountsModel::updatedAccount(uint32_t accID)
     }
 
     if (foundAccID) {
-       dataChanged(index(tempIndex, 0), index(tempIndex, 0)); 
+        // the account has been (re-)configured, so
+        // address and color may have changed
+        refreshSnapshot(accID);
+        dataChanged(index(tempIndex, 0), index(tempIndex, 0)); 
     }
     else {
         qDebug() << "AccountsModel::updatedAccount: ERROR: Did not find the account ID.";
@@ -557,133 +528,298 @@ void AccountsModel::updatedAccount(uint32_t accID)
 }
 
 
-void AccountsModel::generateOrRefreshChatRequestEntries(uint32_t accID)
+void AccountsModel::currentAccountDataChanged()
 {
-    // remove the old entry
-    std::vector<AccAndContactRequestList>::iterator it;
-    for (it = m_chatRequests.begin(); it != m_chatRequests.end(); ++it) {
-        if (it->accID == accID) {
-            m_chatRequests.erase(it);
-            break;
-        }
+    refreshAccountData(m_deltaHandler->getCurrentAccountId());
+}
+
+
+void AccountsModel::refreshAccountData(uint32_t accID)
+{
+    // account not (or not anymore) in the model
+    if (m_accountSnapshots.contains(accID)) {
+        refreshSnapshot(accID);
+        notifyViewForAccount(accID);
     }
+}
 
-    // create the entry
-    std::vector<uint32_t> tempContactRequList;
 
-    // check if the account is configured; if not, add empty vector for this account
-    if (!accountIsConfigured(accID)) {
-        m_chatRequests.push_back({accID, tempContactRequList});
+void AccountsModel::rebuildAllSnapshots()
+{
+    m_accountSnapshots.clear();
+
+    if (!m_accountsArray) {
         return;
     }
 
-    QString paramString = "";
+    for (size_t i = 0; i < dc_array_get_cnt(m_accountsArray); ++i) {
+        refreshSnapshot(dc_array_get_id(m_accountsArray, i));
+    }
+}
+
+
+void AccountsModel::refreshSnapshot(uint32_t accID)
+{
+    AccountSnapshot snapshot;
 
-    // First get the chatlist entries as array of numbers by using the Jsonrpc call
-    // get_chatlist_entries(accountId: number, listFlags: null | number, queryString: null | string, queryContactId: null | number)
-    QString tempString;
-    tempString.setNum(accID);
-    paramString.append(tempString);
-    paramString.append(", null, null, null");
+    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
 
-    // create a request string and send it as blocking Jsonrpc call
-    QString requestString = m_deltaHandler->constructJsonrpcRequestString("get_chatlist_entries", paramString);
+    if (0 == dc_context_is_open(tempContext)) {
+        qDebug() << "AccountsModel::refreshSnapshot(): ERROR: Context of account with ID " << accID << " is closed, cannot obtain data";
+    }
+
+    char* tempText = dc_get_config(tempContext, "addr");
+    snapshot.addr = tempText;
+    if (snapshot.addr == "") {
+        snapshot.addr = "Unconfigured";
+        snapshot.addr.append(QString::number(accID));
+    }
+    dc_str_unref(tempText);
+
+    snapshot.isConfigured = dc_is_configured(tempContext);
+
+    tempText = dc_get_config(tempContext, "ui.desktop.muted");
+    snapshot.isMuted = (QString(tempText) == "1");
+    dc_str_unref(tempText);
+
+    tempText = dc_get_config(tempContext, "selfavatar");
+    QString tempQString = tempText;
+    dc_str_unref(tempText);
+    QString configLocation = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    if (tempQString.length() > configLocation.length()) {
+        tempQString.remove(0, configLocation.length());
+        snapshot.profilePic = tempQString;
+    }
+
+    tempText = dc_get_config(tempContext, "displayname");
+    snapshot.username = tempText;
+    dc_str_unref(tempText);
+
+    if (tempContext) {
+        dc_context_unref(tempContext);
+    }
+
+    // looks like the color of an account can only be obtained via jsonrpc
+    QString paramString;
+    paramString.setNum(accID);
+
+    QString requestString = m_deltaHandler->constructJsonrpcRequestString("get_account_info", paramString);
     QByteArray jsonResponseByteArray = m_deltaHandler->sendJsonrpcBlockingCall(requestString).toLocal8Bit();
 
-    // the actual object with the chat IDs is an array nested in the
-    // received json like this:
-    // { .....,,\"result\":[22,12,13,38,10,37]}
-    // so we extract it
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonResponseByteArray);
-    QJsonObject jsonObj = jsonDoc.object();
-    // value() returns a QJsonValue of type array, which we 
-    // transform to an QJsonArray
-    QJsonArray jsonArray = jsonObj.value("result").toArray();
-    
-    // With the array containing chat IDs, retrieve
-    // the actual chatlist items by using the Jsonrpc call
-    // get_chalist_items_by_entries(accountId: number, entries: number[])
-    paramString = "";
-    // tempString still contains the account ID
-    paramString.append(tempString);
-    paramString.append(", ");
-    // convert jsonArray to a QByteArray via an unnamed QJsonDocument
-    paramString.append(QJsonDocument(jsonArray).toJson());
-
-    requestString = m_deltaHandler->constructJsonrpcRequestString("get_chatlist_items_by_entries", paramString);
-    jsonResponseByteArray = m_deltaHandler->sendJsonrpcBlockingCall(requestString).toLocal8Bit();
-
-    // jsonResponseByteArray now has a huge JSON with chatlist entries for each chat ID.
-    // The actual object with the chatlist entry is nested in the received json like this:
-    // { .....,"result":{"<chatID>":{ <this is the actual entry per chat ID> }}}
-    jsonDoc = QJsonDocument::fromJson(jsonResponseByteArray);
-    jsonObj = jsonDoc.object();
-    QJsonObject jsonResultObj = jsonObj.value("result").toObject();
-
-    // Go through all chats by looping through the array with chat IDs.
-    // Add each chat that is a contact request to tempContactRequList.
-
-    std::vector<int> listOfChatIDs;
-    QVariantList tempVariantList = jsonArray.toVariantList();
-    // Copying the entries of jsonArray to a vector first
-    // because when looping through jsonArray directly, there
-    // was some strange error where it would crash mid-loop
-    for (QVariant temp : tempVariantList) {
-        listOfChatIDs.push_back(temp.toInt());
-    }
-
-    for (size_t i = 0; i < listOfChatIDs.size(); ++i) {
-        int tempChatID = listOfChatIDs[i];
-
-        tempString.setNum(tempChatID);
-        jsonObj = jsonResultObj.value(tempString).toObject();
-
-        // if it's a contact request, then add it to the vector
-        QJsonValue tempValue = jsonObj.value("isContactRequest");
-        if (tempValue != QJsonValue::Undefined) {
-            if (tempValue.toBool()) {
-                tempContactRequList.push_back(tempChatID);
+    QJsonObject jsonObj = QJsonDocument::fromJson(jsonResponseByteArray).object().value("result").toObject();
+    if (jsonObj.value("kind").toString() == "Configured") {
+        snapshot.color = jsonObj.value("color").toString();
+    }
+
+    m_accountSnapshots.insert(accID, snapshot);
+}
+
+
+void AccountsModel::rebuildAllCounters()
+{
+    m_accountCounters.clear();
+
+    if (!m_accountsArray) {
+        return;
+    }
+
+    for (size_t i = 0; i < dc_array_get_cnt(m_accountsArray); ++i) {
+        uint32_t tempAccID = dc_array_get_id(m_accountsArray, i);
+        m_accountCounters.insert(tempAccID, AccountCounters());
+        generateOrRefreshChatRequestEntries(tempAccID);
+        m_accountCounters[tempAccID].freshMsgs = getFreshMsgs(tempAccID);
+    }
+}
+
+
+void AccountsModel::generateOrRefreshChatRequestEntries(uint32_t accID)
+{
+    QSet<uint32_t> tempContactRequests;
+
+    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
+
+    // Unconfigured or closed accounts get an empty index. Otherwise, all
+    // chats of the (unarchived) chatlist are checked. The core cannot
+    // filter the chatlist for contact requests, but the checks are done
+    // via the C API without any JSON, and this is only needed when
+    // seeding the index and for the rare events that affect all chats.
+    // Single chats are handled by updateContactRequestEntries().
+    if (tempContext && dc_context_is_open(tempContext) && dc_is_configured(tempContext)) {
+        dc_chatlist_t* tempChatlist = dc_get_chatlist(tempContext, DC_GCL_NO_SPECIALS, NULL, 0);
+        size_t chatCount = dc_chatlist_get_cnt(tempChatlist);
+
+        for (size_t i = 0; i < chatCount; ++i) {
+            uint32_t tempChatID = dc_chatlist_get_chat_id(tempChatlist, i);
+            if (chatIsContactRequest(tempContext, tempChatID)) {
+                tempContactRequests.insert(tempChatID);
             }
         }
+
+        dc_chatlist_unref(tempChatlist);
     }
 
-    // save the account ID along with the vector that contains
-    // chat IDs which are contact requests
-    m_chatRequests.push_back({accID, tempContactRequList});
+    if (tempContext) {
+        dc_context_unref(tempContext);
+    }
 
-    // Not needed here: Will be emitted at the end of each
-    // block that calls generateOrRefreshChatRequestEntries
-    //emit inactiveFreshMsgsMayHaveChanged();
+    m_accountCounters[accID].contactRequestChats = tempContactRequests;
 }
 
 
-int AccountsModel::getNumberOfFreshMsgs(uint32_t tempAccID) const
+void AccountsModel::updateContactRequestEntries(uint32_t accID, const QSet<int> &chatIDs)
 {
-    QString tempString;
-    tempString.setNum(tempAccID);
-    QString paramString;
-    paramString.append(tempString);
+    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
 
-    // create a request string and send it as blocking Jsonrpc call
-    QString requestString = m_deltaHandler->constructJsonrpcRequestString("get_fresh_msgs", paramString);
-    QByteArray jsonResponseByteArray = m_deltaHandler->sendJsonrpcBlockingCall(requestString).toLocal8Bit();
+    if (!tempContext) {
+        return;
+    }
 
-    // the actual object with the IDs of the fresh msgs is an array nested in the
-    // received json like this:
-    // { .....,,\"result\":[125,204]}
-    // so we extract it
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonResponseByteArray);
-    QJsonObject jsonObj = jsonDoc.object();
-    // value() returns a QJsonValue of type array, which we 
-    // transform to an QJsonArray
-    QJsonArray jsonArray = jsonObj.value("result").toArray();
+    QSet<uint32_t> &contactRequests = m_accountCounters[accID].contactRequestChats;
 
-    return jsonArray.size();
+    if (dc_context_is_open(tempContext) && dc_is_configured(tempContext)) {
+        QSet<int>::const_iterator it;
+        for (it = chatIDs.constBegin(); it != chatIDs.constEnd(); ++it) {
+            uint32_t tempChatID = static_cast<uint32_t>(*it);
+            if (chatIsContactRequest(tempContext, tempChatID)) {
+                contactRequests.insert(tempChatID);
+            } else {
+                contactRequests.remove(tempChatID);
+            }
+        }
+    }
+
+    dc_context_unref(tempContext);
+}
+
+
+bool AccountsModel::chatIsContactRequest(dc_context_t* context, uint32_t chatID) const
+{
+    dc_chat_t* tempChat = dc_get_chat(context, chatID);
+
+    // Deleted chats are not a contact request anymore. Archived
+    // ones are not shown in the chatlist, so they are not counted,
+    // same as in the chatlist that is used for seeding.
+    if (!tempChat) {
+        return false;
+    }
+
+    bool retval = dc_chat_is_contact_request(tempChat) && dc_chat_get_visibility(tempChat) != DC_CHAT_VISIBILITY_ARCHIVED;
+    dc_chat_unref(tempChat);
+
+    return retval;
+}
+
+
+QSet<uint32_t> AccountsModel::getFreshMsgs(uint32_t tempAccID) const
+{
+    QSet<uint32_t> retval;
+
+    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, tempAccID);
+
+    if (!tempContext) {
+        return retval;
+    }
+
+    // Encrypted accounts that have not been opened yet
+    // cannot be queried
+    if (dc_context_is_open(tempContext) && dc_is_configured(tempContext)) {
+        // The C API is used to avoid transferring the IDs as JSON
+        dc_array_t* freshMsgs = dc_get_fresh_msgs(tempContext);
+        size_t freshMsgCount = dc_array_get_cnt(freshMsgs);
+        retval.reserve(static_cast<int>(freshMsgCount));
+        for (size_t i = 0; i < freshMsgCount; ++i) {
+            retval.insert(dc_array_get_id(freshMsgs, i));
+        }
+        dc_array_unref(freshMsgs);
+    }
+
+    dc_context_unref(tempContext);
+
+    return retval;
+}
+
+
+void AccountsModel::addFreshIncomingMsgs(uint32_t accID, const QHash<int, int> &incomingMsgs, QSet<uint32_t> &freshMsgs) const
+{
+    dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
+
+    if (!tempContext) {
+        return;
+    }
+
+    // Messages in muted chats and contact requests are not
+    // counted by dc_get_fresh_msgs(), so they are skipped here
+    // as well. Bursts usually hit few chats, so each chat is
+    // only looked up once.
+    QHash<int, bool> chatCounts;
+    QHash<int, int>::const_iterator msgIt;
+    for (msgIt = incomingMsgs.constBegin(); msgIt != incomingMsgs.constEnd(); ++msgIt) {
+        int chatID = msgIt.value();
+
+        QHash<int, bool>::const_iterator it = chatCounts.constFind(chatID);
+        if (it == chatCounts.constEnd()) {
+            dc_chat_t* tempChat = dc_get_chat(tempContext, chatID);
+            bool counts = tempChat && !dc_chat_is_muted(tempChat) && !dc_chat_is_contact_request(tempChat);
+            if (tempChat) {
+                dc_chat_unref(tempChat);
+            }
+            it = chatCounts.insert(chatID, counts);
+        }
+
+        if (it.value()) {
+            freshMsgs.insert(msgIt.key());
+        }
+    }
+
+    dc_context_unref(tempContext);
+}
+
+
+void AccountsModel::removeNotFreshMsgs(uint32_t accID, const QSet<int> &msgIDs, QSet<uint32_t> &freshMsgs) const
+{
+    dc_context_t* tempContext = nullptr;
+
+    QSet<int>::const_iterator it;
+    for (it = msgIDs.constBegin(); it != msgIDs.constEnd(); ++it) {
+        uint32_t msgID = *it;
+
+        if (!freshMsgs.contains(msgID)) {
+            continue;
+        }
+
+        if (!tempContext) {
+            tempContext = dc_accounts_get_account(m_accountsManager, accID);
+            if (!tempContext) {
+                return;
+            }
+        }
+
+        // deleted messages are moved to the trash chat before
+        // they are actually removed
+        dc_msg_t* tempMsg = dc_get_msg(tempContext, msgID);
+        if (!tempMsg || dc_msg_get_state(tempMsg) != DC_STATE_IN_FRESH || dc_msg_get_chat_id(tempMsg) == DC_CHAT_ID_TRASH) {
+            freshMsgs.remove(msgID);
+        }
+
+        if (tempMsg) {
+            dc_msg_unref(tempMsg);
+        }
+    }
+
+    if (tempContext) {
+        dc_context_unref(tempContext);
+    }
 }
 
 
 bool AccountsModel::accountIsMuted(uint32_t accID)
 {
+    QHash<uint32_t, AccountSnapshot>::const_iterator it = m_accountSnapshots.constFind(accID);
+    if (it != m_accountSnapshots.constEnd()) {
+        return it.value().isMuted;
+    }
+
+    // not in the model (yet), ask the core
     dc_context_t* tempContext = dc_accounts_get_account(m_accountsManager, accID);
 
     if (!tempContext) {
@@ -717,14 +853,20 @@ void AccountsModel::muteUnmuteAccountById(uint32_t accID)
 
     dc_str_unref(tempText);
 
-    if (tempQString == "1") {
-        dc_set_config(tempContext, "ui.desktop.muted", "0");
-    } else {
+    bool nowMuted = (tempQString != "1");
+    if (nowMuted) {
         dc_set_config(tempContext, "ui.desktop.muted", "1");
+    } else {
+        dc_set_config(tempContext, "ui.desktop.muted", "0");
     }
 
     dc_context_unref(tempContext);
 
+    QHash<uint32_t, AccountSnapshot>::iterator snapshotIt = m_accountSnapshots.find(accID);
+    if (snapshotIt != m_accountSnapshots.end()) {
+        snapshotIt.value().isMuted = nowMuted;
+    }
+
 
     // notify the view that the model has changed
     if (m_accountsArray) {
@@ -23,16 +23,35 @@
 #include <QtGui>
 //#include <string>
 #include "deltahandler.h"
+#include "eventCoalescer.h"
 #include "../deltachat.h"
 
 #include <vector>
 
-// Used in m_chatRequests to store the account ID
-// along with the number of chat (contact) requests
-// for this account
-struct AccAndContactRequestList {
-    uint32_t accID;
-    std::vector<uint32_t> contactRequestChatIDs;
+// Badge counters of one account as shown in the account
+// switcher. Kept up to date via updateAccountCounters(), so
+// reading them doesn't need any call to the core.
+struct AccountCounters {
+    // The IDs instead of just the count, so a message that is
+    // already contained (e.g., because a recount happened between
+    // its arrival and the processing of its event) is not
+    // counted twice
+    QSet<uint32_t> freshMsgs;
+    QSet<uint32_t> contactRequestChats;
+};
+
+// Values of an account as shown in the account switcher. Read once
+// from the core and only refreshed when the account is (re-)configured
+// or its profile is changed, so painting the switcher doesn't need
+// any call to the core.
+struct AccountSnapshot {
+    QString addr;
+    QString username;
+    // relative to the config dir, empty if there's no avatar
+    QString profilePic;
+    QString color {"#000000"};
+    bool isConfigured {false};
+    bool isMuted {false};
 };
 
 class DeltaHandler;
@@ -82,7 +101,12 @@ signals:
 public slots:
     void reset();
     void notifyViewForAccount(uint32_t accID);
-    void updateFreshMsgCountAndContactRequests(const std::vector<uint32_t> &accountsToRefresh);
+    // re-reads name, avatar etc. of the account and
+    // updates the view
+    void refreshAccountData(uint32_t accID);
+    // Called by DeltaHandler::processSignalQueue() with the
+    // changes of all accounts since the last run
+    void updateAccountCounters(const QHash<uint32_t, AccountDirtyState> &dirtyStates);
     void removeChatIdFromContactRequestList(uint32_t accID, uint32_t chatID);
 
 protected:
@@ -91,21 +115,55 @@ protected:
 private slots:
     void newAccount();
     void updatedAccount(uint32_t);
+    void reconcileCounters();
+    void currentAccountDataChanged();
 
 private:
     dc_accounts_t* m_accountsManager;
     dc_array_t* m_accountsArray;
     DeltaHandler* m_deltaHandler;
-    std::vector<AccAndContactRequestList> m_chatRequests;
+    QHash<uint32_t, AccountCounters> m_accountCounters;
+    QHash<uint32_t, AccountSnapshot> m_accountSnapshots;
+
+    // The fresh message count is updated incrementally for
+    // incoming messages. In case this drifts from what the core
+    // has (e.g., a missed event), all counts are recounted
+    // periodically.
+    QTimer* m_reconcileTimer;
+    static constexpr int reconcileInterval = 300000;
 
     /* Private methods */
 
-    // Generates the entry in m_chatRequests for the passed
-    // account ID. If an entry for this account is already
-    // present in m_chatRequests, it is replaced.
+    // Re-creates m_accountCounters for all accounts
+    void rebuildAllCounters();
+
+    // Re-creates m_accountSnapshots for all accounts
+    void rebuildAllSnapshots();
+    void refreshSnapshot(uint32_t accID);
+
+    // Generates the contact request index in m_accountCounters for
+    // the passed account ID, replacing the existing one. Checks all
+    // chats, so only used for seeding and if the core signals a
+    // change without a specific chat ID.
     void generateOrRefreshChatRequestEntries(uint32_t accID);
 
-    int getNumberOfFreshMsgs(uint32_t tempAccID) const;
+    // Adds the passed chats to or removes them from the
+    // contact request index of the account
+    void updateContactRequestEntries(uint32_t accID, const QSet<int> &chatIDs);
+
+    bool chatIsContactRequest(dc_context_t* context, uint32_t chatID) const;
+
+    QSet<uint32_t> getFreshMsgs(uint32_t tempAccID) const;
+
+    // Adds those of the incoming messages (msgID => chatID) to
+    // freshMsgs that count as fresh, i.e., are not in a muted
+    // chat or a contact request
+    void addFreshIncomingMsgs(uint32_t accID, const QHash<int, int> &incomingMsgs, QSet<uint32_t> &freshMsgs) const;
+
+    // Removes those of the passed messages from freshMsgs that are
+    // not fresh anymore (seen, deleted). Messages that are not in
+    // freshMsgs are not looked up.
+    void removeNotFreshMsgs(uint32_t accID, const QSet<int> &msgIDs, QSet<uint32_t> &freshMsgs) const;
 
     bool accountIsConfigured(uint32_t tempAccID) const;
 };
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Headless benchmark for the hot paths of the C++ models. Creates an
+ * offline account with synthetic data in a temporary directory, runs
+ * DeltaHandler and ChatModel on it without any QML and prints the
+ * timings as JSON, so results of different builds can be compared
+ * by scripts.
+ *
+ * Only built if BUILD_BENCHMARK is set, see CMakeLists.txt. Run with
+ * --help for the options.
+ */
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QDir>
+#include <QStandardPaths>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "../deltahandler.h"
+#include "../chatmodel.h"
+#include "../contactsmodel.h"
+#include "../../deltachat.h"
+
+struct BenchmarkParameters {
+    int chats {2000};
+    int contacts {5000};
+    int groupSize {500};
+    int bigChatMessages {100000};
+    int iterations {20};
+};
+
+// friend of DeltaHandler, ChatModel and ContactsModel
+class ModelBenchmark {
+
+public:
+    explicit ModelBenchmark(const BenchmarkParameters &params) : m_params(params), m_dhandler {nullptr}, m_accID {0}, m_bigChatID {0} {}
+
+    bool createSyntheticAccount(const QString &accountsDir);
+    void run();
+    QJsonObject results() const;
+
+private:
+    void measure(const QString &name, int iterations, std::function<void()> setup, std::function<void()> task);
+
+    void benchRefreshChatlistVector();
+    void benchProcessSignalQueue();
+    void benchChatModelConfigure();
+    void benchChatModelNewMessage();
+    void benchChatModelUpdateQuery();
+    void benchUpdateContactsArray();
+
+    BenchmarkParameters m_params;
+    DeltaHandler* m_dhandler;
+    uint32_t m_accID;
+    uint32_t m_bigChatID;
+    std::vector<uint32_t> m_chatIDs;
+    QJsonArray m_results;
+};
+
+
+bool ModelBenchmark::createSyntheticAccount(const QString &accountsDir)
+{
+    // Done with a separate account manager before DeltaHandler
+    // is created, DeltaHandler will then open the same directory
+    dc_accounts_t* accounts = dc_accounts_new(accountsDir.toUtf8().constData(), 1);
+    if (!accounts) {
+        std::cerr << "Could not create account manager in " << accountsDir.toStdString() << std::endl;
+        return false;
+    }
+
+    m_accID = dc_accounts_add_account(accounts);
+    dc_context_t* context = dc_accounts_get_account(accounts, m_accID);
+
+    // No IO is started, so the account only has to look configured
+    dc_set_config(context, "addr", "bench@example.org");
+    dc_set_config(context, "configured_addr", "bench@example.org");
+    dc_set_config(context, "displayname", "Benchmark");
+    dc_set_config(context, "configured", "1");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int contactCount = std::max(m_params.contacts, std::max(m_params.chats, m_params.groupSize));
+    std::vector<uint32_t> contactIDs;
+    contactIDs.reserve(contactCount);
+    for (int i = 0; i < contactCount; ++i) {
+        QByteArray name = QByteArray("Contact ") + QByteArray::number(i);
+        QByteArray addr = QByteArray("contact") + QByteArray::number(i) + "@example.org";
+        contactIDs.push_back(dc_create_contact(context, name.constData(), addr.constData()));
+    }
+
+    // one 1:1 chat with one message per contact
+    for (int i = 0; i < m_params.chats; ++i) {
+        uint32_t chatID = dc_create_chat_by_contact_id(context, contactIDs[i]);
+        if (chatID == 0) {
+            continue;
+        }
+        QByteArray text = QByteArray("Synthetic message in chat ") + QByteArray::number(i);
+        dc_send_text_msg(context, chatID, text.constData());
+        m_chatIDs.push_back(chatID);
+    }
+
+    // The group is not promoted (no message sent), so adding
+    // members doesn't create any messages
+    uint32_t groupID = dc_create_group_chat(context, 0, "Large group");
+    for (int i = 0; i < m_params.groupSize; ++i) {
+        dc_add_contact_to_chat(context, groupID, contactIDs[i]);
+    }
+    m_chatIDs.push_back(groupID);
+
+    // Device messages are the cheapest way to fill a single chat
+    // as they don't need rendering of a MIME message
+    uint32_t lastDeviceMsgID {0};
+    for (int i = 0; i < m_params.bigChatMessages; ++i) {
+        dc_msg_t* msg = dc_msg_new(context, DC_MSG_TEXT);
+        QByteArray text = QByteArray("Synthetic device message ") + QByteArray::number(i);
+        dc_msg_set_text(msg, text.constData());
+        lastDeviceMsgID = dc_add_device_msg(context, NULL, msg);
+        dc_msg_unref(msg);
+    }
+
+    if (lastDeviceMsgID != 0) {
+        dc_msg_t* msg = dc_get_msg(context, lastDeviceMsgID);
+        m_bigChatID = dc_msg_get_chat_id(msg);
+        dc_msg_unref(msg);
+    }
+
+    std::cerr << "Synthetic account created in " << timer.elapsed() << " ms" << std::endl;
+
+    dc_accounts_select_account(accounts, m_accID);
+    dc_context_unref(context);
+    dc_accounts_unref(accounts);
+
+    return m_bigChatID != 0;
+}
+
+
+void ModelBenchmark::measure(const QString &name, int iterations, std::function<void()> setup, std::function<void()> task)
+{
+    std::vector<double> durations;
+    durations.reserve(iterations);
+
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        if (setup) {
+            setup();
+        }
+
+        timer.start();
+        task();
+        durations.push_back(timer.nsecsElapsed() / 1000000.0);
+
+        // let queued signals and fetcher results come in
+        // between the iterations, but outside of the timing
+        QCoreApplication::processEvents();
+    }
+
+    std::vector<double> sorted(durations);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum {0};
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        sum += sorted[i];
+    }
+
+    QJsonObject result;
+    result.insert("name", name);
+    result.insert("iterations", iterations);
+    if (!sorted.empty()) {
+        result.insert("min_ms", sorted.front());
+        result.insert("p50_ms", sorted[sorted.size() / 2]);
+        result.insert("p99_ms", sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))]);
+        result.insert("max_ms", sorted.back());
+        result.insert("mean_ms", sum / sorted.size());
+    }
+    m_results.append(result);
+
+    std::cerr << qPrintable(name) << ": p50 " << (sorted.empty() ? 0 : sorted[sorted.size() / 2]) << " ms" << std::endl;
+}
+
+
+void ModelBenchmark::run()
+{
+    m_dhandler = new DeltaHandler();
+    m_dhandler->loadSelectedAccount();
+
+    if (m_dhandler->m_currentAccID != m_accID) {
+        std::cerr << "Synthetic account was not loaded by DeltaHandler" << std::endl;
+        return;
+    }
+
+    benchRefreshChatlistVector();
+    benchProcessSignalQueue();
+    benchChatModelConfigure();
+    benchChatModelNewMessage();
+    benchChatModelUpdateQuery();
+    benchUpdateContactsArray();
+
+    m_dhandler->shutdownTasks();
+}
+
+
+void ModelBenchmark::benchRefreshChatlistVector()
+{
+    // Alternates between a filtered and the full chatlist, so
+    // each run has to remove or insert lots of rows
+    dc_chatlist_t* chatlist {nullptr};
+    int iteration {0};
+
+    measure("DeltaHandler::refreshChatlistVector", m_params.iterations,
+        [&]() {
+            if (chatlist) {
+                dc_chatlist_unref(chatlist);
+            }
+            const char* query = (iteration++ % 2 == 0) ? "Contact 1" : NULL;
+            chatlist = dc_get_chatlist(m_dhandler->currentContext, 0, query, 0);
+        },
+        [&]() {
+            m_dhandler->refreshChatlistVector(chatlist);
+        });
+
+    if (chatlist) {
+        dc_chatlist_unref(chatlist);
+    }
+}
+
+
+void ModelBenchmark::benchProcessSignalQueue()
+{
+    // As if every chat had received an event
+    measure("DeltaHandler::processSignalQueue", m_params.iterations,
+        [&]() {
+            m_dhandler->m_eventCoalescer.markChatlistChanged(m_accID);
+            m_dhandler->m_eventCoalescer.markFreshMsgCountStale(m_accID);
+            m_dhandler->m_eventCoalescer.markContactRequestChanged(m_accID, 0);
+            for (size_t i = 0; i < m_chatIDs.size(); ++i) {
+                m_dhandler->m_eventCoalescer.markChatChanged(m_accID, m_chatIDs[i]);
+            }
+        },
+        [&]() {
+            m_dhandler->processSignalQueue();
+        });
+}
+
+
+void ModelBenchmark::benchChatModelConfigure()
+{
+    measure("ChatModel::configure", m_params.iterations, nullptr,
+        [&]() {
+            m_dhandler->m_chatmodel->configure(m_bigChatID, m_accID, m_dhandler->allAccounts, std::vector<uint32_t>(), "", "");
+        });
+}
+
+
+void ModelBenchmark::benchChatModelNewMessage()
+{
+    uint32_t msgID {0};
+
+    measure("ChatModel::newMessage", m_params.iterations,
+        [&]() {
+            dc_msg_t* msg = dc_msg_new(m_dhandler->currentContext, DC_MSG_TEXT);
+            dc_msg_set_text(msg, "Additional synthetic device message");
+            msgID = dc_add_device_msg(m_dhandler->currentContext, NULL, msg);
+            dc_msg_unref(msg);
+        },
+        [&]() {
+            m_dhandler->m_chatmodel->newMessage(msgID);
+        });
+}
+
+
+void ModelBenchmark::benchChatModelUpdateQuery()
+{
+    // The search runs in MessageSearchThread, so the time until
+    // the result is there (signalled by searchCountUpdate) is
+    // measured. The debounce timer is skipped.
+    ChatModel* chatmodel = m_dhandler->m_chatmodel;
+    int iteration {0};
+
+    measure("ChatModel::updateQuery (until results)", m_params.iterations, nullptr,
+        [&]() {
+            QEventLoop loop;
+            QMetaObject::Connection connection = QObject::connect(chatmodel, &ChatModel::searchCountUpdate, &loop, &QEventLoop::quit);
+            QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+
+            chatmodel->updateQuery(QString("message ") + QString::number(iteration++));
+            chatmodel->m_searchDebounceTimer->stop();
+            chatmodel->startSearch();
+
+            loop.exec();
+            QObject::disconnect(connection);
+        });
+
+    chatmodel->updateQuery("");
+}
+
+
+void ModelBenchmark::benchUpdateContactsArray()
+{
+    measure("ContactsModel::updateContactsArray", m_params.iterations, nullptr,
+        [&]() {
+            m_dhandler->m_contactsmodel->updateContactsArray();
+        });
+}
+
+
+QJsonObject ModelBenchmark::results() const
+{
+    QJsonObject parameters;
+    parameters.insert("chats", m_params.chats);
+    parameters.insert("contacts", m_params.contacts);
+    parameters.insert("groupSize", m_params.groupSize);
+    parameters.insert("bigChatMessages", m_params.bigChatMessages);
+    parameters.insert("iterations", m_params.iterations);
+
+    QJsonObject root;
+    root.insert("parameters", parameters);
+    root.insert("results", m_results);
+    return root;
+}
+
+
+int main(int argc, char *argv[])
+{
+    // No display needed
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // Everything DeltaHandler writes via QStandardPaths (accounts,
+    // settings, cache) ends up in the temporary dir, so the real
+    // data of the app is never touched
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid()) {
+        std::cerr << "Could not create temporary directory" << std::endl;
+        return 1;
+    }
+    qputenv("XDG_CONFIG_HOME", (tempDir.path() + "/config").toUtf8());
+    qputenv("XDG_DATA_HOME", (tempDir.path() + "/data").toUtf8());
+    qputenv("XDG_CACHE_HOME", (tempDir.path() + "/cache").toUtf8());
+
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("deltatouch-benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark for the DeltaTouch models, prints the results as JSON");
+    parser.addHelpOption();
+    QCommandLineOption chatsOption("chats", "Number of 1:1 chats", "n", "2000");
+    QCommandLineOption contactsOption("contacts", "Number of contacts", "n", "5000");
+    QCommandLineOption groupSizeOption("group-size", "Number of members of the large group", "n", "500");
+    QCommandLineOption messagesOption("messages", "Number of messages in the big chat", "n", "100000");
+    QCommandLineOption iterationsOption("iterations", "Iterations per benchmark", "n", "20");
+    QCommandLineOption outputOption("output", "Write the JSON to this file instead of stdout", "file");
+    parser.addOptions({ chatsOption, contactsOption, groupSizeOption, messagesOption, iterationsOption, outputOption });
+    parser.process(app);
+
+    BenchmarkParameters params;
+    params.chats = parser.value(chatsOption).toInt();
+    params.contacts = parser.value(contactsOption).toInt();
+    params.groupSize = parser.value(groupSizeOption).toInt();
+    params.bigChatMessages = parser.value(messagesOption).toInt();
+    params.iterations = std::max(1, parser.value(iterationsOption).toInt());
+
+    ModelBenchmark benchmark(params);
+
+    // same path as used by DeltaHandler
+    QString accountsDir(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/accounts/");
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation));
+
+    if (!benchmark.createSyntheticAccount(accountsDir)) {
+        std::cerr << "Could not create the synthetic account" << std::endl;
+        return 1;
+    }
+
+    benchmark.run();
+
+    QByteArray json = QJsonDocument(benchmark.results()).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile outputFile(parser.value(outputOption));
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::cerr << "Could not write " << qPrintable(parser.value(outputOption)) << std::endl;
+            return 1;
+        }
+        outputFile.write(json);
+        outputFile.close();
+    } else {
+        std::cout << json.constData() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chatlistfetcherthread.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+ChatlistFetcherThread::ChatlistFetcherThread(dc_jsonrpc_instance_t* jsoninst, std::atomic<bool>* _stopLoop)
+{
+    m_jsonrpcInstance = jsoninst;
+    m_stopLoop = _stopLoop;
+
+    // The responses to blocking calls are returned directly by
+    // dc_jsonrpc_blocking_call() and never show up in
+    // dc_jsonrpc_next_response(), so the ids used here don't
+    // have to be coordinated with the ones of DeltaHandler
+    // or jsonrpc.mjs.
+    m_requestId = 0;
+
+    // needed for queued connections
+    qRegisterMetaType<std::vector<uint32_t>>("std::vector<uint32_t>");
+    qRegisterMetaType<QVector<ChatlistItem>>("QVector<ChatlistItem>");
+}
+
+
+void ChatlistFetcherThread::requestChats(uint32_t accID, const std::vector<uint32_t> &chatIDs)
+{
+    if (chatIDs.empty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_jobMutex);
+    m_jobs.push_back(ChatlistFetchJob { accID, chatIDs });
+    m_jobCondition.wakeOne();
+}
+
+
+void ChatlistFetcherThread::wakeUpForStop()
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_jobCondition.wakeAll();
+}
+
+
+void ChatlistFetcherThread::run()
+{
+    if (!m_jsonrpcInstance) {
+        qDebug() << "ChatlistFetcherThread::run(): Fatal error: No dc_jsonrpc_instance_t defined, could not start loop.";
+        return;
+    }
+
+    while (!(*m_stopLoop)) {
+        std::vector<ChatlistFetchJob> jobs;
+
+        {
+            QMutexLocker locker(&m_jobMutex);
+            while (m_jobs.empty() && !(*m_stopLoop)) {
+                m_jobCondition.wait(&m_jobMutex);
+            }
+            jobs.swap(m_jobs);
+        }
+
+        for (size_t i = 0; i < jobs.size() && !(*m_stopLoop); ++i) {
+            uint32_t accID = jobs[i].accID;
+
+            // Merge all following jobs of the same account into this one
+            // to get only one jsonrpc call per account
+            for (size_t j = i + 1; j < jobs.size(); ++j) {
+                if (jobs[j].accID == accID) {
+                    jobs[i].chatIDs.insert(jobs[i].chatIDs.end(), jobs[j].chatIDs.begin(), jobs[j].chatIDs.end());
+                    jobs[j].chatIDs.clear();
+                }
+            }
+
+            std::vector<uint32_t> &chatIDs = jobs[i].chatIDs;
+            if (chatIDs.empty()) {
+                // was merged into a previous job
+                continue;
+            }
+
+            std::sort(chatIDs.begin(), chatIDs.end());
+            chatIDs.erase(std::unique(chatIDs.begin(), chatIDs.end()), chatIDs.end());
+
+            QString paramString;
+            paramString.setNum(accID);
+            paramString.append(", [");
+            for (size_t k = 0; k < chatIDs.size(); ++k) {
+                if (k != 0) {
+                    paramString.append(", ");
+                }
+                paramString.append(QString::number(chatIDs[k]));
+            }
+            paramString.append("]");
+
+            QByteArray byteArray;
+            {
+                DT_PROFILE_SCOPE("JSON-RPC blocking call (get_chatlist_items_by_entries)");
+                char* tempText = dc_jsonrpc_blocking_call(m_jsonrpcInstance, constructRequestString("get_chatlist_items_by_entries", paramString).toUtf8().constData());
+                byteArray = tempText;
+                dc_str_unref(tempText);
+            }
+
+            // The entries are nested in the response like this:
+            // { .....,"result":{"<chatID>":{ <this is the actual entry> }}}
+            QJsonObject resultObj = QJsonDocument::fromJson(byteArray).object().value("result").toObject();
+
+            QVector<ChatlistItem> chatlistItems;
+            chatlistItems.reserve(resultObj.size());
+
+            for (size_t k = 0; k < chatIDs.size(); ++k) {
+                QJsonObject::const_iterator it = resultObj.constFind(QString::number(chatIDs[k]));
+                if (it == resultObj.constEnd()) {
+                    continue;
+                }
+
+                ChatlistItem tempItem = parseChatlistItem(chatIDs[k], it.value().toObject());
+
+                // The only information not contained in the chatlist entry
+                // is the image of the archive link, so get_basic_chat_info is
+                // only needed for this one
+                if (tempItem.isArchiveLink) {
+                    tempItem.avatarPath = getArchiveLinkImage(accID, chatIDs[k]);
+                }
+
+                chatlistItems.append(tempItem);
+            }
+
+            emit chatlistRowsFetched(accID, chatIDs, chatlistItems);
+        }
+    }
+
+    qDebug() << "ChatlistFetcherThread::run(): Loop terminated";
+}
+
+
+QString ChatlistFetcherThread::constructRequestString(QString method, QString arguments)
+{
+    if (m_requestId == 2147483647) {
+        m_requestId = 0;
+    } else {
+        ++m_requestId;
+    }
+
+    QString requestString("{ \"jsonrpc\": \"2.0\", \"method\": \"");
+    requestString.append(method);
+    requestString.append("\", \"id\": ");
+    requestString.append(QString::number(m_requestId));
+    requestString.append(", \"params\": [");
+    requestString.append(arguments);
+    requestString.append(" ] }");
+
+    return requestString;
+}
+
+
+ChatlistItem ChatlistFetcherThread::parseChatlistItem(uint32_t chatID, const QJsonObject &jsonObj)
+{
+    ChatlistItem tempItem;
+
+    tempItem.chatID = chatID;
+    tempItem.isArchiveLink = (jsonObj.value("kind").toString() == "ArchiveLink");
+    tempItem.name = internString(jsonObj.value("name").toString());
+    // avatarPath is null if there's no avatar, toString()
+    // will return an empty string in this case
+    tempItem.avatarPath = internString(jsonObj.value("avatarPath").toString());
+
+    // color is passed as "#rrggbb"
+    QString tempString = jsonObj.value("color").toString();
+    if (tempString.length() == 7) {
+        tempItem.color = 0xff000000 | tempString.midRef(1).toUInt(nullptr, 16);
+    }
+
+    tempItem.summaryText1 = internString(jsonObj.value("summaryText1").toString());
+    tempItem.summaryText2 = jsonObj.value("summaryText2").toString();
+    tempItem.summaryStatus = jsonObj.value("summaryStatus").toInt();
+    // lastUpdated is in milliseconds and might be null
+    tempItem.lastUpdated = static_cast<int64_t>(jsonObj.value("lastUpdated").toDouble(0)) / 1000;
+    tempItem.freshMessageCounter = jsonObj.value("freshMessageCounter").toInt();
+    tempItem.isProtected = jsonObj.value("isProtected").toBool();
+    tempItem.isMuted = jsonObj.value("isMuted").toBool();
+    tempItem.isPinned = jsonObj.value("isPinned").toBool();
+    tempItem.isArchived = jsonObj.value("isArchived").toBool();
+    tempItem.isContactRequest = jsonObj.value("isContactRequest").toBool();
+
+    return tempItem;
+}
+
+
+QString ChatlistFetcherThread::internString(const QString &str)
+{
+    QSet<QString>::const_iterator it = m_stringPool.constFind(str);
+    if (it != m_stringPool.constEnd()) {
+        return *it;
+    }
+
+    // no need for anything sophisticated here, the
+    // pool will be re-filled by the next fetches
+    if (m_stringPool.size() >= maxStringPoolSize) {
+        m_stringPool.clear();
+    }
+
+    m_stringPool.insert(str);
+    return str;
+}
+
+
+QString ChatlistFetcherThread::getArchiveLinkImage(uint32_t accID, uint32_t chatID)
+{
+    QString paramString;
+    paramString.setNum(accID);
+    paramString.append(", ");
+    paramString.append(QString::number(chatID));
+
+    DT_PROFILE_SCOPE("JSON-RPC blocking call (get_basic_chat_info)");
+
+    char* tempText = dc_jsonrpc_blocking_call(m_jsonrpcInstance, constructRequestString("get_basic_chat_info", paramString).toUtf8().constData());
+    QByteArray byteArray(tempText);
+    dc_str_unref(tempText);
+
+    return internString(QJsonDocument::fromJson(byteArray).object().value("result").toObject().value("profileImage").toString());
+}
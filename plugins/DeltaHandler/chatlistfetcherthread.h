@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHATLISTFETCHERTHREAD_H
+#define CHATLISTFETCHERTHREAD_H
+
+#include <QtCore>
+#include <QtGui>
+#include <atomic>
+#include <vector>
+#include "../deltachat.h"
+
+struct ChatlistFetchJob {
+    uint32_t accID;
+    std::vector<uint32_t> chatIDs;
+};
+
+// One entry of the chatlist as returned by get_chatlist_items_by_entries,
+// parsed once in ChatlistFetcherThread. The values are passed to QML via
+// distinct roles of DeltaHandler. The default values are used as placeholder
+// while the actual entry has not been fetched yet.
+struct ChatlistItem {
+    uint32_t chatID {0};
+    bool isArchiveLink {false};
+    QString name {""};
+    // Empty if there's no avatar. For the archive link, this
+    // is the profile image as returned by get_basic_chat_info.
+    QString avatarPath {""};
+    // as ARGB, so the default value is fully transparent
+    uint32_t color {0};
+    QString summaryText1 {""};
+    QString summaryText2 {""};
+    int summaryStatus {0};
+    // in seconds, 0 if not set
+    int64_t lastUpdated {0};
+    int freshMessageCounter {0};
+    bool isProtected {false};
+    bool isMuted {false};
+    bool isPinned {false};
+    bool isArchived {false};
+    bool isContactRequest {false};
+};
+
+/*
+ * Fetches chatlist entries for DeltaHandler via blocking jsonrpc calls,
+ * but outside of the GUI thread. Jobs are queued via requestChats(), all
+ * jobs that are queued at the time the thread wakes up are merged into a
+ * single get_chatlist_items_by_entries call per account. The results are
+ * passed back to the GUI thread via the signal chatlistRowsFetched().
+ */
+class ChatlistFetcherThread : public QThread {
+    Q_OBJECT
+
+    public:
+        ChatlistFetcherThread(dc_jsonrpc_instance_t* jsoninst, std::atomic<bool>* _stopLoop);
+
+        void run();
+
+        // Can be called from the GUI thread, the chat IDs will be
+        // fetched asynchronously
+        void requestChats(uint32_t accID, const std::vector<uint32_t> &chatIDs);
+
+        // To be called after _stopLoop has been set to true, wakes
+        // up the thread so it can terminate
+        void wakeUpForStop();
+
+    signals:
+        // requestedChatIDs contains all chat IDs of the call, chatlistItems
+        // only the ones that were present in the response
+        void chatlistRowsFetched(uint32_t accID, std::vector<uint32_t> requestedChatIDs, QVector<ChatlistItem> chatlistItems);
+
+    private:
+        dc_jsonrpc_instance_t* m_jsonrpcInstance;
+        std::atomic<bool>* m_stopLoop;
+
+        QMutex m_jobMutex;
+        QWaitCondition m_jobCondition;
+        std::vector<ChatlistFetchJob> m_jobs;
+
+        // Only accessed from within run()
+        uint32_t m_requestId;
+
+        // Names, summaryText1 (mostly the name of the sender) and
+        // avatar paths repeat a lot within the chatlist and over
+        // several fetches, so equal strings share their data via
+        // this pool. Only accessed from within run().
+        QSet<QString> m_stringPool;
+        static constexpr int maxStringPoolSize = 4096;
+        QString internString(const QString &str);
+
+        QString constructRequestString(QString method, QString arguments);
+        ChatlistItem parseChatlistItem(uint32_t chatID, const QJsonObject &jsonObj);
+        QString getArchiveLinkImage(uint32_t accID, uint32_t chatID);
+};
+
+#endif
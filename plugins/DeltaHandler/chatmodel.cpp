@@ -17,38 +17,43 @@
  */
 
 #include "chatmodel.h"
+#include "dataChangedHelper.h"
+#include "profiler.h"
 
 #include <stdio.h> // for remove()
 //#include <unistd.h> // for sleep
-#include <limits> // for invalidating data_row
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 
 #include <QMediaPlayer>
 
 ChatModel::ChatModel(DeltaHandler* dhandler, QObject* parent)
-    : QAbstractListModel(parent), m_dhandler {dhandler}, currentMsgContext {nullptr}, m_chatID {0}, m_chatIsBeingViewed {false}, m_settingDraftTextAllowed {true}, currentMsgCount {0}, currentMessageDraft {nullptr}, m_chatlistmodel {nullptr}, data_row {std::numeric_limits<int>::max()}, data_tempMsg {nullptr}, m_query {""}, oldSearchMsgArray {nullptr}, currentSearchMsgArray {nullptr}, m_webxdcImgProvider {nullptr}
+    : QAbstractListModel(parent), m_dhandler {dhandler}, currentMsgContext {nullptr}, m_chatID {0}, m_chatIsBeingViewed {false}, m_settingDraftTextAllowed {true}, currentMsgCount {0}, m_msgIndexFrontKey {0}, currentMessageDraft {nullptr}, m_chatlistmodel {nullptr}, m_query {""}, m_searchGeneration {0}, m_searchCountTotal {0}, m_searchCountCurrent {0}, m_webxdcImgProvider {nullptr}, m_msgToJumpToChatID {0}, m_msgToJumpToMsgID {0}
 { 
+    // one snapshot has a cost of 1, see getMsgSnapshot()
+    m_msgSnapshotCache.setMaxCost(msgSnapshotCacheSize);
+    m_msgSnapshotSerial = 0;
+
+    m_searchDebounceTimer = new QTimer(this);
+    m_searchDebounceTimer->setSingleShot(true);
+    m_searchDebounceTimer->setInterval(searchDebounceInterval);
+    bool connectSuccess = connect(m_searchDebounceTimer, SIGNAL(timeout()), this, SLOT(startSearch()));
+    if (!connectSuccess) {
+        qFatal("ChatModel::ChatModel(): Could not connect signal timeout of m_searchDebounceTimer to slot startSearch");
+    }
 };
 
 
 ChatModel::~ChatModel()
 {
+    // the snapshots contain dc_msg_t* of currentMsgContext
+    m_msgSnapshotCache.clear();
+
     if (currentMsgContext) {
         dc_context_unref(currentMsgContext);
     }
 
-    if (data_tempMsg) {
-        dc_msg_unref(data_tempMsg);
-    }
-
-    if (oldSearchMsgArray) {
-        dc_array_unref(oldSearchMsgArray);
-    }
-
-    if (currentSearchMsgArray) {
-        dc_array_unref(currentSearchMsgArray);
-    }
-    
     if (currentMessageDraft) {
         dc_msg_unref(currentMessageDraft);
     }
@@ -121,6 +126,8 @@ QHash<int, QByteArray> ChatModel::roleNames() const
 
 QVariant ChatModel::data(const QModelIndex &index, int role) const
 {
+    DT_PROFILE_SCOPE("ChatModel::data");
+
     int row = index.row();
 
     if(row < 0 || row >= currentMsgCount) {
@@ -129,44 +136,32 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
 
     dc_msg_t* tempMsg {nullptr};
     uint32_t tempMsgID {0};
-
-
-    // checking if the cached dc_msg_t* (i.e., data_tempMsg) can be used;
-    // this is the case if row == data_row and data_row != max int
-    if (row != data_row || std::numeric_limits<int>::max() == data_row) {
-        // the cached data_tempMsg cannot be used
-        
-        // don't try to get the msg from DC if it's
-        // the Unread Message bar
-        if (row != m_unreadMessageBarIndex) {
-            tempMsgID = msgVector[row];
-            tempMsg = dc_get_msg(currentMsgContext, tempMsgID);
-
-            if (data_tempMsg) {
-                dc_msg_unref(data_tempMsg);
-                data_tempMsg = nullptr;
+    MsgSnapshot* snapshot {nullptr};
+
+    // don't try to get the msg from DC if it's
+    // the Unread Message bar
+    if (row != m_unreadMessageBarIndex) {
+        tempMsgID = msgVector[row];
+        snapshot = getMsgSnapshot(tempMsgID);
+        tempMsg = snapshot->msg;
+
+        if (roleIsSnapshotted(role)) {
+            QHash<int, QVariant>::const_iterator it = snapshot->roleValues.constFind(role);
+            if (it != snapshot->roleValues.constEnd()) {
+                return it.value();
             }
-
-            data_row = row;
-            data_tempMsgID = tempMsgID;
-            data_tempMsg = tempMsg;
-        } 
-    } else { // row == data_row, so the cached dc_msg_t* is valid
-        tempMsg = data_tempMsg;
-        tempMsgID = data_tempMsgID;
+        }
     }
 
     QString tempQString;
 
-    QString paramString;
-    QString requestString;
-    QByteArray byteArray;
-    QJsonDocument jsonDoc;
     QJsonObject jsonObj;
-    QJsonArray jsonArray;
 
     char* tempText {nullptr};
-    dc_contact_t* tempContact {nullptr};
+    // contact data is taken from the cache shared with the other
+    // models, see roleIsSnapshotted() for why it's not part of
+    // the message snapshot
+    ContactCache* contactCache = m_dhandler->getContactCache();
     uint32_t contactID = 0;
     dc_msg_t* nextMsg {nullptr};
     QDateTime msgDate;
@@ -184,6 +179,8 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
     QString tempQString2;
     
     QVariant retval;
+    // false if retval is only a placeholder
+    bool storeInSnapshot {true};
 
     switch(role) {
         case ChatModel::IsSelfRole:
@@ -332,8 +329,7 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
                     tempQString = "~";
                     tempQString += tempText;
                 } else {
-                    tempText = dc_contact_get_display_name(dc_get_contact(currentMsgContext, dc_msg_get_from_id(nextMsg)));
-                    tempQString = tempText;
+                    tempQString = contactCache->getContact(currentMsgContext, dc_msg_get_from_id(nextMsg)).displayName;
                 }
             } else {
                 tempQString = "";
@@ -347,8 +343,7 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
 
             if (nextMsg) {
                 contactID = dc_msg_get_from_id(nextMsg);
-                tempContact = dc_get_contact(currentMsgContext, contactID);
-                tempColor = dc_contact_get_color(tempContact);
+                tempColor = contactCache->getContact(currentMsgContext, contactID).color;
                 tempQColor = QColor((tempColor >> 16) % 256, (tempColor >> 8) % 256, tempColor % 256, 0);
                 retval = QString(tempQColor.name());
             } else {
@@ -486,9 +481,7 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
 
         case ChatModel::ProfilePicRole:
             contactID = dc_msg_get_from_id(tempMsg);
-            tempContact = dc_get_contact(currentMsgContext, contactID);
-            tempText = dc_contact_get_profile_image(tempContact);
-            tempQString = tempText;
+            tempQString = contactCache->getContact(currentMsgContext, contactID).profileImage;
             // For some reason, the QML part doesn't like the path
             // as given by dc_contact_get_profile_image.
             // The file is located in the config dir, so we remove the
@@ -505,12 +498,13 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
                 retval = false;
             }
             else {
-                // row - 1 corresponds to the next message
-                tempMsgID = msgVector[row - 1];
-                nextMsg = dc_get_msg(currentMsgContext, tempMsgID);
-                if (dc_msg_is_info(nextMsg)) {
+                // row - 1 corresponds to the next message. It's
+                // taken from the cache as well, so nextMsg must not
+                // be set (it would be unref'd below).
+                dc_msg_t* cachedNextMsg = getMsgSnapshot(msgVector[row - 1])->msg;
+                if (dc_msg_is_info(cachedNextMsg)) {
                     retval = false;
-                } else if (dc_msg_get_from_id(nextMsg) == dc_msg_get_from_id(tempMsg)) {
+                } else if (dc_msg_get_from_id(cachedNextMsg) == dc_msg_get_from_id(tempMsg)) {
                     retval = true;
                 } 
                 else {
@@ -545,8 +539,7 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
         case ChatModel::UsernameRole:
             tempText = dc_msg_get_override_sender_name(tempMsg);
             if (!tempText) {
-                tempText = dc_contact_get_display_name(dc_get_contact(currentMsgContext, dc_msg_get_from_id(tempMsg)));
-                tempQString = tempText;
+                tempQString = contactCache->getContact(currentMsgContext, dc_msg_get_from_id(tempMsg)).displayName;
             } else {
                 tempQString = "~";
                 tempQString += tempText;
@@ -670,17 +663,14 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
 
         case ChatModel::AvatarColorRole:
             contactID = dc_msg_get_from_id(tempMsg);
-            tempContact = dc_get_contact(currentMsgContext, contactID);
-            tempColor = dc_contact_get_color(tempContact);
+            tempColor = contactCache->getContact(currentMsgContext, contactID).color;
             tempQColor = QColor((tempColor >> 16) % 256, (tempColor >> 8) % 256, tempColor % 256, 0);
             retval = QString(tempQColor.name());
             break;
 
         case ChatModel::AvatarInitialRole:
             contactID = dc_msg_get_from_id(tempMsg);
-            tempContact = dc_get_contact(currentMsgContext, contactID);
-            tempText = dc_contact_get_display_name(tempContact);
-            tempQString = tempText;
+            tempQString = contactCache->getContact(currentMsgContext, contactID).displayName;
             if (tempQString == "") {
                 tempQString = "#";
             } else {
@@ -690,15 +680,7 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
             break;
 
         case ChatModel::IsSearchResultRole:
-            retval = false;
-            if (currentSearchMsgArray) {
-                for (size_t i = 0; i < dc_array_get_cnt(currentSearchMsgArray); ++i) {
-                    if (tempMsgID == dc_array_get_id(currentSearchMsgArray, i)) {
-                        retval = true;
-                        break;
-                    }
-                }
-            }
+            retval = m_searchResultSet.contains(tempMsgID);
             break;
 
         case ChatModel::ContactIdRole:
@@ -710,86 +692,31 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
             break;
 
         case ChatModel::ReactionsRole:
-            tempQString.setNum(dc_get_id(currentMsgContext));
-            paramString.append(tempQString);
-            paramString.append(", ");
-
-            tempQString.setNum(tempMsgID);
-            paramString.append(tempQString);
-
-            requestString = m_dhandler->constructJsonrpcRequestString("get_message_reactions", paramString);
-
-            // the actual object with the chatlist entry is nested in the
-            // received json like this:
-            // { .....,"result":{ <this is the actual entry> }}
-            // so we extract it
-            byteArray = m_dhandler->sendJsonrpcBlockingCall(requestString).toLocal8Bit();
-            jsonDoc = QJsonDocument::fromJson(byteArray);
-
-            jsonObj = jsonDoc.object();
-            // value() returns a QJsonValue, which we directly
-            // transform back to an object via toObject()
-            jsonObj = jsonObj.value("result").toObject();
-
-            retval = jsonObj;
+            // fetched without blocking, see requestAsyncRole()
+            requestAsyncRole(snapshot, tempMsgID, role);
+            retval = m_lastKnownReactions.value(tempMsgID);
+            storeInSnapshot = false;
             break;
 
         case ChatModel::VcardRole:
             tempText = dc_msg_get_file(tempMsg);
-            tempQString = "\"";
-            tempQString.append(tempText);
-            tempQString.append("\"");
+            tempQString = tempText;
             // If there's no file, tempText will be an empty string (not NULL!).
-            if (tempQString == "\"\"") {
+            if (tempQString == "") {
                 qDebug() << "ChatModel::data(): in VcardRole: Error: dc_msg_get_file() returned empty string";
                 // create our own error message json in the style of dc-jsonrpc
                 jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"no file attached to message\"}}").object();
             } else {
-                // get the Vcard in parsed form to retrieve name, addr + color of contact
-                tempQString = m_dhandler->constructJsonrpcRequestString("parse_vcard", tempQString);
-                byteArray = m_dhandler->sendJsonrpcBlockingCall(tempQString).toLocal8Bit();
-                jsonDoc = QJsonDocument::fromJson(byteArray);
-
-                jsonObj = jsonDoc.object();
-                if (jsonObj.contains("error")) {
-                    jsonObj = jsonObj.value("error").toObject();
-                    qDebug() << "ChatModel::data(): Error parsing vcard: " << jsonObj.value("message").toString();
-                } else {
-                    // "result" is an array in this case, e.g.
-                    //{"id":1000000131,"jsonrpc":"2.0","result":[{"addr":"...",...}]}
-                    if (jsonObj.value("result").isArray()) {
-                        jsonArray = jsonObj.value("result").toArray();
-                        if (jsonArray.count() > 0) {
-                            if (jsonArray.at(0).isObject()) {
-                                jsonObj = jsonArray.at(0).toObject();
-
-                                if (jsonObj.contains("profileImage") && !jsonObj.value("profileImage").isNull()) {
-                                    tempQString = jsonObj.value("profileImage").toString();
-                                    // the image in the vcard is base64 encoded, decode it
-                                    byteArray = QByteArray::fromBase64(tempQString.toLocal8Bit());
-                                } else {
-                                    byteArray.clear();
-                                }
-
-                                tempQString = "image://webxdcImageProvider/";
-                                tempQString.append(m_webxdcImgProvider->getImageId(dc_get_id(currentMsgContext), m_chatID, dc_msg_get_id(tempMsg), byteArray));
-
-                                // for passing the json object to the view/delegate in QML, the
-                                // actual image data is replaced by the path to the imageprovider
-                                jsonObj.insert("profileImage", tempQString);
-                            } else {
-                                qDebug() << "ChatModel::data(): in VcardRole: Error: first element in array of result of jsonrpc call is not an object";
-                                jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"first element in array of result of jsonrpc call is not an object\"}}").object();
-                            }
-                        } else {
-                            qDebug() << "ChatModel::data(): in VcardRole: Error: result of jsonrpc call is an empty array";
-                            jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"result of jsonrpc call is an empty array\"}}").object();
-                        }
-                    } else {
-                        qDebug() << "ChatModel::data(): in VcardRole: Error: result of jsonrpc call is not an array";
-                        jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"result of jsonrpc call is not an array\"}}").object();
-                    }
-                }
+                // get the Vcard in parsed form to retrieve name, addr + color
+                // of contact without blocking, see requestAsyncRole(). Until
+                // then, a placeholder with the values needed by the delegate
+                // is returned.
+                requestAsyncRole(snapshot, tempMsgID, role);
+                jsonObj.insert("displayName", "");
+                jsonObj.insert("addr", "");
+                jsonObj.insert("color", "#00000000");
+                jsonObj.insert("profileImage", "");
+                storeInSnapshot = false;
             }
 
             retval = jsonObj;
@@ -813,11 +740,6 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
             break;
     }
 
-    if (tempContact) {
-        dc_contact_unref(tempContact);
-        tempContact = nullptr;
-    }
-
     if (nextMsg) {
         dc_msg_unref(nextMsg);
         nextMsg = nullptr;
@@ -828,10 +750,193 @@ QVariant ChatModel::data(const QModelIndex &index, int role) const
         tempText = nullptr;
     }
 
+    if (snapshot && storeInSnapshot && roleIsSnapshotted(role)) {
+        snapshot->roleValues.insert(role, retval);
+    }
+
     return retval;
 }
 
 
+MsgSnapshot* ChatModel::getMsgSnapshot(uint32_t msgID) const
+{
+    MsgSnapshot* snapshot = m_msgSnapshotCache.object(msgID);
+
+    if (!snapshot) {
+        // might be nullptr if the message doesn't exist anymore,
+        // the dc_msg_get_* functions can deal with this
+        snapshot = new MsgSnapshot(dc_get_msg(currentMsgContext, msgID));
+        snapshot->serial = ++m_msgSnapshotSerial;
+        // the cache takes ownership of the snapshot
+        m_msgSnapshotCache.insert(msgID, snapshot);
+    }
+
+    return snapshot;
+}
+
+
+void ChatModel::requestAsyncRole(MsgSnapshot* snapshot, uint32_t msgID, int role) const
+{
+    if (snapshot->pendingRoles.contains(role)) {
+        return;
+    }
+
+    QString method;
+    QString paramString;
+    char* tempText {nullptr};
+
+    if (role == ChatModel::ReactionsRole) {
+        method = "get_message_reactions";
+        paramString.setNum(dc_get_id(currentMsgContext));
+        paramString.append(", ");
+        paramString.append(QString::number(msgID));
+    } else if (role == ChatModel::VcardRole) {
+        method = "parse_vcard";
+        tempText = dc_msg_get_file(snapshot->msg);
+        paramString = "\"";
+        paramString.append(tempText);
+        paramString.append("\"");
+        dc_str_unref(tempText);
+    } else {
+        qDebug() << "ChatModel::requestAsyncRole(): Error: role " << role << " cannot be requested";
+        return;
+    }
+
+    snapshot->pendingRoles.insert(role);
+
+    // the callback is not called anymore if the model
+    // is destroyed, and ChatModel lives until the end anyway
+    ChatModel* self = const_cast<ChatModel*>(this);
+    quint64 serial = snapshot->serial;
+
+    m_dhandler->getJsonrpcClient()->request(method, paramString, self, [self, msgID, role, serial](QJsonValue result, QString error) {
+        self->asyncRoleReceived(msgID, role, serial, result, error);
+    });
+}
+
+
+void ChatModel::asyncRoleReceived(uint32_t msgID, int role, quint64 serial, QJsonValue result, QString error)
+{
+    // If the snapshot has been dropped or replaced in the meantime
+    // (e.g., because the message changed), the result might be
+    // outdated. A new request will be sent by data() if needed.
+    MsgSnapshot* snapshot = m_msgSnapshotCache.object(msgID);
+    if (!snapshot || snapshot->serial != serial) {
+        return;
+    }
+
+    snapshot->pendingRoles.remove(role);
+
+    if (role == ChatModel::ReactionsRole) {
+        if (error != "") {
+            // Not stored in the snapshot, so data() requests the
+            // reactions again the next time. The view keeps the
+            // last known ones until then.
+            qDebug() << "ChatModel::asyncRoleReceived(): Error getting reactions: " << error;
+            return;
+        }
+
+        // an empty object means no reactions
+        QJsonObject reactions = result.toObject();
+        if (reactions.isEmpty()) {
+            m_lastKnownReactions.remove(msgID);
+        } else {
+            m_lastKnownReactions.insert(msgID, reactions);
+        }
+        snapshot->roleValues.insert(role, reactions);
+    } else {
+        snapshot->roleValues.insert(role, vcardFromParseResult(snapshot->msg, result, error));
+    }
+
+    int tempIndex = getLoadedIndexOfMsgID(msgID);
+    if (-1 != tempIndex) {
+        QVector<int> roleVector;
+        roleVector.append(role);
+        emit dataChanged(index(tempIndex, 0), index(tempIndex, 0), roleVector);
+    }
+}
+
+
+QJsonObject ChatModel::vcardFromParseResult(dc_msg_t* msg, QJsonValue result, QString error)
+{
+    QJsonObject jsonObj;
+    QJsonArray jsonArray;
+    QString tempQString;
+    QByteArray byteArray;
+
+    if (error != "") {
+        qDebug() << "ChatModel::vcardFromParseResult(): Error parsing vcard: " << error;
+        jsonObj.insert("message", error);
+        return jsonObj;
+    }
+
+    // "result" is an array in this case, e.g.
+    //{"id":1000000131,"jsonrpc":"2.0","result":[{"addr":"...",...}]}
+    if (result.isArray()) {
+        jsonArray = result.toArray();
+        if (jsonArray.count() > 0) {
+            if (jsonArray.at(0).isObject()) {
+                jsonObj = jsonArray.at(0).toObject();
+
+                if (jsonObj.contains("profileImage") && !jsonObj.value("profileImage").isNull()) {
+                    tempQString = jsonObj.value("profileImage").toString();
+                    // the image in the vcard is base64 encoded, decode it
+                    byteArray = QByteArray::fromBase64(tempQString.toLocal8Bit());
+                } else {
+                    byteArray.clear();
+                }
+
+                tempQString = "image://webxdcImageProvider/";
+                tempQString.append(m_webxdcImgProvider->getImageId(dc_get_id(currentMsgContext), m_chatID, dc_msg_get_id(msg), byteArray));
+
+                // for passing the json object to the view/delegate in QML, the
+                // actual image data is replaced by the path to the imageprovider
+                jsonObj.insert("profileImage", tempQString);
+            } else {
+                qDebug() << "ChatModel::vcardFromParseResult(): Error: first element in array of result of jsonrpc call is not an object";
+                jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"first element in array of result of jsonrpc call is not an object\"}}").object();
+            }
+        } else {
+            qDebug() << "ChatModel::vcardFromParseResult(): Error: result of jsonrpc call is an empty array";
+            jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"result of jsonrpc call is an empty array\"}}").object();
+        }
+    } else {
+        qDebug() << "ChatModel::vcardFromParseResult(): Error: result of jsonrpc call is not an array";
+        jsonObj = QJsonDocument::fromJson("{\"error\":{\"message\":\"result of jsonrpc call is not an array\"}}").object();
+    }
+
+    return jsonObj;
+}
+
+
+bool ChatModel::roleIsSnapshotted(int role)
+{
+    switch (role) {
+        // depend on the position in the view
+        case ChatModel::IsUnreadMsgsBarRole:
+        case ChatModel::IsSameSenderAsNextRole:
+        // depends on the search query
+        case ChatModel::IsSearchResultRole:
+        // depends on msgIdsWithExpandedQuote
+        case ChatModel::QuotedTextRole:
+        // depends on the current date
+        case ChatModel::DateRole:
+        // depend on contacts, which can change independently
+        // of the message
+        case ChatModel::ProfilePicRole:
+        case ChatModel::UsernameRole:
+        case ChatModel::AvatarColorRole:
+        case ChatModel::AvatarInitialRole:
+        case ChatModel::QuoteUserRole:
+        case ChatModel::QuoteAvatarColorRole:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+
 // Returns the number of messages in the current chat,
 // the unread message bar (if present) is NOT inlcuded
 // in this number
@@ -896,20 +1001,73 @@ void ChatModel::setMomentaryMessage(int myindex)
 
 void ChatModel::messageStatusChangedSlot(int msgID)
 {
+    // invalidate the snapshot of the message (see ChatModel::data())
+    m_msgSnapshotCache.remove(msgID);
 
-    // invalidate the cached data_tempMsg (see ChatModel::data())
-    data_row = std::numeric_limits<int>::max();
-    if (data_tempMsg) {
-        dc_msg_unref(data_tempMsg);
-        data_tempMsg = nullptr;
+    int tempIndex = getLoadedIndexOfMsgID(msgID);
+    if (-1 != tempIndex) {
+        emit dataChanged(index(tempIndex, 0), index(tempIndex, 0));
     }
+}
 
-    for (size_t i = 0; i < currentMsgCount; ++i) {
-        if (msgID == msgVector[i]) {
-            emit dataChanged(index(i, 0), index(i, 0));
-            break;
+
+void ChatModel::messageSendingStarted(uint32_t accID, uint32_t chatID, quint64 jobID)
+{
+    Q_UNUSED(jobID);
+
+    QString key = QString::number(accID) + "_" + QString::number(chatID);
+    ++m_sendingJobsPerChat[key];
+
+    if (key == m_accIdChatIdKey) {
+        emit sendingInProgressChanged();
+    }
+}
+
+
+void ChatModel::messageSendingFinished(uint32_t accID, uint32_t chatID, quint64 jobID, uint32_t msgID)
+{
+    QString key = QString::number(accID) + "_" + QString::number(chatID);
+    QHash<QString, int>::iterator it = m_sendingJobsPerChat.find(key);
+    if (it != m_sendingJobsPerChat.end()) {
+        --it.value();
+        if (it.value() <= 0) {
+            m_sendingJobsPerChat.erase(it);
+        }
+
+        if (key == m_accIdChatIdKey) {
+            emit sendingInProgressChanged();
         }
     }
+
+    if (0 != msgID) {
+        return;
+    }
+
+    qDebug() << "ChatModel::messageSendingFinished(): ERROR: sending job " << jobID << " for chat " << chatID << " of account " << accID << " failed";
+
+    if (currentMsgContext && dc_get_id(currentMsgContext) == accID) {
+        emit messageSendingFailed(chatID);
+    }
+}
+
+
+void ChatModel::contactsInvalidated(uint32_t accID)
+{
+    if (!m_chatIsBeingViewed || !currentMsgContext || dc_get_id(currentMsgContext) != accID) {
+        return;
+    }
+
+    // Only the roles based on contact data have to be updated,
+    // they are not part of the message snapshots
+    QVector<int> roleVector;
+    roleVector.append(ChatModel::ProfilePicRole);
+    roleVector.append(ChatModel::UsernameRole);
+    roleVector.append(ChatModel::AvatarColorRole);
+    roleVector.append(ChatModel::AvatarInitialRole);
+    roleVector.append(ChatModel::QuoteUserRole);
+    roleVector.append(ChatModel::QuoteAvatarColorRole);
+
+    DataChangedHelper::emitForAllRows(this, roleVector);
 }
 
 
@@ -995,12 +1153,21 @@ void ChatModel::configure(uint32_t cID, uint32_t aID, dc_accounts_t* allAccs, st
     
     msgIdsWithExpandedQuote.clear();
 
-    // invalidate the cached data_tempMsg (see ChatModel::data())
-    data_row = std::numeric_limits<int>::max();
-    if (data_tempMsg) {
-        dc_msg_unref(data_tempMsg);
-        data_tempMsg = nullptr;
-    }
+    // invalidate the cached message snapshots (see ChatModel::data())
+    m_msgSnapshotCache.clear();
+    m_lastKnownReactions.clear();
+
+    // Results of a previous chat are not valid anymore, and a
+    // search that is still running must not show up in this chat.
+    // No dataChanged needed as the model is reset anyway.
+    m_searchDebounceTimer->stop();
+    ++m_searchGeneration;
+    m_query = "";
+    m_searchResults.clear();
+    m_sortedSearchResults.clear();
+    m_searchResultSet.clear();
+    m_searchCountTotal = 0;
+    m_searchCountCurrent = 0;
 
     m_isContactRequest = cIsContactRequest;
 
@@ -1021,45 +1188,72 @@ void ChatModel::configure(uint32_t cID, uint32_t aID, dc_accounts_t* allAccs, st
 
 
     dc_array_t* msgArray = dc_get_chat_msgs(currentMsgContext, m_chatID, 0, 0);
-    currentMsgCount = dc_array_get_cnt(msgArray);
-
-    // When a chat is selected from the chat list, its existing
-    // messages are obtained via dc_get_chat_msgs and copied into the
-    // private member msgVector. When new messages arrive, msgVector
-    // is updated, see newMessage(). 
-    //
-    // msgVector will be re-initialized upon entering a new chat by
-    // sizing it accordingly and copying all msgIDs.
-    msgVector.resize(currentMsgCount);
+    size_t totalMsgCount = dc_array_get_cnt(msgArray);
 
     m_hasUnreadMessages = false;
 
     m_unreadMessageBarIndex = -1;
 
+    // Go through all messages from the oldest to the newest
+    // to check for the first unread message, but only if it's
+    // not a contact request, because then the messages will only
+    // be marked seen if the request is accepted
+    size_t firstUnreadPos = totalMsgCount;
+    if (!m_isContactRequest && !unreadMsgs.empty()) {
+        std::vector<uint32_t> sortedUnreadMsgs = unreadMsgs;
+        std::sort(sortedUnreadMsgs.begin(), sortedUnreadMsgs.end());
+
+        for (size_t i = 0; i < totalMsgCount; ++i) {
+            uint32_t tempMsgID = dc_array_get_id(msgArray, i);
+            if (std::binary_search(sortedUnreadMsgs.begin(), sortedUnreadMsgs.end(), tempMsgID)) {
+                m_hasUnreadMessages = true;
+                firstUnreadPos = i;
+
+                // needed to re-create the Unread Message bar in newMessage()
+                m_firstUnreadMessageID = tempMsgID;
+                break;
+            }
+        }
+    }
+
+    // When a chat is selected from the chat list, its existing
+    // messages are obtained via dc_get_chat_msgs. Only the newest
+    // msgPageSize messages are copied into the private member
+    // msgVector, the older ones are put into m_olderMsgIDs and
+    // will be passed to the view page by page via fetchMore().
+    // If there are unread messages, all of them are loaded right
+    // away because the view will jump to the Unread Message bar.
+    // When new messages arrive, msgVector is updated, see
+    // newMessage().
+    size_t windowSize = msgPageSize;
+    if (m_hasUnreadMessages && totalMsgCount - firstUnreadPos > windowSize) {
+        windowSize = totalMsgCount - firstUnreadPos;
+    }
+    if (windowSize > totalMsgCount) {
+        windowSize = totalMsgCount;
+    }
+    size_t firstInWindow = totalMsgCount - windowSize;
+
+    m_olderMsgIDs.resize(firstInWindow);
+    for (size_t i = 0; i < firstInWindow; ++i) {
+        m_olderMsgIDs[i] = dc_array_get_id(msgArray, i);
+    }
+    rebuildOlderMsgPosHash();
+
+    currentMsgCount = windowSize;
+    msgVector.resize(currentMsgCount);
+
     // For the view to show the most recent message at the bottom
     // without going through the whole list of messages,
     // verticalLayoutDirection is set to ListView.BottomToTop. Thus,
     // the most recent message has the index 0 in the view, so we have
     // to reverse the order.
     for (size_t i = 0; i < currentMsgCount; ++i) {
-        msgVector[currentMsgCount - (i + 1)] = dc_array_get_id(msgArray, i);
-
-        // go through all messages from the oldest to the newest
-        // to check for the first unread message, but only if it's
-        // not a contact request, because then the messages will only
-        // be marked seen if the request is accepted
-        if (!m_hasUnreadMessages && !m_isContactRequest) {
-            for (size_t j = 0; j < unreadMsgs.size(); ++j) {
-                if (unreadMsgs[j] == msgVector[currentMsgCount - (i + 1)]) {
-                    m_hasUnreadMessages = true;
-                    m_unreadMessageBarIndex = currentMsgCount - (i + 1);
-
-                    // needed to re-create the Unread Message bar in newMessage()
-                    m_firstUnreadMessageID = msgVector[currentMsgCount - (i + 1)];
-                    break;
-                }
-            }
-        }
+        msgVector[currentMsgCount - (i + 1)] = dc_array_get_id(msgArray, firstInWindow + i);
+    }
+
+    if (m_hasUnreadMessages) {
+        m_unreadMessageBarIndex = totalMsgCount - (firstUnreadPos + 1);
     }
 
     // Marking all unread messages of this chat as seen if it's not a
@@ -1095,6 +1289,8 @@ void ChatModel::configure(uint32_t cID, uint32_t aID, dc_accounts_t* allAccs, st
         ++currentMsgCount;
     }
 
+    rebuildMsgIndex();
+
     dc_array_unref(msgArray);
 
     // If in two-column mode, ChatModel::configure is called repeatedly without
@@ -1199,6 +1395,7 @@ void ChatModel::configure(uint32_t cID, uint32_t aID, dc_accounts_t* allAccs, st
     }
     
     emit newChatConfigured(m_chatID);
+    emit sendingInProgressChanged();
 }
 
 
@@ -1211,9 +1408,13 @@ bool ChatModel::chatIsContactRequest()
 void ChatModel::acceptChat() {
     m_isContactRequest = false;
 
-    // mark message(s) seen
-    for (size_t i = 0; i < currentMsgCount; ++i) {
-        dc_markseen_msgs(currentMsgContext, msgVector.data() + i, 1);
+    // mark message(s) seen, one call each as m_olderMsgIDs
+    // can contain the whole history of the chat
+    if (currentMsgCount > 0) {
+        dc_markseen_msgs(currentMsgContext, msgVector.data(), static_cast<int>(currentMsgCount));
+    }
+    if (!m_olderMsgIDs.empty()) {
+        dc_markseen_msgs(currentMsgContext, m_olderMsgIDs.data(), static_cast<int>(m_olderMsgIDs.size()));
     }
     emit markedAllMessagesSeen();
 
@@ -1227,23 +1428,188 @@ void ChatModel::acceptChat() {
 // incoming messages, but it shouldn't be too costly.
 void ChatModel::newMessage(int msgID)
 {
-    // invalidate the cached data_tempMsg
-    data_row = std::numeric_limits<int>::max();
-    if (data_tempMsg) {
-        dc_msg_unref(data_tempMsg);
-        data_tempMsg = nullptr;
+    DT_PROFILE_SCOPE("ChatModel::newMessage");
+
+    // invalidate the cached snapshot(s) (see ChatModel::data()),
+    // 0 means that any message of the chat might have changed
+    if (0 == msgID) {
+        m_msgSnapshotCache.clear();
+    } else {
+        m_msgSnapshotCache.remove(msgID);
+    }
+
+    // Re-reading all message IDs of the chat via dc_get_chat_msgs()
+    // gets expensive for long chats. In most cases, this is not needed
+    // because msgID is either a message we already know (changed
+    // state, finished download etc.) or a new message that is
+    // newer than all the others. Only if msgID is 0 (which is the
+    // case for deleted messages, among others) or if the message
+    // cannot be handled otherwise, the messages are re-synced.
+    bool needsResync {false};
+
+    if (0 == msgID) {
+        needsResync = true;
+    } else if (-1 != getLoadedIndexOfMsgID(msgID) || m_olderMsgPosHash.contains(msgID)) {
+        // Deleted messages are moved to the trash chat
+        dc_msg_t* tempMsg = dc_get_msg(currentMsgContext, msgID);
+        if (!tempMsg || dc_msg_get_chat_id(tempMsg) != m_chatID) {
+            needsResync = true;
+        }
+        if (tempMsg) {
+            dc_msg_unref(tempMsg);
+        }
+    } else {
+        needsResync = !insertNewestMessage(msgID);
+    }
+
+    if (needsResync) {
+        resyncMessages();
     }
 
+    // The event DC_EVENT_MSGS_CHANGED, which eventually leads to the
+    // execution of this method here, is also created if a partly
+    // downloaded message has been fully downloaded.  Thus, data_changed
+    // has to be emitted, either for the specific message ID (if > 0) or
+    // for all of them. The model is not reset because this would be
+    // problematic if the current view is not at the bottom, but
+    // scrolled somewhere
+    if (0 == msgID) {
+        DataChangedHelper::emitForAllRows(this);
+    } else {
+        // mark new message as seen, but only if it is present in msgVector (it might
+        // not be if it was a message draft that has been deleted)
+        int i = getLoadedIndexOfMsgID(msgID);
+        if (-1 != i) {
+            // It's not always a new message that is passed as parameter - take care to only mark new ones as seen
+            dc_msg_t* tempMsg = dc_get_msg(currentMsgContext, msgID);
+            if (tempMsg) {
+                if (dc_msg_get_state(tempMsg) != DC_STATE_IN_SEEN && !(dc_msg_get_from_id(tempMsg) == DC_CONTACT_ID_SELF)) {
+                    const uint32_t tempMsgID = msgID;
+                    // only mark seen + remove the notification if the app is not 
+                    // in background
+                    if (QGuiApplication::applicationState() == Qt::ApplicationActive) {
+                        dc_markseen_msgs(currentMsgContext, &tempMsgID, 1);
+                        emit markedAllMessagesSeen();
+                    } else {
+                        msgsToMarkSeenLater.push_back(tempMsgID);
+                    }
+                }
+                dc_msg_unref(tempMsg);
+            }
+
+            // notify view. The message above might have to change
+            // its appearance as well (edge of speech bubble, avatar)
+            if (static_cast<size_t>(i) + 1 < currentMsgCount) {
+                emit QAbstractItemModel::dataChanged(index(i, 0), index(i + 1, 0));
+            } else {
+                emit QAbstractItemModel::dataChanged(index(i, 0), index(i, 0));
+            }
+        }
+    }
+
+    emit chatDataChanged();
+}
+
+bool ChatModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return false;
+    }
+
+    return !m_olderMsgIDs.empty();
+}
+
+
+void ChatModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    loadOlderMessages(msgPageSize);
+}
+
+
+void ChatModel::loadOlderMessages(size_t count)
+{
+    if (count > m_olderMsgIDs.size()) {
+        count = m_olderMsgIDs.size();
+    }
+
+    if (0 == count) {
+        return;
+    }
+
+    // The oldest message has the highest index, so the older messages
+    // are appended to the end of msgVector, the indices of the rows
+    // already in the view don't change.
+    beginInsertRows(QModelIndex(), currentMsgCount, currentMsgCount + count - 1);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t tempMsgID = m_olderMsgIDs.back();
+        m_olderMsgIDs.pop_back();
+        m_olderMsgPosHash.remove(tempMsgID);
+
+        m_msgIndexHash.insert(tempMsgID, m_msgIndexFrontKey + msgVector.size());
+        msgVector.push_back(tempMsgID);
+    }
+    currentMsgCount += count;
+    endInsertRows();
+}
+
+
+void ChatModel::resyncMessages()
+{
     dc_array_t* newMsgArray = dc_get_chat_msgs(currentMsgContext, m_chatID, 0, 0);
-    size_t newMsgCount = dc_array_get_cnt(newMsgArray);
+    size_t newTotalCount = dc_array_get_cnt(newMsgArray);
+
+    // Only the messages newer than the oldest one in msgVector are
+    // compared to msgVector below, all older ones just replace the
+    // content of m_olderMsgIDs. If the oldest loaded message is not
+    // present anymore, the number of loaded messages is kept.
+    uint32_t oldestLoadedMsgID {0};
+    for (size_t i = currentMsgCount; i > 0; --i) {
+        if (0 != msgVector[i - 1]) {
+            oldestLoadedMsgID = msgVector[i - 1];
+            break;
+        }
+    }
+
+    size_t loadedCount = currentMsgCount;
+    if (-1 != m_unreadMessageBarIndex) {
+        --loadedCount;
+    }
+    if (loadedCount < msgPageSize) {
+        loadedCount = msgPageSize;
+    }
+    if (loadedCount > newTotalCount) {
+        loadedCount = newTotalCount;
+    }
+    size_t firstInWindow = newTotalCount - loadedCount;
+
+    if (0 != oldestLoadedMsgID) {
+        // the loaded messages are the newest ones, so search from the end
+        for (size_t i = newTotalCount; i > 0; --i) {
+            if (oldestLoadedMsgID == dc_array_get_id(newMsgArray, i - 1)) {
+                firstInWindow = i - 1;
+                break;
+            }
+        }
+    }
+
+    m_olderMsgIDs.resize(firstInWindow);
+    for (size_t i = 0; i < firstInWindow; ++i) {
+        m_olderMsgIDs[i] = dc_array_get_id(newMsgArray, i);
+    }
+    rebuildOlderMsgPosHash();
+
+    size_t newMsgCount = newTotalCount - firstInWindow;
 
     // idea for algorithm taken from kdeltachat, see
     // https://git.sr.ht/~link2xt/kdeltachat/tree/master
     for (size_t i = 0; i < newMsgCount; ++i) {
         size_t j;
         // reverse access the array
-        uint32_t tempNewMsgID = dc_array_get_id(newMsgArray, (newMsgCount - 1) - i);
-
+        uint32_t tempNewMsgID = dc_array_get_id(newMsgArray, (newTotalCount - 1) - i);
         for (j = i; j < currentMsgCount; ++j) {
             if (tempNewMsgID == msgVector[j]) {
                 if (j != i) {
@@ -1304,57 +1670,71 @@ void ChatModel::newMessage(int msgID)
         }
     }
 
+    rebuildMsgIndex();
+
     dc_array_unref(newMsgArray);
+}
 
-    // The event DC_EVENT_MSGS_CHANGED, which eventually leads to the
-    // execution of this method here, is also created if a partly
-    // downloaded message has been fully downloaded.  Thus, data_changed
-    // has to be emitted, either for the specific message ID (if > 0) or
-    // for all of them. The model is not reset because this would be
-    // problematic if the current view is not at the bottom, but
-    // scrolled somewhere
-    if (0 == msgID) {
-        for (size_t i = 0; i < currentMsgCount ; ++i) {
-            emit QAbstractItemModel::dataChanged(index(i, 0), index(i, 0));
-        }
-    } else {
-        for (size_t i = 0; i < currentMsgCount ; ++i) {
-            if (msgVector[i] == msgID) {
-                // mark new message as seen, but only if it is present in msgVector (it might
-                // not be if it was a message draft that has been deleted)
-                // It's not always a new message that is passed as parameter - take care to only mark new ones as seen
-                dc_msg_t* tempMsg = dc_get_msg(currentMsgContext, msgID);
-                if (tempMsg) {
-                    if (dc_msg_get_state(tempMsg) != DC_STATE_IN_SEEN && !(dc_msg_get_from_id(tempMsg) == DC_CONTACT_ID_SELF)) {
-                        const uint32_t tempMsgID = msgID;
-                        // only mark seen + remove the notification if the app is not 
-                        // in background
-                        if (QGuiApplication::applicationState() == Qt::ApplicationActive) {
-                            dc_markseen_msgs(currentMsgContext, &tempMsgID, 1);
-                            emit markedAllMessagesSeen();
-                        } else {
-                            msgsToMarkSeenLater.push_back(tempMsgID);
-                        }
-                    }
-                    dc_msg_unref(tempMsg);
-                }
 
-                // notify view
-                emit QAbstractItemModel::dataChanged(index(i, 0), index(i, 0));
+bool ChatModel::insertNewestMessage(uint32_t msgID)
+{
+    dc_msg_t* tempMsg = dc_get_msg(currentMsgContext, msgID);
+    if (!tempMsg) {
+        return false;
+    }
 
-                // the message above might have to change its appearance (edge
-                // of speech bubble, avatar)
-                if (i + 1 < currentMsgCount) {
-                    emit QAbstractItemModel::dataChanged(index(i + 1, 0), index(i + 1, 0));
-                }
-                break;
-            }
+    if (dc_msg_get_chat_id(tempMsg) != m_chatID || dc_msg_get_state(tempMsg) == DC_STATE_OUT_DRAFT) {
+        // not returned by dc_get_chat_msgs() for this chat,
+        // so there's nothing to do
+        dc_msg_unref(tempMsg);
+        return true;
+    }
+
+    int64_t tempSortTimestamp = dc_msg_get_sort_timestamp(tempMsg);
+    dc_msg_unref(tempMsg);
+
+    // The core sorts by timestamp, then by ID. msgVector[0] is the
+    // newest message (the Unread Message bar can't be at index 0).
+    if (currentMsgCount > 0) {
+        dc_msg_t* newestMsg = dc_get_msg(currentMsgContext, msgVector[0]);
+        if (!newestMsg) {
+            return false;
+        }
+        int64_t newestSortTimestamp = dc_msg_get_sort_timestamp(newestMsg);
+        dc_msg_unref(newestMsg);
+
+        if (tempSortTimestamp < newestSortTimestamp || (tempSortTimestamp == newestSortTimestamp && msgID < msgVector[0])) {
+            return false;
         }
     }
 
-    emit chatDataChanged();
+    // Hidden messages are not returned by dc_get_chat_msgs(), but
+    // can't be recognized via the C API. dc_get_msg_cnt() counts the
+    // same messages as dc_get_chat_msgs() returns, but is way cheaper,
+    // so it's used to check whether the new message is the only
+    // one that's missing.
+    size_t knownMsgCount = m_olderMsgIDs.size() + currentMsgCount;
+    if (-1 != m_unreadMessageBarIndex) {
+        --knownMsgCount;
+    }
+    if (static_cast<size_t>(dc_get_msg_cnt(currentMsgContext, m_chatID)) != knownMsgCount + 1) {
+        return false;
+    }
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    msgVector.insert(msgVector.begin(), msgID);
+    --m_msgIndexFrontKey;
+    m_msgIndexHash.insert(msgID, m_msgIndexFrontKey);
+    ++currentMsgCount;
+    if (-1 != m_unreadMessageBarIndex) {
+        ++m_unreadMessageBarIndex;
+    }
+    endInsertRows();
+
+    return true;
 }
 
+
 void ChatModel::deleteMomentaryMessage()
 {
     dc_delete_msgs(currentMsgContext, &m_MomentaryMsgId, 1);
@@ -1431,6 +1811,9 @@ void ChatModel::deleteAllMessagesInCurrentChat()
         tempVector.erase(it + m_unreadMessageBarIndex);
     }
 
+    // messages that have not been passed to the view yet
+    tempVector.insert(tempVector.end(), m_olderMsgIDs.begin(), m_olderMsgIDs.end());
+
     dc_delete_msgs(currentMsgContext, tempVector.data(), tempVector.size());
 }
 
@@ -2498,15 +2881,11 @@ void ChatModel::initiateQuotedMsgJump(int myindex)
             qDebug() << "ChatModel::initiateQuotedMsgJump: Message to jump to is in different chat";
             toggleQuoteExpandedState = true;
         } else {
-            uint32_t quotedMsgID = dc_msg_get_id(quotedMsg);
-            size_t i {0};
-            for (i = 0; i < currentMsgCount; ++i) {
-                if (msgVector[i] == quotedMsgID) {
-                    emit jumpToMsg(i);
-                    break;
-                }
-            } // end for
-            if (i == currentMsgCount) {
+            // loads older messages if needed
+            int quotedIndex = getIndexOfMsgID(dc_msg_get_id(quotedMsg));
+            if (-1 != quotedIndex) {
+                emit jumpToMsg(quotedIndex);
+            } else {
                 qDebug() << "ChatModel::initiateQuotedMsgJump: Could not find quoted message in the message list";
                 toggleQuoteExpandedState = true;
             }
@@ -2539,6 +2918,38 @@ void ChatModel::initiateQuotedMsgJump(int myindex)
 }
 
 
+void ChatModel::setMsgToJumpTo(uint32_t chatID, uint32_t msgID)
+{
+    m_msgToJumpToChatID = chatID;
+    m_msgToJumpToMsgID = msgID;
+}
+
+
+bool ChatModel::hasMsgToJumpTo()
+{
+    return m_msgToJumpToMsgID != 0 && m_msgToJumpToChatID == m_chatID;
+}
+
+
+int ChatModel::takeMsgToJumpToIndex()
+{
+    int retval {-1};
+
+    if (hasMsgToJumpTo()) {
+        // loads older messages if needed
+        retval = getIndexOfMsgID(m_msgToJumpToMsgID);
+        if (-1 == retval) {
+            qDebug() << "ChatModel::takeMsgToJumpToIndex: Could not find message " << m_msgToJumpToMsgID << " in the message list";
+        }
+    }
+
+    m_msgToJumpToChatID = 0;
+    m_msgToJumpToMsgID = 0;
+
+    return retval;
+}
+
+
 bool ChatModel::toggleQuoteVectorContainsId(const uint32_t tempID) const
 {
     bool found = false;
@@ -2876,14 +3287,7 @@ void ChatModel::checkAndJumpToWebxdcParent(int myindex)
 
                 // should be size_t, but the jump signal has an int
                 // parameter anyway
-                int parentIndex {-1};
-
-                for (size_t i = 0; i < msgVector.size(); ++i) {
-                    if (msgVector[i] == parentID) {
-                        parentIndex = static_cast<int>(i);
-                        break;
-                    }
-                }
+                int parentIndex = getIndexOfMsgID(parentID);
 
                 if (parentIndex > 0) {
                     emit jumpToMsg(parentIndex);
@@ -2941,9 +3345,11 @@ void ChatModel::sendMessage(QString messageText, int accID, int chatID, int curs
 
     dc_msg_set_text(currentMessageDraft, messageText.toUtf8().constData());
 
-    dc_send_msg(currentMsgContext, m_chatID, currentMessageDraft);
-
-    dc_msg_unref(currentMessageDraft);
+    // dc_send_msg() may take a while for attachments as the file is
+    // copied by the core, so sending is done by a separate thread,
+    // which takes ownership of the draft. The message will appear
+    // in the view via newMessage() as usual once it has been sent.
+    m_dhandler->getMessageSendThread()->queueMessage(dc_get_id(currentMsgContext), m_chatID, currentMessageDraft);
     currentMessageDraft = nullptr;
 
     // TODO: really needed to inform that the quote has changed? Maybe
@@ -2984,6 +3390,12 @@ bool ChatModel::draftHasQuote()
 }
 
 
+bool ChatModel::sendingInProgress() const
+{
+    return m_sendingJobsPerChat.contains(m_accIdChatIdKey);
+}
+
+
 bool ChatModel::draftHasAttachment()
 {
     bool retval;
@@ -3040,170 +3452,94 @@ void ChatModel::updateQuery(QString query)
         return;
     }
 
-    // is used multiple times below for dataChanged()
-    QVector<int> roleVector;
-    roleVector.append(ChatModel::IsSearchResultRole);
+    m_query = query;
+
+    if (query == "") {
+        // Search string has been cleared. Cancel a search that
+        // is waiting for the timer or still running, and unset
+        // the previous results right away.
+        m_searchDebounceTimer->stop();
+        ++m_searchGeneration;
+        setSearchResults(std::vector<uint32_t>());
+        return;
+    }
 
-    if (oldSearchMsgArray) {
-        dc_array_unref(oldSearchMsgArray);
+    // Don't search for each typed character, wait until
+    // the user paused typing
+    m_searchDebounceTimer->start();
+}
+
+
+void ChatModel::startSearch()
+{
+    if (!currentMsgContext || m_query == "") {
+        return;
     }
-    oldSearchMsgArray = currentSearchMsgArray;
 
-    m_query = query;
+    ++m_searchGeneration;
+    m_dhandler->getMessageSearchThread()->search(m_searchGeneration, dc_get_id(currentMsgContext), m_chatID, m_query);
+}
 
-    if (query == "") {
-        // have to set currentSearchMsgArray to nullptr
-        // before emitting dataChanged() (but NOT
-        // unref it as it points to the same address
-        // as oldSearchMsgArray!)
-        currentSearchMsgArray = nullptr;
-
-        if (oldSearchMsgArray) {
-            // Situation: Search string has been cleared,
-            // but previously, there were search results.
-            // We have to invalidate them.
-            for (size_t i = 0; i < dc_array_get_cnt(oldSearchMsgArray); ++i) {
-                uint32_t tempOldID = dc_array_get_id(oldSearchMsgArray, i);
-                for (size_t j = 0; j < currentMsgCount; ++j) {
-                    if (tempOldID == msgVector[j]) {
-                        emit dataChanged(index(j, 0), index(j, 0), roleVector);
-                        break;
-                    }
-                }
-            }
-            dc_array_unref(oldSearchMsgArray);
-            oldSearchMsgArray = nullptr;
-        }
+
+void ChatModel::searchFinished(quint64 generation, uint32_t accID, uint32_t chatID, std::vector<uint32_t> msgIDs)
+{
+    // results of a superseded search, or of a chat that
+    // is not shown anymore
+    if (generation != m_searchGeneration || !currentMsgContext || accID != dc_get_id(currentMsgContext) || chatID != m_chatID) {
         return;
-    } 
-    
-    // query contains a string, otherwise the method would
-    // have returned above
+    }
+
+    setSearchResults(msgIDs);
 
-    // must not unref currentSearchMsgArray here as it has been
-    // copied to oldSearchMsgArray
-    currentSearchMsgArray = dc_search_msgs(currentMsgContext, m_chatID, m_query.toUtf8().constData());
-    m_searchCountTotal = dc_array_get_cnt(currentSearchMsgArray);
     if (m_searchCountTotal > 0) {
         m_searchCountCurrent = m_searchCountTotal - 1;
         emit searchCountUpdate(m_searchCountCurrent + 1, m_searchCountTotal);
-        int tempIndex = getIndexOfMsgID(dc_array_get_id(currentSearchMsgArray, m_searchCountCurrent));
+        int tempIndex = getIndexOfMsgID(m_searchResults[m_searchCountCurrent]);
         emit jumpToMsg(tempIndex);
     } else {
         emit searchCountUpdate(0, 0);
     }
+}
 
-    if (!currentSearchMsgArray) {
-        // currentSearchMsgArray == NULL => no results found
-        if (oldSearchMsgArray) {
-            // Situation: new search string did not give any results,
-            // but the one before had results.
-            //
-            // This means that at the moment, the msgIDs in
-            // oldSearchMsgArray are shown as search results in the
-            // ChatView => get the index of each msgID and emit
-            // dataChanged() so the messages are not shown as matching the
-            // search anymore
-            for (size_t i = 0; i < dc_array_get_cnt(oldSearchMsgArray); ++i) {
-                uint32_t tempOldID = dc_array_get_id(oldSearchMsgArray, i);
-                for (size_t j = 0; j < currentMsgCount; ++j) {
-                    if (tempOldID == msgVector[j]) {
-                        emit dataChanged(index(j, 0), index(j, 0), roleVector);
-                        break;
-                    }
-                }
-            } // end getting the index of each msgID and emitting dataChanged()
 
-            // TODO: handle search counter, tell the ChatView that no
-            // messages match the search string
+void ChatModel::setSearchResults(const std::vector<uint32_t> &msgIDs)
+{
+    std::vector<uint32_t> sortedIDs(msgIDs);
+    std::sort(sortedIDs.begin(), sortedIDs.end());
+
+    // Only the messages that were a result before, but not anymore,
+    // and vice versa have to be updated. It is not guaranteed that the
+    // new results are a subset of the previous ones - the user might
+    // have entered something in the middle of the previous string, or
+    // something from the previous string might have been deleted.
+    std::vector<uint32_t> changedIDs;
+    std::set_symmetric_difference(m_sortedSearchResults.begin(), m_sortedSearchResults.end(), sortedIDs.begin(), sortedIDs.end(), std::back_inserter(changedIDs));
 
-            // all done, return
-            return; 
-        } else {
-            // Situation: neither old nor new search gave any results,
-            // nothing to do, the method can return
-            return;
-        }
-    } else {
-        // results were found, currentSearchMsgArray is not empty
-        if (oldSearchMsgArray) {
-            // Situation: There are  current search results and previous
-            // search results. We have to unset all previous results
-            // that are not in the list of the current ones, and vice
-            // versa. Note that it is not guaranteed that the current
-            // search results are a subset of the previous ones - the
-            // user might have entered something in the middle of the
-            // previous string, or something from the previous string
-            // might have been deleted.
-            //
-            // All msgIDs that are part of the previous search, but not
-            // of this one have to be unset, and the new ones that are
-            // not in the previous set have to be marked.
-
-            // First, check for message IDs that are only in the old
-            // array:
-            for (size_t i = 0; i < dc_array_get_cnt(oldSearchMsgArray); ++i) {
-                uint32_t tempOldID = dc_array_get_id(oldSearchMsgArray, i);
-                size_t j;
-                for (j = 0; j < dc_array_get_cnt(currentSearchMsgArray); ++j) {
-                    uint32_t tempNewID = dc_array_get_id(currentSearchMsgArray, j);
-                    if (tempOldID == tempNewID) {
-                        break;
-                    }
-                }
-                if (j == dc_array_get_cnt(currentSearchMsgArray)) {
-                    // if we're here it means that index i of
-                    // oldSearchMsgArray is not in
-                    // currentSearchMsgArray, so we have to
-                    // emit dataChanged(). For this, the index
-                    // of the tempOldID has to be obtained:
-                    for (size_t k = 0; k < currentMsgCount; ++k) {
-                        if (tempOldID == msgVector[k]) {
-                            emit dataChanged(index(k, 0), index(k, 0), roleVector);
-                            break;
-                        }
-                    }
-                }
-            }
-            // now check for messages that are only in the new array
-            for (size_t i = 0; i < dc_array_get_cnt(currentSearchMsgArray); ++i) {
-                uint32_t tempNewID = dc_array_get_id(currentSearchMsgArray, i);
-                size_t j;
-                for (j = 0; j < dc_array_get_cnt(oldSearchMsgArray); ++j) {
-                    uint32_t tempOldID = dc_array_get_id(oldSearchMsgArray, j);
-                    if (tempOldID == tempNewID) {
-                        break;
-                    }
-                }
-                if (j == dc_array_get_cnt(oldSearchMsgArray)) {
-                    // if we're here it means that index i of
-                    // currentSearchMsgArray is not in
-                    // oldSearchMsgArray, so we have to
-                    // emit dataChanged(). For this, the index
-                    // of the tempNewID has to be obtained:
-                    for (size_t k = 0; k < currentMsgCount; ++k) {
-                        if (tempNewID == msgVector[k]) {
-                            emit dataChanged(index(k, 0), index(k, 0), roleVector);
-                            break;
-                        }
-                    }
-                }
-            }
-        } else {
-            // Situation: we have new search results, but no old ones,
-            // so we just have to mark all IDs in the
-            // currentSearchMsgArray
-            for (size_t i = 0; i < dc_array_get_cnt(currentSearchMsgArray); ++i) {
-                uint32_t tempNewID = dc_array_get_id(currentSearchMsgArray, i);
-                for (size_t j = 0; j < currentMsgCount; ++j) {
-                    if (tempNewID == msgVector[j]) {
-                        emit dataChanged(index(j, 0), index(j, 0), roleVector);
-                        break;
-                    }
-                }
-            }
+    m_searchResults = msgIDs;
+    m_sortedSearchResults.swap(sortedIDs);
+
+    m_searchResultSet.clear();
+    m_searchResultSet.reserve(static_cast<int>(m_searchResults.size()));
+    for (size_t i = 0; i < m_searchResults.size(); ++i) {
+        m_searchResultSet.insert(m_searchResults[i]);
+    }
+
+    m_searchCountTotal = static_cast<int>(m_searchResults.size());
+    m_searchCountCurrent = 0;
+
+    // messages that are not loaded yet don't need to be updated
+    std::vector<int> changedRows;
+    changedRows.reserve(changedIDs.size());
+    for (size_t i = 0; i < changedIDs.size(); ++i) {
+        int tempIndex = getLoadedIndexOfMsgID(changedIDs[i]);
+        if (-1 != tempIndex) {
+            changedRows.push_back(tempIndex);
         }
     }
+
+    QVector<int> roleVector;
+    roleVector.append(ChatModel::IsSearchResultRole);
+    DataChangedHelper::emitForRows(this, changedRows, roleVector);
 }
 
 
@@ -3216,7 +3552,7 @@ void ChatModel::searchJumpSlot(int posType)
     switch (posType) {
         case DeltaHandler::SearchJumpToPosition::PositionFirst:
             m_searchCountCurrent = 0;
-            emit jumpToMsg(getIndexOfMsgID(dc_array_get_id(currentSearchMsgArray, 0)));
+            emit jumpToMsg(getIndexOfMsgID(m_searchResults[0]));
             emit searchCountUpdate(m_searchCountCurrent + 1, m_searchCountTotal);
             break;
 
@@ -3224,7 +3560,7 @@ void ChatModel::searchJumpSlot(int posType)
             if (m_searchCountCurrent > 0) {
                 --m_searchCountCurrent;
             }
-            emit jumpToMsg(getIndexOfMsgID(dc_array_get_id(currentSearchMsgArray, m_searchCountCurrent)));
+            emit jumpToMsg(getIndexOfMsgID(m_searchResults[m_searchCountCurrent]));
             emit searchCountUpdate(m_searchCountCurrent + 1, m_searchCountTotal);
             break;
 
@@ -3232,14 +3568,14 @@ void ChatModel::searchJumpSlot(int posType)
             if (m_searchCountCurrent + 1 < m_searchCountTotal) {
                 ++m_searchCountCurrent;
             }
-            emit jumpToMsg(getIndexOfMsgID(dc_array_get_id(currentSearchMsgArray, m_searchCountCurrent)));
+            emit jumpToMsg(getIndexOfMsgID(m_searchResults[m_searchCountCurrent]));
             emit searchCountUpdate(m_searchCountCurrent + 1, m_searchCountTotal);
             break;
 
         case DeltaHandler::SearchJumpToPosition::PositionLast:
             m_searchCountCurrent = m_searchCountTotal - 1;
             emit searchCountUpdate(m_searchCountCurrent + 1, m_searchCountTotal);
-            emit jumpToMsg(getIndexOfMsgID(dc_array_get_id(currentSearchMsgArray, m_searchCountCurrent)));
+            emit jumpToMsg(getIndexOfMsgID(m_searchResults[m_searchCountCurrent]));
             break;
 
         default:
@@ -3250,11 +3586,58 @@ void ChatModel::searchJumpSlot(int posType)
 
 int ChatModel::getIndexOfMsgID(uint32_t msgID)
 {
+    int tempIndex = getLoadedIndexOfMsgID(msgID);
+    if (-1 != tempIndex) {
+        return tempIndex;
+    }
+
+    // Not loaded yet. If it's one of the older messages, load
+    // everything up to and including this message.
+    QHash<uint32_t, size_t>::const_iterator it = m_olderMsgPosHash.constFind(msgID);
+    if (it == m_olderMsgPosHash.constEnd()) {
+        // the msgID was not found at all
+        return -1;
+    }
+
+    loadOlderMessages(m_olderMsgIDs.size() - it.value());
+    // it's the last one that has been appended to msgVector
+    return currentMsgCount - 1;
+}
+
+
+int ChatModel::getLoadedIndexOfMsgID(uint32_t msgID) const
+{
+    QHash<uint32_t, int>::const_iterator it = m_msgIndexHash.constFind(msgID);
+    if (it == m_msgIndexHash.constEnd()) {
+        // the msgID was not found in msgVector
+        return -1;
+    }
+
+    return it.value() - m_msgIndexFrontKey;
+}
+
+
+void ChatModel::rebuildMsgIndex()
+{
+    m_msgIndexFrontKey = 0;
+    m_msgIndexHash.clear();
+    m_msgIndexHash.reserve(currentMsgCount);
+
     for (size_t i = 0; i < currentMsgCount; ++i) {
-        if (msgID == msgVector[i]) {
-            return i;
+        // skip the Unread Message bar
+        if (0 != msgVector[i]) {
+            m_msgIndexHash.insert(msgVector[i], static_cast<int>(i));
         }
     }
-    // if we're here, the msgID was not found in msgVector
-    return -1;
+}
+
+
+void ChatModel::rebuildOlderMsgPosHash()
+{
+    m_olderMsgPosHash.clear();
+    m_olderMsgPosHash.reserve(m_olderMsgIDs.size());
+
+    for (size_t i = 0; i < m_olderMsgIDs.size(); ++i) {
+        m_olderMsgPosHash.insert(m_olderMsgIDs[i], i);
+    }
 }
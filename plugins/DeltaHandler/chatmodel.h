@@ -35,9 +35,36 @@
 class DeltaHandler;
 class WebxdcImageProvider;
 
+// Snapshot of a message as used by ChatModel::data(). The dc_msg_t*
+// is obtained once via dc_get_msg(), the values of roles that only
+// depend on the message itself are computed from it on first access
+// and stored in roleValues. A snapshot is never updated, it's
+// removed from the cache if the message changes.
+struct MsgSnapshot {
+    explicit MsgSnapshot(dc_msg_t* _msg) : msg {_msg} {}
+    ~MsgSnapshot() {
+        if (msg) {
+            dc_msg_unref(msg);
+        }
+    }
+    Q_DISABLE_COPY(MsgSnapshot)
+
+    dc_msg_t* msg;
+    QHash<int, QVariant> roleValues;
+    // to recognize whether an asynchronous result belongs to
+    // this snapshot or to a previous one of the same message
+    quint64 serial {0};
+    // roles whose value has been requested via
+    // ChatModel::requestAsyncRole(), but not received yet
+    QSet<int> pendingRoles;
+};
+
 class ChatModel : public QAbstractListModel {
     Q_OBJECT
 
+    // see benchmark/modelbenchmark.cpp
+    friend class ModelBenchmark;
+
 public:
     explicit ChatModel(DeltaHandler* dhandler, QObject *parent = 0);
     ~ChatModel();
@@ -135,6 +162,16 @@ public:
 
     Q_INVOKABLE void initiateQuotedMsgJump(int myindex);
 
+    // For opening a chat at a certain message, as for results of the
+    // global search. As the chat view is not there yet when the chat is
+    // configured, the message is only stored, and the chat view fetches
+    // its index via takeMsgToJumpToIndex() once it has loaded the chat.
+    void setMsgToJumpTo(uint32_t chatID, uint32_t msgID);
+    Q_INVOKABLE bool hasMsgToJumpTo();
+    // Returns -1 if no message is set or if it is not in the current
+    // chat, loads older messages if needed. Resets the message.
+    Q_INVOKABLE int takeMsgToJumpToIndex();
+
     Q_INVOKABLE void newChatlistmodel();
 
     Q_INVOKABLE void deleteChatlistmodel();
@@ -179,6 +216,10 @@ public:
     Q_PROPERTY(bool draftHasQuote READ draftHasQuote NOTIFY draftHasQuoteChanged);
     Q_PROPERTY(bool draftHasAttachment READ draftHasAttachment NOTIFY draftHasAttachmentChanged);
 
+    // true while MessageSendThread is sending a message
+    // of the current chat
+    Q_PROPERTY(bool sendingInProgress READ sendingInProgress NOTIFY sendingInProgressChanged);
+
     // presents a list of chats to forward messages to
     Q_PROPERTY(ChatlistModel* chatlistmodel READ chatlistmodel);
 
@@ -193,6 +234,7 @@ public:
     bool hasDraft();
     bool draftHasQuote();
     bool draftHasAttachment();
+    bool sendingInProgress() const;
     void acceptChat();
 
     ChatlistModel* chatlistmodel();
@@ -201,6 +243,11 @@ public:
     virtual int rowCount(const QModelIndex &parent) const;
     virtual QVariant data(const QModelIndex &index, int role) const;
 
+    // Called by the view when it approaches the oldest loaded
+    // message, see m_olderMsgIDs
+    virtual bool canFetchMore(const QModelIndex &parent) const;
+    virtual void fetchMore(const QModelIndex &parent);
+
     // Returns the number of messages in the current chat
     Q_INVOKABLE int getMessageCount();
 
@@ -213,6 +260,14 @@ public:
 
 public slots:
     void messageStatusChangedSlot(int msgID);
+
+    // connected to ContactCache::contactsInvalidated
+    void contactsInvalidated(uint32_t accID);
+
+    // connected to MessageSendThread::sendingStarted
+    void messageSendingStarted(uint32_t accID, uint32_t chatID, quint64 jobID);
+    // connected to MessageSendThread::sendingFinished
+    void messageSendingFinished(uint32_t accID, uint32_t chatID, quint64 jobID, uint32_t msgID);
     void appIsActiveAgainActions();
 
     // unusedParam is only there so the signal from ChatView.qml
@@ -225,14 +280,21 @@ public slots:
     void updateQuery(QString query);
     void searchJumpSlot(int posType);
 
+    // connected to MessageSearchThread::searchFinished
+    void searchFinished(quint64 generation, uint32_t accID, uint32_t chatID, std::vector<uint32_t> msgIDs);
+
     void webxdcUpdateReceiver(uint32_t accID, int msgID);
     void webxdcDeleteLocalStorage(uint32_t accID, int msgID);
 
 signals:
     void markedAllMessagesSeen();
+    // emitted if a message queued via sendMessage() could
+    // not be sent
+    void messageSendingFailed(uint32_t chatID);
     void jumpToMsg(int myindex);
     void draftHasQuoteChanged();
     void draftHasAttachmentChanged();
+    void sendingInProgressChanged();
     void chatDataChanged();
     void newChatConfigured(uint32_t chatID);
     void searchCountUpdate(int current, int total);
@@ -258,6 +320,7 @@ protected:
 
 private slots:
     void newMessage(int msgID);
+    void startSearch();
 
 private:
     DeltaHandler* m_dhandler;
@@ -269,6 +332,26 @@ private:
     std::vector<uint32_t> msgVector;
     bool m_isContactRequest;
 
+    // Long chats are not passed to the view as a whole. msgVector
+    // only contains the newest messages (plus the ones requested
+    // by the view via fetchMore() so far), the IDs of all older
+    // messages are in m_olderMsgIDs, ordered as returned by
+    // dc_get_chat_msgs(), i.e., the oldest message first.
+    std::vector<uint32_t> m_olderMsgIDs;
+    static constexpr size_t msgPageSize = 100;
+
+    // moves up to count messages from m_olderMsgIDs to msgVector
+    void loadOlderMessages(size_t count);
+
+    // Re-reads the message IDs of the chat and updates msgVector
+    // as well as m_olderMsgIDs accordingly
+    void resyncMessages();
+
+    // Inserts msgID at the bottom of the view if it's newer than all
+    // messages in the chat. Returns false if it cannot be handled
+    // this way, see the method for details.
+    bool insertNewestMessage(uint32_t msgID);
+
     // -1 if there's currently no unread message bar
     int m_unreadMessageBarIndex;
     uint32_t m_firstUnreadMessageID;
@@ -291,26 +374,79 @@ private:
     // app is actyive again.
     std::vector<uint32_t> msgsToMarkSeenLater;
 
-    // For caching the dc_msg_t* used in data() because the method is
-    // being called repeatedly for the same message, but different
-    // roles. Mutable is needed because the data() method is
-    // const.
-    mutable int data_row;
-    mutable uint32_t data_tempMsgID;
-    mutable dc_msg_t* data_tempMsg;
+    // For caching the messages used in data() because the method is
+    // being called repeatedly for the same messages, but different
+    // roles, and not necessarily in order. Key is the msgID, the
+    // least recently used snapshot is dropped if the cache is full.
+    // The size covers the visible messages plus what the ListView
+    // keeps around for scrolling. Mutable is needed because the
+    // data() method is const.
+    mutable QCache<uint32_t, MsgSnapshot> m_msgSnapshotCache;
+    static constexpr int msgSnapshotCacheSize = 200;
+    MsgSnapshot* getMsgSnapshot(uint32_t msgID) const;
+    mutable quint64 m_msgSnapshotSerial;
+
+    // Roles that need a jsonrpc call (reactions, vcard) are fetched
+    // via JsonrpcClient instead of blocking data(). The result is put
+    // into the snapshot, and dataChanged is emitted for the row.
+    void requestAsyncRole(MsgSnapshot* snapshot, uint32_t msgID, int role) const;
+    void asyncRoleReceived(uint32_t msgID, int role, quint64 serial, QJsonValue result, QString error);
+    QJsonObject vcardFromParseResult(dc_msg_t* msg, QJsonValue result, QString error);
+
+    // Last received reactions of the messages of the current chat,
+    // key is the msgID, messages without reactions are not contained.
+    // Used as placeholder while the reactions are fetched again after
+    // the snapshot has been dropped, so they don't vanish meanwhile.
+    QHash<uint32_t, QJsonObject> m_lastKnownReactions;
+
+    // Roles whose value depends on something other than the message
+    // itself (position in the view, search, contacts) are not
+    // stored in the snapshot
+    static bool roleIsSnapshotted(int role);
 
     QString copyToCache(QString fromFile) const;
 
     // for searching messages
     QString m_query;
-    dc_array_t* oldSearchMsgArray;
-    dc_array_t* currentSearchMsgArray;
-    // total number of entries in currentSearchMsgArray
+    // updateQuery() only (re)starts this timer, the search is
+    // started via MessageSearchThread once the user stopped typing
+    QTimer* m_searchDebounceTimer;
+    static constexpr int searchDebounceInterval = 300;
+    // increased with each search that is started or cancelled,
+    // results of older searches are ignored
+    quint64 m_searchGeneration;
+    // results of the current search in the order as returned
+    // by dc_search_msgs(), used for cycling through them
+    std::vector<uint32_t> m_searchResults;
+    // the same IDs, sorted, for computing which rows have to be
+    // updated if the results change
+    std::vector<uint32_t> m_sortedSearchResults;
+    // the same IDs again for IsSearchResultRole in data()
+    QSet<uint32_t> m_searchResultSet;
+    // total number of entries in m_searchResults
     int m_searchCountTotal;
     // current index for cycling through search results
     int m_searchCountCurrent;
+    void setSearchResults(const std::vector<uint32_t> &msgIDs);
 
+    // Loads older messages if msgID is not yet in msgVector
     int getIndexOfMsgID(uint32_t msgID);
+    // Only looks in msgVector, returns -1 if not found
+    int getLoadedIndexOfMsgID(uint32_t msgID) const;
+
+    // Index for getLoadedIndexOfMsgID(). The value is not the index
+    // itself, but index + m_msgIndexFrontKey, so inserting a new
+    // message at index 0 or appending older messages doesn't
+    // require touching the other entries. For anything else,
+    // rebuildMsgIndex() has to be called after changing msgVector.
+    // The Unread Message bar (ID 0) is not contained.
+    QHash<uint32_t, int> m_msgIndexHash;
+    int m_msgIndexFrontKey;
+    void rebuildMsgIndex();
+
+    // key: msgID, value: position in m_olderMsgIDs
+    QHash<uint32_t, size_t> m_olderMsgPosHash;
+    void rebuildOlderMsgPosHash();
     
     // Stores the message ID of the chatview index for which
     // an action was triggered. Reason is that QML does not
@@ -329,6 +465,11 @@ private:
     // value: the draft text
     QHash<QString, QString> m_draftTextHash;
 
+    // key: <accID>_<chatID>, see m_accIdChatIdKey
+    // value: number of messages being sent by MessageSendThread,
+    // chats without such messages are not contained
+    QHash<QString, int> m_sendingJobsPerChat;
+
     // contains <accID>_<chatID> as string so it doesn't
     // have to be generated each time m_draftTextHash is accessed
     QString m_accIdChatIdKey;
@@ -342,6 +483,10 @@ private:
     QQuickView* m_view;
     WebxdcImageProvider* m_webxdcImgProvider;
     uint32_t m_webxdcInstanceMsgId;
+
+    // see setMsgToJumpTo()
+    uint32_t m_msgToJumpToChatID;
+    uint32_t m_msgToJumpToMsgID;
 };
 
 
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "contactCache.h"
+
+#include <QDebug>
+
+ContactCache::ContactCache(QObject* parent)
+    : QObject(parent)
+{
+}
+
+
+const ContactSnapshot& ContactCache::getContact(dc_context_t* context, uint32_t contactID)
+{
+    quint64 key = cacheKey(dc_get_id(context), contactID);
+
+    QHash<quint64, ContactSnapshot>::const_iterator it = m_contacts.constFind(key);
+    if (it != m_contacts.constEnd()) {
+        return it.value();
+    }
+
+    if (m_contacts.size() >= maxCacheSize) {
+        m_contacts.clear();
+    }
+
+    ContactSnapshot snapshot;
+
+    dc_contact_t* tempContact = dc_get_contact(context, contactID);
+    if (tempContact) {
+        char* tempText = dc_contact_get_display_name(tempContact);
+        snapshot.displayName = tempText;
+        dc_str_unref(tempText);
+
+        tempText = dc_contact_get_addr(tempContact);
+        snapshot.addr = tempText;
+        dc_str_unref(tempText);
+
+        tempText = dc_contact_get_profile_image(tempContact);
+        snapshot.profileImage = tempText;
+        if (tempText) {
+            dc_str_unref(tempText);
+        }
+
+        snapshot.color = dc_contact_get_color(tempContact);
+        snapshot.verifiedState = dc_contact_is_verified(tempContact);
+
+        dc_contact_unref(tempContact);
+    } else {
+        qDebug() << "ContactCache::getContact(): Could not get contact ID " << contactID;
+    }
+
+    return m_contacts.insert(key, snapshot).value();
+}
+
+
+void ContactCache::contactsChanged(uint32_t accID, int contactID)
+{
+    if (0 != contactID) {
+        m_contacts.remove(cacheKey(accID, contactID));
+    } else {
+        QHash<quint64, ContactSnapshot>::iterator it = m_contacts.begin();
+        while (it != m_contacts.end()) {
+            if ((it.key() >> 32) == accID) {
+                it = m_contacts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    emit contactsInvalidated(accID);
+}
+
+
+quint64 ContactCache::cacheKey(uint32_t accID, uint32_t contactID)
+{
+    return (static_cast<quint64>(accID) << 32) | contactID;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTACTCACHE_H
+#define CONTACTCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+#include "../deltachat.h"
+
+// The data of a contact as needed by the models. Strings are
+// empty if the contact doesn't exist.
+struct ContactSnapshot {
+    QString displayName;
+    QString addr;
+    // full path as returned by dc_contact_get_profile_image()
+    QString profileImage;
+    // as returned by dc_contact_get_color(), 0xRRGGBB
+    uint32_t color {0};
+    // as returned by dc_contact_is_verified()
+    int verifiedState {0};
+};
+
+/*
+ * Cache for contact data shared by the models that display contacts
+ * (ChatModel, ContactsModel, GroupMemberModel), so rendering e.g. the
+ * sender of each message doesn't cost a dc_get_contact() per role and
+ * row. Entries are per account and are dropped when
+ * DC_EVENT_CONTACTS_CHANGED is received for the account. To be used
+ * from the GUI thread only.
+ */
+class ContactCache : public QObject {
+    Q_OBJECT
+
+public:
+    explicit ContactCache(QObject* parent = nullptr);
+
+    // Returns the cached data, fetches it from the core if it's
+    // not present. The reference is only valid until the next call
+    // of a non-const method.
+    const ContactSnapshot& getContact(dc_context_t* context, uint32_t contactID);
+
+public slots:
+    // contactID is the data1 of DC_EVENT_CONTACTS_CHANGED, 0 if
+    // several or unknown contacts have changed
+    void contactsChanged(uint32_t accID, int contactID);
+
+signals:
+    // emitted after the entries of the account have been dropped
+    void contactsInvalidated(uint32_t accID);
+
+private:
+    static quint64 cacheKey(uint32_t accID, uint32_t contactID);
+
+    QHash<quint64, ContactSnapshot> m_contacts;
+    // no need for anything sophisticated if it grows too
+    // large, the cache is just cleared in this case
+    static constexpr int maxCacheSize = 4096;
+};
+
+#endif // CONTACTCACHE_H
@@ -23,8 +23,8 @@ namespace C {
 #include <libintl.h>
 }
 
-ContactsModel::ContactsModel(QObject* parent)
-    : QAbstractListModel(parent), m_context {nullptr}, m_offset {0}, m_verifiedOnly {false}, m_includeAddContactItem {true}, m_query {""}
+ContactsModel::ContactsModel(ContactCache* contactCache, QObject* parent)
+    : QAbstractListModel(parent), m_contactCache {contactCache}, m_context {nullptr}, m_offset {0}, m_verifiedOnly {false}, m_includeAddContactItem {true}, m_query {""}
 { 
     m_newMembers.resize(0);
 };
@@ -134,22 +134,18 @@ QVariant ContactsModel::data(const QModelIndex &index, int role) const
 
 
     // Variables only to be used for the standard entries.
-    char* tempText {nullptr};
     uint32_t tempColor {0};
 
     uint32_t tempContactID = m_contactsVector[row - m_offset];
-    dc_contact_t* tempContact = dc_get_contact(m_context, tempContactID);
+    const ContactSnapshot& tempContact = m_contactCache->getContact(m_context, tempContactID);
 
     switch(role) {
         case ContactsModel::DisplayNameRole:
-            tempText = dc_contact_get_display_name(tempContact);
-            tempQString = tempText;
-            retval = tempQString;
+            retval = tempContact.displayName;
             break;
 
         case ContactsModel::ProfilePicRole:
-            tempText = dc_contact_get_profile_image(tempContact);
-            tempQString = tempText;
+            tempQString = tempContact.profileImage;
             // see comment for ChatModel::data() in chatmodel.cpp
             if (tempQString.length() > QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length()) {
                 tempQString.remove(0, QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length());
@@ -161,20 +157,17 @@ QVariant ContactsModel::data(const QModelIndex &index, int role) const
             break;
 
         case ContactsModel::EmailAddressRole:
-            tempText = dc_contact_get_addr(tempContact);
-            tempQString = tempText;
-            retval = tempQString;
+            retval = tempContact.addr;
             break;
 
         case ContactsModel::AvatarColorRole:
-            tempColor = dc_contact_get_color(tempContact);
+            tempColor = tempContact.color;
             tempQColor = QColor((tempColor >> 16) % 256, (tempColor >> 8) % 256, tempColor % 256, 0);
             retval = QString(tempQColor.name());
             break;
 
         case ContactsModel::AvatarInitialRole:
-            tempText = dc_contact_get_display_name(tempContact);
-            tempQString = tempText;
+            tempQString = tempContact.displayName;
             if (tempQString == "") {
                 tempQString = "#";
             } else {
@@ -202,7 +195,7 @@ QVariant ContactsModel::data(const QModelIndex &index, int role) const
             break;
 
         case ContactsModel::IsVerifiedRole:
-            if (2 == dc_contact_is_verified(tempContact)) {
+            if (2 == tempContact.verifiedState) {
                 retval = true;
             } else {
                 retval = false;
@@ -215,12 +208,6 @@ QVariant ContactsModel::data(const QModelIndex &index, int role) const
             break;
     }
 
-    if (tempText) {
-        dc_str_unref(tempText);
-    }
-
-    dc_contact_unref(tempContact);
-
     return retval;
 }
 
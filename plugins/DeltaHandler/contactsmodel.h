@@ -24,20 +24,25 @@
 #include <vector>
 //#include <string>
 #include "deltahandler.h"
+#include "contactCache.h"
 #include "../deltachat.h"
 
 class DeltaHandler;
+class ContactCache;
 
 class ContactsModel : public QAbstractListModel {
     Q_OBJECT
 
+    // see benchmark/modelbenchmark.cpp
+    friend class ModelBenchmark;
+
 signals:
     void chatCreationSuccess(uint32_t chatID);
     void queryDone();
     void addContactToGroup(uint32_t contactID);
 
 public:
-    explicit ContactsModel(QObject *parent = 0);
+    explicit ContactsModel(ContactCache* contactCache, QObject *parent = 0);
     ~ContactsModel();
 
     // IsAlreadyMemberOfGroupRole and IsToBeAddedToGroupRole
@@ -77,6 +82,7 @@ protected:
     QHash<int, QByteArray> roleNames() const;
 
 private:
+    ContactCache* m_contactCache;
     dc_context_t* m_context;
 
     std::vector<uint32_t> m_contactsVector;
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dataChangedHelper.h"
+
+#include <algorithm>
+
+void DataChangedHelper::emitForRows(QAbstractItemModel* model, std::vector<int> rows, const QVector<int> &roles)
+{
+    if (rows.empty()) {
+        return;
+    }
+
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    size_t rangeStart = 0;
+    for (size_t i = 1; i <= rows.size(); ++i) {
+        if (i == rows.size() || rows[i] != rows[i - 1] + 1) {
+            emit model->dataChanged(model->index(rows[rangeStart], 0), model->index(rows[i - 1], 0), roles);
+            rangeStart = i;
+        }
+    }
+}
+
+
+void DataChangedHelper::emitForAllRows(QAbstractItemModel* model, const QVector<int> &roles)
+{
+    int rowCount = model->rowCount(QModelIndex());
+
+    if (rowCount > 0) {
+        emit model->dataChanged(model->index(0, 0), model->index(rowCount - 1, 0), roles);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATACHANGEDHELPER_H
+#define DATACHANGEDHELPER_H
+
+#include <QAbstractItemModel>
+#include <QVector>
+
+#include <vector>
+
+/*
+ * Helper for models that have to notify the view about many changed
+ * rows at once. Instead of emitting dataChanged for each single row, the
+ * rows are merged into contiguous ranges and dataChanged is emitted
+ * once per range.
+ */
+class DataChangedHelper {
+
+public:
+    // rows may be unsorted and contain duplicates. If roles
+    // is empty, all roles are considered to have changed.
+    static void emitForRows(QAbstractItemModel* model, std::vector<int> rows, const QVector<int> &roles = QVector<int>());
+
+    // emits one dataChanged for all rows of the model
+    static void emitForAllRows(QAbstractItemModel* model, const QVector<int> &roles = QVector<int>());
+};
+
+#endif // DATACHANGEDHELPER_H
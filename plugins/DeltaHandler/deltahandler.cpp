@@ -16,8 +16,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <fstream>
 #include "deltahandler.h"
+#include "dataChangedHelper.h"
+#include "profiler.h"
 //#include <unistd.h> // for sleep
 #include <QtDBus/QDBusMessage>
 #include <QDBusPendingReply>
@@ -36,7 +39,7 @@ namespace C {
 
 
 DeltaHandler::DeltaHandler(QObject* parent)
-    : QAbstractListModel(parent), tempContext {nullptr}, m_tempProxyEnabled {false}, m_tempProxyUrls {""}, m_blockedcontactsmodel {nullptr}, m_groupmembermodel {nullptr}, m_workflowDbEncryption {nullptr}, m_workflowDbDecryption {nullptr}, m_fileImportSignalHelper {nullptr}, m_currentAccID {0}, m_currentChatID {0}, m_hasConfiguredAccount {false}, m_useProxy {false}, m_hasProxy {false}, m_networkingIsAllowed {true}, m_networkingIsStarted {false}, m_showArchivedChats {false}, m_tempGroupChatID {0}, m_query {""}, m_bus("DeltaTouch"), m_qr {nullptr}, m_audioRecorder {nullptr}, m_backupProvider {nullptr}, m_coreTranslationsAlreadySet {false}, m_signalQueue_refreshChatlist {false}
+    : QAbstractListModel(parent), tempContext {nullptr}, m_tempProxyEnabled {false}, m_tempProxyUrls {""}, m_blockedcontactsmodel {nullptr}, m_groupmembermodel {nullptr}, m_workflowDbEncryption {nullptr}, m_workflowDbDecryption {nullptr}, m_fileImportSignalHelper {nullptr}, m_currentAccID {0}, m_currentChatID {0}, m_hasConfiguredAccount {false}, m_useProxy {false}, m_hasProxy {false}, m_networkingIsAllowed {true}, m_networkingIsStarted {false}, m_showArchivedChats {false}, m_tempGroupChatID {0}, m_query {""}, m_bus("DeltaTouch"), m_qr {nullptr}, m_audioRecorder {nullptr}, m_backupProvider {nullptr}, m_coreTranslationsAlreadySet {false}
 {
     // Determine if the app is running on Ubuntu Touch,
     // if it is in desktop mode and if the on-screen
@@ -164,20 +167,31 @@ DeltaHandler::DeltaHandler(QObject* parent)
         qDebug() << "DeltaHandler::DeltaHandler(): Setting \"encrypted database\" is off";
     }
 
+    m_contactCache = new ContactCache(this);
+
     m_chatmodel = new ChatModel(this);
     currentChatIsOpened = false;
 
     m_accountsmodel = new AccountsModel();
 
-    m_contactsmodel = new ContactsModel();
+    m_contactsmodel = new ContactsModel(m_contactCache);
 
     m_signalQueueTimer = new QTimer(this);
+    m_signalQueueTimer->setInterval(minQueueTimerInterval);
 
     bool connectSuccess = connect(m_signalQueueTimer, SIGNAL(timeout()), this, SLOT(processSignalQueueTimerTimeout()));
     if (!connectSuccess) {
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal timeout to slot processSignalQueueTimerTimeout");
     }
 
+    m_muteExpiryTimer = new QTimer(this);
+    m_muteExpiryTimer->setSingleShot(true);
+
+    connectSuccess = connect(m_muteExpiryTimer, SIGNAL(timeout()), this, SLOT(processMuteExpiries()));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal timeout to slot processMuteExpiries");
+    }
+
     configdir.append("/accounts/");  
     // Qt documentation for QString:
     // [...] you can pass a QString to a function that takes a const char *
@@ -269,6 +283,19 @@ DeltaHandler::DeltaHandler(QObject* parent)
     m_jsonrpcResponseThread = new JsonrpcResponseThread(m_jsonrpcInstance, &m_stopThreads);
     m_jsonrpcResponseThread->start();
 
+    m_jsonrpcClient = new JsonrpcClient(this, m_jsonrpcInstance, m_jsonrpcResponseThread, this);
+
+    m_chatlistFetcherThread = new ChatlistFetcherThread(m_jsonrpcInstance, &m_stopThreads);
+    m_chatlistFetcherThread->start();
+
+    m_messageSendThread = new MessageSendThread(allAccounts, &m_stopThreads);
+    m_messageSendThread->start();
+
+    m_messageSearchThread = new MessageSearchThread(allAccounts, &m_stopThreads);
+    m_messageSearchThread->start();
+
+    m_globalsearchmodel = new GlobalSearchModel(this, allAccounts, &m_stopThreads);
+
 
     connectSuccess = connect(eventThread, SIGNAL(newMsg(uint32_t, int, int)), this, SLOT(incomingMessage(uint32_t, int, int)));
     if (!connectSuccess) {
@@ -290,6 +317,11 @@ DeltaHandler::DeltaHandler(QObject* parent)
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal connectivityChanged to slot connectivityUpdate");
     }
 
+    connectSuccess = connect(eventThread, SIGNAL(accountDataChanged(uint32_t)), this, SLOT(accountDataChangedByCore(uint32_t)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal accountDataChanged to slot accountDataChangedByCore");
+    }
+
     connectSuccess = connect(eventThread, SIGNAL(chatDataModified(uint32_t, int)), this, SLOT(chatDataModifiedReceived(uint32_t, int)));
     if (!connectSuccess) {
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal chatDataModified to slot chatDataModifiedReceived");
@@ -300,6 +332,16 @@ DeltaHandler::DeltaHandler(QObject* parent)
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal configureProgress to slot progressEvent");
     }
 
+    connectSuccess = connect(eventThread, SIGNAL(contactDataChanged(uint32_t, int)), m_contactCache, SLOT(contactsChanged(uint32_t, int)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal contactDataChanged to slot contactsChanged");
+    }
+
+    connectSuccess = connect(m_contactCache, SIGNAL(contactsInvalidated(uint32_t)), m_chatmodel, SLOT(contactsInvalidated(uint32_t)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal contactsInvalidated to slot contactsInvalidated");
+    }
+
     connectSuccess = connect(eventThread, SIGNAL(contactsChanged()), m_contactsmodel, SLOT(updateContacts()));
     if (!connectSuccess) {
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal contactsChanged to slot updateContacts");
@@ -330,6 +372,31 @@ DeltaHandler::DeltaHandler(QObject* parent)
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal newJsonrpcResponse to slot receiveJsonrcpResponse");
     }
 
+    connectSuccess = connect(m_jsonrpcResponseThread, SIGNAL(internalJsonrpcResponse(uint32_t, QByteArray)), m_jsonrpcClient, SLOT(responseReceived(uint32_t, QByteArray)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal internalJsonrpcResponse to slot responseReceived");
+    }
+
+    connectSuccess = connect(m_chatlistFetcherThread, SIGNAL(chatlistRowsFetched(uint32_t, std::vector<uint32_t>, QVector<ChatlistItem>)), this, SLOT(chatlistRowsFetched(uint32_t, std::vector<uint32_t>, QVector<ChatlistItem>)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal chatlistRowsFetched to slot chatlistRowsFetched");
+    }
+
+    connectSuccess = connect(m_messageSendThread, SIGNAL(sendingStarted(uint32_t, uint32_t, quint64)), m_chatmodel, SLOT(messageSendingStarted(uint32_t, uint32_t, quint64)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal sendingStarted to slot messageSendingStarted");
+    }
+
+    connectSuccess = connect(m_messageSendThread, SIGNAL(sendingFinished(uint32_t, uint32_t, quint64, uint32_t)), m_chatmodel, SLOT(messageSendingFinished(uint32_t, uint32_t, quint64, uint32_t)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal sendingFinished to slot messageSendingFinished");
+    }
+
+    connectSuccess = connect(m_messageSearchThread, SIGNAL(searchFinished(quint64, uint32_t, uint32_t, std::vector<uint32_t>)), m_chatmodel, SLOT(searchFinished(quint64, uint32_t, uint32_t, std::vector<uint32_t>)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal searchFinished to slot searchFinished");
+    }
+
 
     connectSuccess = connect(m_contactsmodel, SIGNAL(chatCreationSuccess(uint32_t)), this, SLOT(chatCreationReceiver(uint32_t)));
     if (!connectSuccess) {
@@ -376,6 +443,11 @@ DeltaHandler::DeltaHandler(QObject* parent)
         qFatal("DeltaHandler::DeltaHandler: Could not connect signal deletedAccount of m_accountsmodel to slot removeClosedAccountFromList");
     }
 
+    connectSuccess = connect(m_accountsmodel, SIGNAL(deletedAccount(uint32_t)), m_globalsearchmodel, SLOT(removeAccount(uint32_t)));
+    if (!connectSuccess) {
+        qFatal("DeltaHandler::DeltaHandler: Could not connect signal deletedAccount of m_accountsmodel to slot removeAccount of m_globalsearchmodel");
+    }
+
     connectSuccess = connect(this, SIGNAL(chatIsNotContactRequestAnymore(uint32_t, uint32_t)), m_accountsmodel, SLOT(removeChatIdFromContactRequestList(uint32_t, uint32_t)));
     if (!connectSuccess) {
         qDebug() << "DeltaHandler::DeltaHandler: Could not connect signal chatIsNotContactRequestAnymore of eventThread to slot removeChatIdFromContactRequestList of m_accountsmodel";
@@ -584,6 +656,24 @@ uint32_t DeltaHandler::getCurrentAccountId() const
 }
 
 
+ContactCache* DeltaHandler::getContactCache() const
+{
+    return m_contactCache;
+}
+
+
+MessageSendThread* DeltaHandler::getMessageSendThread() const
+{
+    return m_messageSendThread;
+}
+
+
+MessageSearchThread* DeltaHandler::getMessageSearchThread() const
+{
+    return m_messageSearchThread;
+}
+
+
 int DeltaHandler::getCurrentChatId() const
 {
     if (!currentChatIsOpened) {
@@ -600,8 +690,16 @@ void DeltaHandler::sendJsonrpcRequest(QString request)
 }
 
 
+JsonrpcClient* DeltaHandler::getJsonrpcClient() const
+{
+    return m_jsonrpcClient;
+}
+
+
 QString DeltaHandler::sendJsonrpcBlockingCall(QString request) const
 {
+    DT_PROFILE_SCOPE("JSON-RPC blocking call (DeltaHandler)");
+
     char* tempText;
     QString retval;
 
@@ -1156,10 +1254,22 @@ QHash<int, QByteArray> DeltaHandler::roleNames() const
 {
     QHash<int, QByteArray> roles;
 
-//    roles[AccountIdRole] = "accountId";
-//    roles[ChatIdRole] = "chatId";
-    roles[ChatlistEntryRole] = "chatlistEntry";
-    roles[BasicChatInfoRole] = "basicChatInfo";
+    roles[ChatIdRole] = "chatId";
+    roles[IsArchiveLinkRole] = "isArchiveLink";
+    roles[ChatNameRole] = "chatName";
+    roles[AvatarPathRole] = "avatarPath";
+    roles[AvatarInitialRole] = "avatarInitial";
+    roles[ChatColorRole] = "chatColor";
+    roles[SummaryText1Role] = "summaryText1";
+    roles[SummaryText2Role] = "summaryText2";
+    roles[SummaryStatusRole] = "summaryStatus";
+    roles[LastUpdatedRole] = "lastUpdated";
+    roles[FreshMsgCountRole] = "freshMsgCount";
+    roles[IsProtectedRole] = "isProtected";
+    roles[IsMutedRole] = "isMuted";
+    roles[IsPinnedRole] = "isPinned";
+    roles[IsArchivedRole] = "isArchived";
+    roles[IsContactRequestRole] = "isContactRequest";
 
     return roles;
 }
@@ -1174,81 +1284,102 @@ QVariant DeltaHandler::data(const QModelIndex &index, int role) const
     }
 
     uint32_t tempChatID = m_chatlistVector[row];
-    
-    char* tempText {nullptr};
-    
-    QByteArray byteArray;
-    QJsonDocument jsonDoc;
-    QJsonObject jsonObj;
-    QString tempString;
-    QString paramString;
-    QString requestString;
+
+    // No jsonrpc calls here, the data is taken from m_chatlistRowCache
+    // which is filled by m_chatlistFetcherThread. In case of a cache miss
+    // (or if the entry is outdated), the rows around the requested one are
+    // fetched in the background and the view is notified via dataChanged
+    // once they have arrived.
+    QHash<quint64, ChatlistRowCacheEntry>::const_iterator it = m_chatlistRowCache.constFind(chatlistCacheKey(m_currentAccID, tempChatID));
+
+    if (it == m_chatlistRowCache.constEnd() || it->isStale) {
+        prefetchChatlistRows(row - chatlistPrefetchMargin, row + chatlistPrefetchMargin);
+    }
+
+    // Placeholder until the actual data has been fetched
+    ChatlistItem placeholderItem;
+    placeholderItem.chatID = tempChatID;
+
+    const ChatlistItem &tempItem = (it != m_chatlistRowCache.constEnd()) ? it->item : placeholderItem;
 
     QVariant retval;
+    QString tempString;
 
     switch(role) {
-//        case DeltaHandler::AccountIdRole:
-//            retval = m_currentAccID;
-//            break;
+        case DeltaHandler::ChatIdRole:
+            retval = tempItem.chatID;
+            break;
 
-//        case DeltaHandler::ChatIdRole:
-//            retval = tempChatID;
-//            break;
+        case DeltaHandler::IsArchiveLinkRole:
+            retval = tempItem.isArchiveLink;
+            break;
 
-        case DeltaHandler::ChatlistEntryRole:
-            tempString.setNum(m_currentAccID);
-            paramString.append(tempString);
+        case DeltaHandler::ChatNameRole:
+            retval = tempItem.name;
+            break;
 
-            paramString.append(", [");
+        case DeltaHandler::AvatarPathRole:
+            retval = tempItem.avatarPath;
+            break;
 
-            tempString.setNum(tempChatID);
+        case DeltaHandler::AvatarInitialRole:
+            if (tempItem.name == "") {
+                tempString = "#";
+            } else {
+                tempString = QString(tempItem.name.at(0)).toUpper();
+            }
+            retval = tempString;
+            break;
 
-            paramString.append(tempString);
-            paramString.append("]");
+        case DeltaHandler::ChatColorRole:
+            retval = QColor::fromRgba(tempItem.color);
+            break;
 
-            requestString = constructJsonrpcRequestString("get_chatlist_items_by_entries", paramString);
+        case DeltaHandler::SummaryText1Role:
+            retval = tempItem.summaryText1;
+            break;
 
-            // the actual object with the chatlist entry is nested in the
-            // received json like this:
-            // { .....,"result":{"<chatID>":{ <this is the actual entry> }}}
-            // so we extract it
-            byteArray = sendJsonrpcBlockingCall(requestString).toLocal8Bit();
-            jsonDoc = QJsonDocument::fromJson(byteArray);
-            jsonObj = jsonDoc.object();
-            // value() returns a QJsonValue, which we directly
-            // transform back to an object via toObject()
-            jsonObj = jsonObj.value("result").toObject();
-            // Next layer. tempString contains tempChatID as string
-            jsonObj = jsonObj.value(tempString).toObject();
+        case DeltaHandler::SummaryText2Role:
+            retval = tempItem.summaryText2;
+            break;
 
-            retval = jsonObj;
+        case DeltaHandler::SummaryStatusRole:
+            retval = tempItem.summaryStatus;
+            break;
 
+        case DeltaHandler::LastUpdatedRole:
+            retval = static_cast<qlonglong>(tempItem.lastUpdated);
             break;
 
-        case DeltaHandler::BasicChatInfoRole:
-            tempString.setNum(m_currentAccID);
-            paramString.append(tempString);
+        case DeltaHandler::FreshMsgCountRole:
+            retval = tempItem.freshMessageCounter;
+            break;
 
-            paramString.append(", ");
+        case DeltaHandler::IsProtectedRole:
+            retval = tempItem.isProtected;
+            break;
 
-            tempString.setNum(tempChatID);
-            paramString.append(tempString);
+        case DeltaHandler::IsMutedRole:
+            retval = tempItem.isMuted;
+            break;
 
-            requestString = constructJsonrpcRequestString("get_basic_chat_info", paramString);
+        case DeltaHandler::IsPinnedRole:
+            retval = tempItem.isPinned;
+            break;
 
-            tempText = dc_jsonrpc_blocking_call(m_jsonrpcInstance, requestString.toLocal8Bit().constData());
-            retval = (QString(tempText));
+        case DeltaHandler::IsArchivedRole:
+            retval = tempItem.isArchived;
+            break;
 
+        case DeltaHandler::IsContactRequestRole:
+            retval = tempItem.isContactRequest;
             break;
 
         default:
-            retval = QString("");
-
-    }
-
-    if (tempText) {
-        dc_str_unref(tempText);
-        tempText = nullptr;
+            // all roles of roleNames() are handled above
+            retval = QVariant();
+            qWarning() << "DeltaHandler::data(): unknown role " << role;
+            break;
     }
 
     return retval;
@@ -1260,6 +1391,12 @@ ChatModel* DeltaHandler::chatmodel()
 }
 
 
+GlobalSearchModel* DeltaHandler::globalsearchmodel()
+{
+    return m_globalsearchmodel;
+}
+
+
 AccountsModel* DeltaHandler::accountsmodel()
 {
     return m_accountsmodel;
@@ -1507,6 +1644,10 @@ void DeltaHandler::momentaryChatSetMuteDuration(int64_t secondsToMute)
 
     if (0 == success) {
         qWarning() << "DeltaHandler::chatSetMuteDuration(): Setting the mute duration failed";
+    } else {
+        // The chatlist entry itself is updated via DC_EVENT_CHAT_MODIFIED,
+        // but the end of the mute has to be scheduled here
+        scheduleMuteExpiry(m_momentaryChatId);
     }
 }
 
@@ -1638,37 +1779,52 @@ void DeltaHandler::selectAccount(uint32_t newAccID, bool calledInUrlHandlingProc
 
 void DeltaHandler::messagesChanged(uint32_t accID, int chatID, int msgID)
 {
-    if (m_currentAccID == accID) {
-        m_signalQueue_refreshChatlist = true;
+    queueChangedMessage(accID, chatID, msgID);
+
+    // Can be anything, e.g. deleted messages or messages seen on
+    // another device. The core sends this event for nearly every
+    // state change of a message, so only a change without a message
+    // ID causes a recount of the fresh messages of the account.
+    // Otherwise, m_accountsmodel checks whether the message was
+    // fresh and still is.
+    if (0 == msgID) {
+        m_eventCoalescer.markFreshMsgCountStale(accID);
+    } else {
+        m_eventCoalescer.markFreshMsgChanged(accID, msgID);
+    }
+
+    scheduleSignalQueue();
+}
 
-        m_signalQueue_chatsDataChanged.push(chatID);
+
+void DeltaHandler::queueChangedMessage(uint32_t accID, int chatID, int msgID)
+{
+    if (m_currentAccID == accID) {
+        m_eventCoalescer.markChatlistChanged(accID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
 
         if (m_currentChatID == chatID && currentChatIsOpened) {
-            m_signalQueue_msgs.push(msgID);
+            m_eventCoalescer.markMsgChanged(accID, msgID);
         }
     }
 
-    {
-        // m_signalQueue_accountsmodelInfo is for m_accountsmodel,
-        // make sure to avoid duplicate entries already here
-        bool found {false};
-        for (size_t i = 0; i < m_signalQueue_accountsmodelInfo.size(); ++i) {
-            if (accID == m_signalQueue_accountsmodelInfo[i]) {
-                found = true;
-            }
-        }
+    // for m_accountsmodel, the chat may be a new contact request
+    m_eventCoalescer.markContactRequestChanged(accID, chatID);
+}
 
-        if (!found) {
-            m_signalQueue_accountsmodelInfo.push_back(accID);
-        }
-    }
 
+void DeltaHandler::scheduleSignalQueue()
+{
     if (!m_signalQueueTimer->isActive()) {
+        // Nothing has been processed recently, so this is the
+        // first event after a quiet period. Handle it right away,
+        // the events following it will be batched by the timer.
         processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
+        m_signalQueueTimer->start();
     }
 }
 
+
 void DeltaHandler::processSignalQueueTimerTimeout()
 {
     if (isQueueEmpty()) {
@@ -1681,15 +1837,27 @@ void DeltaHandler::processSignalQueueTimerTimeout()
     }
 }
 
+
 void DeltaHandler::processSignalQueue()
 {
+    DT_PROFILE_SCOPE("DeltaHandler::processSignalQueue");
+
+    m_signalQueueStopwatch.start();
+
+    // Taken out completely before anything is done, events
+    // that come in while processing go into the next run
+    QHash<uint32_t, AccountDirtyState> dirtyStates = m_eventCoalescer.takeAll();
+
+    // Chatlist, messages and freshMsgs are only relevant for the
+    // active account. The chatlist is re-created on account
+    // switch anyway.
+    AccountDirtyState state = dirtyStates.value(m_currentAccID);
+
     bool resetInsteadRefresh = false;
 
     { // check if the chatlist has to be refreshed / reset
 
-        if (m_signalQueue_refreshChatlist) {
-            m_signalQueue_refreshChatlist = false;
-
+        if (state.chatlistChanged && currentContext) {
             // - a chat may have been deleted (chatID would be 0 then)
             // - a new chat may be present
             // - one or more new messages may have been received, so
@@ -1753,197 +1921,87 @@ void DeltaHandler::processSignalQueue()
         // Not needed if the chatlist has been reset
         // instead refreshed:
         if (resetInsteadRefresh) {
-            // in this case, only m_signalQueue_chatsDataChanged has
-            // to be emptied
-            while (!m_signalQueue_chatsDataChanged.empty()) {
-                m_signalQueue_chatsDataChanged.pop();
-            }
-        } else {
-            // m_signalQueue_chatsDataChanged contains all chat IDs
-            // that have to be notified. It's guaranteed that they
-            // belong to the currently active context.
-            //
-            // First transfer m_signalQueue_chatsDataChanged to a vector
-            // to eliminate duplicates:
-            std::vector<int> chatsToRefresh;
-            bool allChatsAffected = false;
-
-            while (!m_signalQueue_chatsDataChanged.empty()) {
-                int tempChatID = m_signalQueue_chatsDataChanged.front();
-                m_signalQueue_chatsDataChanged.pop();
-
-                if (allChatsAffected) {
-                    // Don't abort the loop if all chats are affected
-                    // because we have to clear the queue.
-                    // No need to take care of the chatsToRefresh vector
-                    // as it is only temporary.
-                    continue;
-                }
-
-                if (0 == tempChatID) {
-                    allChatsAffected = true;
-                    continue;
-                }
-
-                size_t i = 0;
-                while (i < chatsToRefresh.size()) {
-                    if (tempChatID == chatsToRefresh[i]) {
-                        break;
-                    }
-                    ++i;
-                }
-
-                if (i == chatsToRefresh.size()) {
-                    // No break in the above for loop, so the chat ID
-                    // is not yet in the vector, add it
-                    chatsToRefresh.push_back(tempChatID);
-                }
-            }
-
-            // Then do the actual notification of the model
-            for (size_t i = 0; i < m_chatlistVector.size(); ++i) {
-                if (allChatsAffected) {
-                    emit dataChanged(index(i, 0), index(i, 0));
-                } else {
-                    for (size_t j = 0; j < chatsToRefresh.size(); ++j) {
-                        if (m_chatlistVector[i] == chatsToRefresh[j]) {
-                            emit dataChanged(index(i, 0), index(i, 0));
-                            break;
-                        }
-                    }
-                }
-            }
+            // in this case, the cached entries have to be
+            // re-fetched as the view will ask for all of them
+            // anyway
+            invalidateAllChatlistRows();
+        } else if (state.allChatsChanged) {
+            invalidateAllChatlistRows();
+        } else if (!state.changedChats.isEmpty()) {
+            // Re-fetch the affected chats. The view will be
+            // notified via dataChanged in chatlistRowsFetched() once
+            // the new data has arrived.
+            std::vector<uint32_t> chatIDs(state.changedChats.constBegin(), state.changedChats.constEnd());
+            invalidateChatlistRows(chatIDs);
         }
+
+        // Chats that have been changed and chats that have been
+        // added by refreshChatlistVector() are fetched in one go
+        requestQueuedChatlistRows();
     }
 
     { // Emit the msgsChanged signal for all concerned msg IDs.
-      // First transfer m_signalQueue_msgs to a vector
-      // to eliminate duplicates:
-        std::vector<int> msgsToEmit;
-
-        while (!m_signalQueue_msgs.empty()) {
-            int tempMsgID = m_signalQueue_msgs.front();
-            m_signalQueue_msgs.pop();
-
-            // can't check for 0 == tempMsgID here as 0 affects
-            // only a certain chat. TODO: how to deal with this?
-            size_t i = 0;
-            while (i < msgsToEmit.size()) {
-                if (tempMsgID == msgsToEmit[i]) {
-                    break;
-                }
-                ++i;
-            }
-
-            if (i == msgsToEmit.size()) {
-                // No break in the above for loop, so the chat ID
-                // is not yet in the vector, add it
-                msgsToEmit.push_back(tempMsgID);
-            }
-        }
-
-        // Then do the actual notification of the model
-        for (size_t i = 0; i < msgsToEmit.size(); ++i) {
-            emit msgsChanged(msgsToEmit[i]);
+      // can't check for 0 == msgID here as 0 affects
+      // only a certain chat. TODO: how to deal with this?
+        QSet<int>::const_iterator it;
+        for (it = state.changedMsgs.constBegin(); it != state.changedMsgs.constEnd(); ++it) {
+            emit msgsChanged(*it);
         }
     }
 
-    { // Take care of the MSGS_NOTICED signal
-      // 
-      // First transfer m_signalQueue_chatsNoticed to a vector
-      // to eliminate duplicates:
-        std::vector<int> chatsToConsider;
-
-        while (!m_signalQueue_chatsNoticed.empty()) {
-            int tempChatID = m_signalQueue_chatsNoticed.front();
-            m_signalQueue_chatsNoticed.pop();
-
-            size_t i = 0;
-            while (i < chatsToConsider.size()) {
-                if (tempChatID == chatsToConsider[i]) {
-                    break;
-                }
-                ++i;
-            }
-
-            if (i == chatsToConsider.size()) {
-                // No break in the above for loop, so the chat ID
-                // is not yet in the vector, add it
-                chatsToConsider.push_back(tempChatID);
-            }
-        }
-
+    if (!state.noticedChats.isEmpty()) {
+        // Take care of the MSGS_NOTICED signal:
         // Check all messages in freshMsgs for the concerned chat IDs
         size_t i = 0;
         size_t endpos = freshMsgs.size();
-        for (size_t j = 0; j < chatsToConsider.size(); ++j) {
-            while (i < endpos) {
-                if (freshMsgs[i][1] == chatsToConsider[j]) {
-                    dc_msg_t* tempMsg = dc_get_msg(currentContext, freshMsgs[i][0]);
-
-                    // check if the message has actually been seen
-                    if (dc_msg_get_state(tempMsg) == DC_STATE_IN_SEEN) {
-                        // remove the message from freshMsgs if it has been seen
-                        std::vector<std::array<uint32_t, 2>>::iterator it;
-                        it = freshMsgs.begin();
-                        freshMsgs.erase(it + i);
-                        --endpos;
-                    } else {
-                        // only increase i if no item is removed from freshMsgs
-                        ++i;
-                    }
-
-                    if (tempMsg) {
-                        dc_msg_unref(tempMsg);
-                    }
+        while (i < endpos) {
+            if (state.noticedChats.contains(static_cast<int>(freshMsgs[i][1]))) {
+                dc_msg_t* tempMsg = dc_get_msg(currentContext, freshMsgs[i][0]);
+
+                // check if the message has actually been seen
+                if (dc_msg_get_state(tempMsg) == DC_STATE_IN_SEEN) {
+                    // remove the message from freshMsgs if it has been seen
+                    std::vector<std::array<uint32_t, 2>>::iterator it;
+                    it = freshMsgs.begin();
+                    freshMsgs.erase(it + i);
+                    --endpos;
                 } else {
                     // only increase i if no item is removed from freshMsgs
                     ++i;
                 }
-            }
-        }
-    }
 
-    {
-        // Remove notifications. As usual, check for duplicates first.
-        std::vector<AccIdAndChatIdStruct> structsToConsider;
-
-        while (!m_signalQueue_notificationsToRemove.empty()) {
-            AccIdAndChatIdStruct tempStruct = m_signalQueue_notificationsToRemove.front();
-            m_signalQueue_notificationsToRemove.pop();
-
-            size_t i = 0;
-            while (i < structsToConsider.size()) {
-                AccIdAndChatIdStruct vecTemp = structsToConsider[i];
-                if (tempStruct.accID == vecTemp.accID && tempStruct.chatID == vecTemp.chatID) {
-                    break;
+                if (tempMsg) {
+                    dc_msg_unref(tempMsg);
                 }
+            } else {
+                // only increase i if no item is removed from freshMsgs
                 ++i;
             }
-
-            if (i == structsToConsider.size()) {
-                // No break in the above for loop, so the chat ID
-                // is not yet in the vector, add it
-                structsToConsider.push_back(tempStruct);
-            }
         }
+    }
 
+    QHash<uint32_t, AccountDirtyState>::const_iterator accIt;
+    for (accIt = dirtyStates.constBegin(); accIt != dirtyStates.constEnd(); ++accIt) {
         // call removeActiveNotificationsOfChat for all concerned account/chat combinations
-        for (size_t i = 0; i < structsToConsider.size(); ++i) {
-            AccIdAndChatIdStruct tempStruct = structsToConsider[i];
+        QSet<int>::const_iterator chatIt;
+        for (chatIt = accIt.value().chatsWithNotificationsToRemove.constBegin(); chatIt != accIt.value().chatsWithNotificationsToRemove.constEnd(); ++chatIt) {
             // TODO: need to take care of the fact that in case of Lomiri Postal,
             // when removeActiveNotificationsOfChat returns, the notification has
             // NOT been deleted yet - the actual deletion will happen upon
             // processing a signal triggered by DBus
-            m_notificationHelper->removeActiveNotificationsOfChat(tempStruct.accID, tempStruct.chatID);
+            m_notificationHelper->removeActiveNotificationsOfChat(accIt.key(), *chatIt);
         }
     }
 
-    {
-        // Inform m_accountsmodel about changes.
-        m_accountsmodel->updateFreshMsgCountAndContactRequests(m_signalQueue_accountsmodelInfo);
-        m_signalQueue_accountsmodelInfo.resize(0);
-    }
+    // Inform m_accountsmodel about changes.
+    m_accountsmodel->updateAccountCounters(dirtyStates);
+
+    // Adapt the interval for the next runs. The GUI thread should
+    // not spend more than about a quarter of its time in here, and
+    // the interval is kept at a multiple of a frame.
+    int interval = static_cast<int>(m_signalQueueStopwatch.elapsed()) * 4;
+    interval = ((interval + minQueueTimerInterval - 1) / minQueueTimerInterval) * minQueueTimerInterval;
+    m_signalQueueTimer->setInterval(qBound(static_cast<int>(minQueueTimerInterval), interval, static_cast<int>(maxQueueTimerInterval)));
 }
 
 
@@ -1964,19 +2022,23 @@ void DeltaHandler::messagesNoticed(uint32_t accID, int chatID)
     // Same for the freshMsgs array.
     if (m_currentAccID == accID) {
         // to inform the model about changed data
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
         
         // to remove the msgIDs from the vector freshMsgs
-        m_signalQueue_chatsNoticed.push(chatID);
+        m_eventCoalescer.markChatNoticed(accID, chatID);
     }
 
-    // Notifications have to be removed for all accounts
-    m_signalQueue_notificationsToRemove.push(AccIdAndChatIdStruct { accID, chatID });
+    // Notifications have to be removed for all accounts. Messages
+    // waiting for the incoming msg bunch event are dropped right
+    // away, messages coming in before the queue runs still need
+    // a notification.
+    m_notificationHelper->removePendingMessagesOfChat(accID, chatID);
+    m_eventCoalescer.markNotificationsToRemove(accID, chatID);
 
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    // for m_accountsmodel
+    m_eventCoalescer.markFreshMsgCountStale(accID);
+
+    scheduleSignalQueue();
 }
 
 
@@ -1988,30 +2050,16 @@ void DeltaHandler::chatDataModifiedReceived(uint32_t accID, int chatID)
 
     if (m_currentAccID == accID) {
         // to update the chatlist entry
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
     }
 
-    // to update m_accountsmodel
-    {
-        // m_signalQueue_accountsmodelInfo is for m_accountsmodel,
-        // make sure to avoid duplicate entries already here
-        bool found {false};
-        for (size_t i = 0; i < m_signalQueue_accountsmodelInfo.size(); ++i) {
-            if (accID == m_signalQueue_accountsmodelInfo[i]) {
-                found = true;
-            }
-        }
+    // to update m_accountsmodel, the chat may have been accepted,
+    // blocked or archived, or muted/unmuted, which changes the
+    // fresh message count
+    m_eventCoalescer.markContactRequestChanged(accID, chatID);
+    m_eventCoalescer.markFreshMsgCountStale(accID);
 
-        if (!found) {
-            m_signalQueue_accountsmodelInfo.push_back(accID);
-        }
-    }
-
-
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -2026,7 +2074,13 @@ void DeltaHandler::incomingMessage(uint32_t accID, int chatID, int msgID)
         }
     }
 
-    messagesChanged(accID, chatID, msgID);
+    queueChangedMessage(accID, chatID, msgID);
+
+    // The message can simply be added to the fresh messages
+    // in m_accountsmodel instead of recounting all of them
+    m_eventCoalescer.markIncomingMsg(accID, chatID, msgID);
+
+    scheduleSignalQueue();
 
     // notifications are handled via m_notificationHelper which
     // is connected to the incoming message event as well
@@ -2041,13 +2095,10 @@ void DeltaHandler::messageReadByRecipient(uint32_t accID, int chatID, int msgID)
 
     // update the chatlist to display changes in the state of the preview message
     if (m_currentAccID == accID) {
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
     }
     
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -2059,13 +2110,10 @@ void DeltaHandler::messageDeliveredToServer(uint32_t accID, int chatID, int msgI
     
     // update the chatlist to display changes in the state of the preview message
     if (m_currentAccID == accID) {
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
     }
     
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -2077,13 +2125,10 @@ void DeltaHandler::messageFailedSlot(uint32_t accID, int chatID, int msgID)
 
     // update the chatlist to display changes in the state of the preview message
     if (m_currentAccID == accID) {
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
     }
     
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -2095,15 +2140,11 @@ void DeltaHandler::msgReactionsChanged(uint32_t accID, int chatID, int msgID)
 
     // update chatlist as reactions may change message preview
     if (m_currentAccID == accID) {
-        m_signalQueue_refreshChatlist = true;
-
-        m_signalQueue_chatsDataChanged.push(chatID);
+        m_eventCoalescer.markChatlistChanged(accID);
+        m_eventCoalescer.markChatChanged(accID, chatID);
     }
 
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -3796,7 +3837,7 @@ void DeltaHandler::startCreateGroup()
     creatingNewGroup = true;
     editingVerifiedGroup = false;
 
-    m_groupmembermodel = new GroupMemberModel();
+    m_groupmembermodel = new GroupMemberModel(m_contactCache);
     m_groupmembermodel->setConfig(currentContext, true);
 
     m_contactsmodel->setVerifiedOnly(false);
@@ -3823,7 +3864,7 @@ void DeltaHandler::startEditGroup(int myindex)
         m_tempGroupChatID = m_chatlistVector[myindex];
     }
 
-    m_groupmembermodel = new GroupMemberModel();
+    m_groupmembermodel = new GroupMemberModel(m_contactCache);
     m_groupmembermodel->setConfig(currentContext, false, m_tempGroupChatID);
 
     dc_chat_t* tempChat = dc_get_chat(currentContext, m_tempGroupChatID);
@@ -3852,7 +3893,7 @@ void DeltaHandler::momentaryChatStartEditGroup()
 
     m_tempGroupChatID = m_momentaryChatId;
 
-    m_groupmembermodel = new GroupMemberModel();
+    m_groupmembermodel = new GroupMemberModel(m_contactCache);
     m_groupmembermodel->setConfig(currentContext, false, m_tempGroupChatID);
 
     dc_chat_t* tempChat = dc_get_chat(currentContext, m_tempGroupChatID);
@@ -4534,9 +4575,14 @@ void DeltaHandler::startQrBackupImport()
     paramString.append(qrContentEscaped);
     paramString.append("\"");
 
-    QString requestString = constructJsonrpcRequestString("get_backup", paramString);
-
-    sendJsonrpcRequest(requestString);
+    // The result is null, progress and failure are
+    // reported via DC_EVENT_IMEX_PROGRESS
+    m_jsonrpcClient->request("get_backup", paramString, this, [](QJsonValue result, QString error) {
+        Q_UNUSED(result);
+        if (error != "") {
+            qDebug() << "DeltaHandler::startQrBackupImport(): get_backup returned error: " << error;
+        }
+    }, 0);
 }
 
 
@@ -5261,6 +5307,42 @@ QString DeltaHandler::saveLog(QString logtext, QString datetime)
 }
 
 
+QString DeltaHandler::getEventLog()
+{
+    return eventThread->eventLog()->render();
+}
+
+
+bool DeltaHandler::profilerIsEnabled()
+{
+    return Profiler::isEnabled();
+}
+
+
+void DeltaHandler::setProfilerEnabled(bool enabled)
+{
+    Profiler::setEnabled(enabled);
+}
+
+
+QVariantList DeltaHandler::getProfilerSummary()
+{
+    return Profiler::instance().summary();
+}
+
+
+QString DeltaHandler::exportProfilerTrace()
+{
+    return Profiler::instance().exportChromeTrace();
+}
+
+
+void DeltaHandler::resetProfiler()
+{
+    Profiler::instance().reset();
+}
+
+
 dc_jsonrpc_instance_t* DeltaHandler::getJsonrpcInstance()
 {
     return m_jsonrpcInstance;
@@ -5289,6 +5371,14 @@ void DeltaHandler::contextSetupTasks()
     m_currentAccID = dc_get_id(currentContext);
     m_notificationHelper->setCurrentAccId(m_currentAccID);
 
+    // Events of inactive accounts don't reach processSignalQueue(),
+    // so cached chatlist entries may be outdated by now. The cache
+    // will be filled again by data().
+    m_chatlistRowCache.clear();
+    m_chatlistRowsPending.clear();
+    m_chatlistRowsToFetch.clear();
+    clearMuteExpiries();
+
     m_contactsmodel->updateContext(currentContext);
 
     dc_array_t* tempArray = dc_get_fresh_msgs(currentContext);
@@ -5405,18 +5495,50 @@ void DeltaHandler::selectAndOpenLastChatId()
 
 void DeltaHandler::periodicTimerActions()
 {
-    // currently the only periodically triggered
-    // action is to check for changes in ChatIsMutedRole
+    // currently the only periodically triggered action is to check
+    // for expired mutes. Normally, m_muteExpiryTimer takes care of
+    // this, but it doesn't fire while the app is suspended.
     if (m_hasConfiguredAccount) {
+        processMuteExpiries();
+    }
+}
+
+
+void DeltaHandler::processMuteExpiries()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    std::vector<uint32_t> chatIDs;
 
-        //QVector<int> roleVector;
-        //roleVector.append(DeltaHandler::ChatIsMutedRole);
+    while (!m_muteExpiryHeap.empty() && m_muteExpiryHeap.top().expiresAt <= now) {
+        MuteExpiryStruct tempStruct = m_muteExpiryHeap.top();
+        m_muteExpiryHeap.pop();
 
-        for (size_t i = 0; i < m_chatlistVector.size(); ++i) {
-            //emit dataChanged(index(i, 0), index(i, 0), roleVector);
-            emit dataChanged(index(i, 0), index(i, 0));
+        quint64 key = chatlistCacheKey(tempStruct.accID, tempStruct.chatID);
+        if (m_muteExpiries.value(key, -1) != tempStruct.expiresAt) {
+            // outdated entry
+            continue;
         }
+        m_muteExpiries.remove(key);
+
+        if (tempStruct.accID != m_currentAccID) {
+            continue;
+        }
+
+        // The mute duration might have been extended by another device
+        // without the expiry being re-scheduled, so check again. The
+        // chat is re-fetched in any case, but the view is only notified
+        // (for IsMutedRole) if the mute state has actually changed, see
+        // chatlistRowsFetched().
+        scheduleMuteExpiry(tempStruct.chatID);
+        chatIDs.push_back(tempStruct.chatID);
+    }
+
+    if (!chatIDs.empty()) {
+        invalidateChatlistRows(chatIDs);
+        requestQueuedChatlistRows();
     }
+
+    rearmMuteExpiryTimer();
 }
 
 
@@ -5543,23 +5665,9 @@ void DeltaHandler::resetCurrentChatMessageCount()
     updateCurrentChatMessageCount();
 
     // inform m_accountsmodel (needed for update of sidebar)
-    // m_signalQueue_accountsmodelInfo is for m_accountsmodel,
-    // make sure to avoid duplicate entries already here
-    bool found {false};
-    for (size_t i = 0; i < m_signalQueue_accountsmodelInfo.size(); ++i) {
-        if (m_currentAccID == m_signalQueue_accountsmodelInfo[i]) {
-            found = true;
-        }
-    }
+    m_eventCoalescer.markFreshMsgCountStale(m_currentAccID);
 
-    if (!found) {
-        m_signalQueue_accountsmodelInfo.push_back(m_currentAccID);
-    }
-
-    if (!m_signalQueueTimer->isActive()) {
-        processSignalQueue();
-        m_signalQueueTimer->start(queueTimerFreq);
-    }
+    scheduleSignalQueue();
 }
 
 
@@ -5703,12 +5811,38 @@ void DeltaHandler::shutdownTasks()
     m_chatmodel->saveDraft();
     disconnect(m_signalQueueTimer, SIGNAL(timeout()), this, SLOT(processSignalQueueTimerTimeout()));
 
-    QDir cachepath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
-    cachepath.removeRecursively();
-
     m_stopThreads = true;
+
+    // m_messageSendThread sends all messages that are still
+    // queued before terminating, give it some time for this
+    m_messageSendThread->wakeUpForStop();
+    if (!(m_messageSendThread->wait(10000))) {
+        qDebug() << "DeltaHandler::shutdownTasks(): waiting for m_messageSendThread timed out, not clearing the cache.";
+    } else {
+        // Queued messages may have attachments in the cache
+        // (see copyToCache() in ChatModel), so it can only be
+        // cleared after m_messageSendThread has sent them
+        QDir cachepath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        cachepath.removeRecursively();
+    }
+
     dc_accounts_stop_io(allAccounts);
 
+    // a search that is already running can't be aborted, but
+    // its result is not needed anymore
+    m_messageSearchThread->wakeUpForStop();
+    if (!(m_messageSearchThread->wait(1000))) {
+        qDebug() << "DeltaHandler::shutdownTasks(): waiting for m_messageSearchThread timed out.";
+    }
+    m_globalsearchmodel->stopThreads();
+
+    // m_chatlistFetcherThread uses m_jsonrpcInstance, so it has
+    // to be finished before m_jsonrpcResponseThread unrefs it
+    m_chatlistFetcherThread->wakeUpForStop();
+    if (!(m_chatlistFetcherThread->wait(1000))) {
+        qDebug() << "DeltaHandler::shutdownTasks(): waiting for m_chatlistFetcherThread timed out.";
+    }
+
     // to unblock the loop in m_jsonrpcResponseThread
     sendJsonrpcRequest(constructJsonrpcRequestString("get_system_info", ""));
 
@@ -5731,6 +5865,11 @@ void DeltaHandler::shutdownTasks()
         m_chatmodel = nullptr;
     }
 
+    if (m_globalsearchmodel) {
+        delete m_globalsearchmodel;
+        m_globalsearchmodel = nullptr;
+    }
+
     if (m_accountsmodel) {
         delete m_accountsmodel;
         m_accountsmodel = nullptr;
@@ -5804,6 +5943,18 @@ void DeltaHandler::addClosedAccountToList(uint32_t accID)
 }
 
 
+void DeltaHandler::accountDataChangedByCore(uint32_t accID)
+{
+    if (accID == m_currentAccID) {
+        // also updates the header of the chatlist, and m_accountsmodel
+        // via AccountsModel::currentAccountDataChanged()
+        emit accountDataChanged();
+    } else {
+        m_accountsmodel->refreshAccountData(accID);
+    }
+}
+
+
 void DeltaHandler::connectivityUpdate(uint32_t accID)
 {
     if (currentContext) {
@@ -5848,13 +5999,19 @@ uint32_t DeltaHandler::getJsonrpcRequestId() const
 
 
 QString DeltaHandler::constructJsonrpcRequestString(QString method, QString arguments) const
+{
+    return constructJsonrpcRequestString(method, arguments, getJsonrpcRequestId());
+}
+
+
+QString DeltaHandler::constructJsonrpcRequestString(QString method, QString arguments, uint32_t requestId) const
 {
     QString requestString("{ \"jsonrpc\": \"2.0\", \"method\": \"");
     requestString.append(method);
     requestString.append("\", \"id\": ");
 
     QString tempString;
-    tempString.setNum(getJsonrpcRequestId());
+    tempString.setNum(requestId);
     requestString.append(tempString);
 
     requestString.append(", \"params\": [");
@@ -5867,70 +6024,168 @@ QString DeltaHandler::constructJsonrpcRequestString(QString method, QString argu
 
 void DeltaHandler::refreshChatlistVector(dc_chatlist_t* tempChatlist)
 {
-    size_t templistSize = dc_chatlist_get_cnt(tempChatlist);
-    size_t internalVectorSize = m_chatlistVector.size();
-
-    std::vector<uint32_t>::iterator it;
-
-    for (size_t i = 0; i < templistSize; ++i) {
-        size_t j;
-        uint32_t tempChatID = dc_chatlist_get_chat_id(tempChatlist, i);
-
-        for (j = i; j < internalVectorSize; ++j) {
-            if (m_chatlistVector[j] == tempChatID) {
-                // if j == i, then the chat is already at the right place
-                if (j != i) {
-                    it = m_chatlistVector.begin();
-
-                    if (1 == j - i) {
-                        // if j is the next higher neighbor of i, then
-                        // it's likely that the chat at i has either been deleted
-                        // or it was a pinned chat that's now unpinned. Even
-                        // in the second case it's probably more effective to
-                        // just delete it and insert it back again later on
-                        // than to move a whole lot of chats one index down.
-                        beginRemoveRows(QModelIndex(), i, i);
-                        m_chatlistVector.erase(it+i);
-                        it = m_chatlistVector.begin();
-                        internalVectorSize--;
-                        endRemoveRows();
-                    } else {
-                        beginMoveRows(QModelIndex(), j, j, QModelIndex(), i);
-                        
-                        // move m_chatlistVector[j] to m_chatlistVector[i],
-                        // this has to be achieved via erasing and inserting
-                        // Just using
-                        // m_chatlistVector[i] = m_chatlistVector[j]
-                        // doesn't do the trick because then the view and
-                        // m_chatlistVector might differ at some indices:
-                        // The view will shift every item between i and j
-                        // to one higher index, which the vector doesn't
-                        m_chatlistVector.erase(it+j);
-                        m_chatlistVector.insert(it+i, tempChatID);
-
-                        endMoveRows();
-                    }
-                }
-                break;
-            }
+    DT_PROFILE_SCOPE("DeltaHandler::refreshChatlistVector");
+
+    // Adapts m_chatlistVector to tempChatlist with as few
+    // remove/move/insert operations as possible, and each operation
+    // covers a whole range of rows if possible:
+    // 1. Remove all chats that are not in tempChatlist anymore.
+    // 2. Determine the chats that don't have to be moved: These are
+    //    the ones forming the longest increasing subsequence of
+    //    their new positions, in the order of m_chatlistVector.
+    // 3. Walk through the new chatlist and move all other chats (or
+    //    insert them, if they are new) directly behind their
+    //    predecessor in the new list.
+    //
+    // If, e.g., a single chat jumps to the top, this results in
+    // exactly one beginMoveRows()/endMoveRows().
+    size_t newSize = dc_chatlist_get_cnt(tempChatlist);
+
+    std::vector<uint32_t> newChatlist(newSize);
+    QHash<uint32_t, int> newPositions;
+    newPositions.reserve(newSize);
+
+    for (size_t i = 0; i < newSize; ++i) {
+        newChatlist[i] = dc_chatlist_get_chat_id(tempChatlist, i);
+        newPositions.insert(newChatlist[i], i);
+    }
+
+    // 1. Remove chats, starting from the end so that the indices of
+    //    the ranges found later on are still valid
+    int rangeEnd = static_cast<int>(m_chatlistVector.size()) - 1;
+    while (rangeEnd >= 0) {
+        if (newPositions.contains(m_chatlistVector[rangeEnd])) {
+            --rangeEnd;
+            continue;
         }
 
-        if (j == internalVectorSize) {
-        // Chat at i in tempChatlist was not present in m_chatlistVector, insert it
-            it = m_chatlistVector.begin();
-            beginInsertRows(QModelIndex(), i, i);
-            m_chatlistVector.insert(it+i, tempChatID);
-            internalVectorSize++;
+        int rangeStart = rangeEnd;
+        while (rangeStart > 0 && !newPositions.contains(m_chatlistVector[rangeStart - 1])) {
+            --rangeStart;
+        }
 
-            endInsertRows();
+        beginRemoveRows(QModelIndex(), rangeStart, rangeEnd);
+        m_chatlistVector.erase(m_chatlistVector.begin() + rangeStart, m_chatlistVector.begin() + rangeEnd + 1);
+        endRemoveRows();
+
+        rangeEnd = rangeStart - 1;
+    }
+
+    // 2. Longest increasing subsequence of the new positions of the
+    //    remaining chats (O(n log n)). tailIndices[k] is the index (in
+    //    m_chatlistVector) of the last element of the best subsequence
+    //    of length k + 1 found so far, predecessors is used to
+    //    reconstruct the subsequence afterwards.
+    size_t oldSize = m_chatlistVector.size();
+    std::vector<int> positionsOfOld(oldSize);
+    std::vector<int> tailIndices;
+    std::vector<int> predecessors(oldSize, -1);
+
+    for (size_t i = 0; i < oldSize; ++i) {
+        positionsOfOld[i] = newPositions.value(m_chatlistVector[i]);
+
+        std::vector<int>::iterator it = std::lower_bound(tailIndices.begin(), tailIndices.end(), positionsOfOld[i], [&positionsOfOld](int tailIndex, int pos) {
+                return positionsOfOld[tailIndex] < pos;
+        });
+
+        if (it != tailIndices.begin()) {
+            predecessors[i] = *(it - 1);
+        }
+
+        if (it == tailIndices.end()) {
+            tailIndices.push_back(i);
+        } else {
+            *it = i;
         }
     }
 
-    if (internalVectorSize > templistSize) {
-        beginRemoveRows(QModelIndex(), templistSize, internalVectorSize - 1);
-        m_chatlistVector.resize(templistSize);
-        // internalVectorSize = templistSize;
-        endRemoveRows();
+    // isStable and isPresent are indexed by the position in the new chatlist
+    std::vector<bool> isStable(newSize, false);
+    std::vector<bool> isPresent(newSize, false);
+
+    for (size_t i = 0; i < oldSize; ++i) {
+        isPresent[positionsOfOld[i]] = true;
+    }
+
+    if (!tailIndices.empty()) {
+        int i = tailIndices.back();
+        while (i != -1) {
+            isStable[positionsOfOld[i]] = true;
+            i = predecessors[i];
+        }
+    }
+
+    // 3. Move and insert. predecessorPos is the current position of
+    //    newChatlist[i - 1] in m_chatlistVector, -1 for i == 0.
+    int predecessorPos = -1;
+    size_t i = 0;
+
+    while (i < newSize) {
+        if (isStable[i]) {
+            // This chat is somewhere behind its predecessor
+            int pos = predecessorPos + 1;
+            while (m_chatlistVector[pos] != newChatlist[i]) {
+                ++pos;
+            }
+            predecessorPos = pos;
+            ++i;
+
+        } else if (!isPresent[i]) {
+            // New chat(s), insert all consecutive new ones at once
+            size_t runEnd = i + 1;
+            while (runEnd < newSize && !isPresent[runEnd]) {
+                ++runEnd;
+            }
+
+            int insertPos = predecessorPos + 1;
+            beginInsertRows(QModelIndex(), insertPos, insertPos + (runEnd - i) - 1);
+            m_chatlistVector.insert(m_chatlistVector.begin() + insertPos, newChatlist.begin() + i, newChatlist.begin() + runEnd);
+            endInsertRows();
+
+            for (size_t j = i; j < runEnd; ++j) {
+                m_chatlistRowsToFetch.push_back(newChatlist[j]);
+            }
+
+            predecessorPos = insertPos + (runEnd - i) - 1;
+            i = runEnd;
+
+        } else {
+            // Chat that has to be moved. If the following chats in the
+            // new list have to be moved as well and are directly behind
+            // it in m_chatlistVector, move them as a block.
+            int sourcePos = std::find(m_chatlistVector.begin(), m_chatlistVector.end(), newChatlist[i]) - m_chatlistVector.begin();
+            size_t runEnd = i + 1;
+            int sourceEnd = sourcePos;
+
+            while (runEnd < newSize && isPresent[runEnd] && !isStable[runEnd] && sourceEnd + 1 < static_cast<int>(m_chatlistVector.size()) && m_chatlistVector[sourceEnd + 1] == newChatlist[runEnd]) {
+                ++runEnd;
+                ++sourceEnd;
+            }
+
+            int blockLength = sourceEnd - sourcePos + 1;
+            int destination = predecessorPos + 1;
+
+            if (destination >= sourcePos && destination <= sourceEnd + 1) {
+                // already at the right place
+                predecessorPos = sourceEnd;
+            } else {
+                beginMoveRows(QModelIndex(), sourcePos, sourceEnd, QModelIndex(), destination);
+
+                if (destination < sourcePos) {
+                    // moving up
+                    std::rotate(m_chatlistVector.begin() + destination, m_chatlistVector.begin() + sourcePos, m_chatlistVector.begin() + sourceEnd + 1);
+                    predecessorPos = destination + blockLength - 1;
+                } else {
+                    // moving down, the predecessor will move up by blockLength
+                    std::rotate(m_chatlistVector.begin() + sourcePos, m_chatlistVector.begin() + sourceEnd + 1, m_chatlistVector.begin() + destination);
+                    predecessorPos = destination - 1;
+                }
+
+                endMoveRows();
+            }
+
+            i = runEnd;
+        }
     }
 }
 
@@ -5948,18 +6203,349 @@ void DeltaHandler::resetChatlistVector(dc_chatlist_t* tempChatlist)
 }
 
 
+quint64 DeltaHandler::chatlistCacheKey(uint32_t accID, uint32_t chatID)
+{
+    return (static_cast<quint64>(accID) << 32) | chatID;
+}
+
+
+void DeltaHandler::prefetchChatlistRows(int firstRow, int lastRow) const
+{
+    if (firstRow < 0) {
+        firstRow = 0;
+    }
+
+    if (lastRow >= static_cast<int>(m_chatlistVector.size())) {
+        lastRow = static_cast<int>(m_chatlistVector.size()) - 1;
+    }
+
+    std::vector<uint32_t> chatIDs;
+
+    for (int i = firstRow; i <= lastRow; ++i) {
+        quint64 key = chatlistCacheKey(m_currentAccID, m_chatlistVector[i]);
+
+        if (m_chatlistRowsPending.contains(key)) {
+            continue;
+        }
+
+        QHash<quint64, ChatlistRowCacheEntry>::const_iterator it = m_chatlistRowCache.constFind(key);
+        if (it == m_chatlistRowCache.constEnd() || it->isStale) {
+            chatIDs.push_back(m_chatlistVector[i]);
+            m_chatlistRowsPending.insert(key);
+        }
+    }
+
+    m_chatlistFetcherThread->requestChats(m_currentAccID, chatIDs);
+}
+
+
+void DeltaHandler::invalidateChatlistRows(const std::vector<uint32_t> &chatIDs)
+{
+    for (size_t i = 0; i < chatIDs.size(); ++i) {
+        quint64 key = chatlistCacheKey(m_currentAccID, chatIDs[i]);
+        QHash<quint64, ChatlistRowCacheEntry>::iterator it = m_chatlistRowCache.find(key);
+
+        // Chats that are not cached will be fetched once
+        // the view asks for them
+        if (it != m_chatlistRowCache.end()) {
+            it->isStale = true;
+            // Request it even if it's in m_chatlistRowsPending, a
+            // pending request might have been sent before the chat
+            // has changed.
+            m_chatlistRowsPending.remove(key);
+            m_chatlistRowsToFetch.push_back(chatIDs[i]);
+        }
+    }
+}
+
+
+void DeltaHandler::invalidateAllChatlistRows()
+{
+    // only chats that are part of the current chatlist are
+    // re-fetched, all other cache entries are removed
+    QHash<quint64, ChatlistRowCacheEntry> tempCache;
+
+    for (size_t i = 0; i < m_chatlistVector.size(); ++i) {
+        quint64 key = chatlistCacheKey(m_currentAccID, m_chatlistVector[i]);
+        QHash<quint64, ChatlistRowCacheEntry>::const_iterator it = m_chatlistRowCache.constFind(key);
+
+        if (it != m_chatlistRowCache.constEnd()) {
+            ChatlistRowCacheEntry tempEntry = it.value();
+            tempEntry.isStale = true;
+            tempCache.insert(key, tempEntry);
+            m_chatlistRowsPending.remove(key);
+            m_chatlistRowsToFetch.push_back(m_chatlistVector[i]);
+        }
+    }
+
+    m_chatlistRowCache.swap(tempCache);
+}
+
+
+void DeltaHandler::requestQueuedChatlistRows()
+{
+    std::vector<uint32_t> chatIDs;
+
+    for (size_t i = 0; i < m_chatlistRowsToFetch.size(); ++i) {
+        quint64 key = chatlistCacheKey(m_currentAccID, m_chatlistRowsToFetch[i]);
+
+        if (m_chatlistRowsPending.contains(key)) {
+            // already requested or contained twice in m_chatlistRowsToFetch
+            continue;
+        }
+
+        QHash<quint64, ChatlistRowCacheEntry>::const_iterator it = m_chatlistRowCache.constFind(key);
+        if (it == m_chatlistRowCache.constEnd() || it->isStale) {
+            chatIDs.push_back(m_chatlistRowsToFetch[i]);
+            m_chatlistRowsPending.insert(key);
+        }
+    }
+
+    m_chatlistRowsToFetch.clear();
+    m_chatlistFetcherThread->requestChats(m_currentAccID, chatIDs);
+}
+
+
+void DeltaHandler::chatlistRowsFetched(uint32_t accID, std::vector<uint32_t> requestedChatIDs, QVector<ChatlistItem> chatlistItems)
+{
+    for (size_t i = 0; i < requestedChatIDs.size(); ++i) {
+        m_chatlistRowsPending.remove(chatlistCacheKey(accID, requestedChatIDs[i]));
+    }
+
+    // chatlistItems might miss some of the requested chats (e.g., if a
+    // chat has been deleted in the meantime). Only chats whose data has
+    // actually changed are collected in changedChatIDs, along with the
+    // affected roles. If there was no entry before, all roles have to be
+    // refreshed, which is expressed by allRolesChanged.
+    QSet<uint32_t> changedChatIDs;
+    QVector<int> changedRoles;
+    bool allRolesChanged = false;
+
+    for (int i = 0; i < chatlistItems.size(); ++i) {
+        quint64 key = chatlistCacheKey(accID, chatlistItems[i].chatID);
+        QHash<quint64, ChatlistRowCacheEntry>::iterator it = m_chatlistRowCache.find(key);
+
+        // The mute duration is not part of the chatlist entry, so it's
+        // only checked if a muted chat shows up for the first time or
+        // if a chat has been muted. Re-mutes via the app are scheduled in
+        // momentaryChatSetMuteDuration().
+        if (accID == m_currentAccID && chatlistItems[i].isMuted && (it == m_chatlistRowCache.end() || !it->item.isMuted)) {
+            scheduleMuteExpiry(chatlistItems[i].chatID);
+        }
+
+        if (it == m_chatlistRowCache.end()) {
+            ChatlistRowCacheEntry tempEntry;
+            tempEntry.item = chatlistItems[i];
+            tempEntry.isStale = false;
+            m_chatlistRowCache.insert(key, tempEntry);
+
+            changedChatIDs.insert(chatlistItems[i].chatID);
+            allRolesChanged = true;
+        } else {
+            QVector<int> tempRoles = changedChatlistRoles(it->item, chatlistItems[i]);
+            it->item = chatlistItems[i];
+            it->isStale = false;
+
+            if (!tempRoles.isEmpty()) {
+                changedChatIDs.insert(chatlistItems[i].chatID);
+                for (int j = 0; j < tempRoles.size(); ++j) {
+                    if (!changedRoles.contains(tempRoles[j])) {
+                        changedRoles.append(tempRoles[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Requested chats that are missing in the response get a
+    // placeholder entry (or keep their previous data), otherwise
+    // each call of data() for their row would request them again.
+    // They are fetched again once they are invalidated.
+    if (static_cast<size_t>(chatlistItems.size()) != requestedChatIDs.size()) {
+        QSet<uint32_t> receivedChatIDs;
+        for (int i = 0; i < chatlistItems.size(); ++i) {
+            receivedChatIDs.insert(chatlistItems[i].chatID);
+        }
+
+        for (size_t i = 0; i < requestedChatIDs.size(); ++i) {
+            if (receivedChatIDs.contains(requestedChatIDs[i])) {
+                continue;
+            }
+
+            quint64 key = chatlistCacheKey(accID, requestedChatIDs[i]);
+            QHash<quint64, ChatlistRowCacheEntry>::iterator it = m_chatlistRowCache.find(key);
+            if (it == m_chatlistRowCache.end()) {
+                ChatlistRowCacheEntry tempEntry;
+                tempEntry.item.chatID = requestedChatIDs[i];
+                tempEntry.isStale = false;
+                m_chatlistRowCache.insert(key, tempEntry);
+            } else {
+                it->isStale = false;
+            }
+        }
+    }
+
+    if (accID != m_currentAccID || changedChatIDs.isEmpty()) {
+        return;
+    }
+
+    std::vector<int> rows;
+    for (size_t i = 0; i < m_chatlistVector.size(); ++i) {
+        if (changedChatIDs.contains(m_chatlistVector[i])) {
+            rows.push_back(i);
+        }
+    }
+
+    if (allRolesChanged) {
+        changedRoles.clear();
+    }
+
+    DataChangedHelper::emitForRows(this, rows, changedRoles);
+}
+
+
+void DeltaHandler::scheduleMuteExpiry(uint32_t chatID)
+{
+    quint64 key = chatlistCacheKey(m_currentAccID, chatID);
+
+    dc_chat_t* tempChat = dc_get_chat(currentContext, chatID);
+    if (!tempChat) {
+        m_muteExpiries.remove(key);
+        return;
+    }
+
+    // 0 if not muted, -1 if muted forever
+    int64_t remainingSeconds = dc_chat_get_remaining_mute_duration(tempChat);
+    dc_chat_unref(tempChat);
+
+    if (remainingSeconds <= 0) {
+        m_muteExpiries.remove(key);
+        return;
+    }
+
+    // round up to the next second so that the mute has
+    // definitely ended once the timer fires
+    qint64 expiresAt = QDateTime::currentMSecsSinceEpoch() + (remainingSeconds + 1) * 1000;
+
+    m_muteExpiries.insert(key, expiresAt);
+    m_muteExpiryHeap.push(MuteExpiryStruct { expiresAt, m_currentAccID, chatID });
+
+    rearmMuteExpiryTimer();
+}
+
+
+void DeltaHandler::rearmMuteExpiryTimer()
+{
+    // remove outdated entries from the top so the
+    // timer doesn't fire for nothing
+    while (!m_muteExpiryHeap.empty()) {
+        const MuteExpiryStruct &top = m_muteExpiryHeap.top();
+        if (m_muteExpiries.value(chatlistCacheKey(top.accID, top.chatID), -1) == top.expiresAt) {
+            break;
+        }
+        m_muteExpiryHeap.pop();
+    }
+
+    if (m_muteExpiryHeap.empty()) {
+        m_muteExpiryTimer->stop();
+        return;
+    }
+
+    qint64 interval = m_muteExpiryHeap.top().expiresAt - QDateTime::currentMSecsSinceEpoch();
+
+    if (interval < 0) {
+        interval = 0;
+    } else if (interval > maxMuteExpiryTimerInterval) {
+        // processMuteExpiries() will just re-arm the timer
+        interval = maxMuteExpiryTimerInterval;
+    }
+
+    m_muteExpiryTimer->start(static_cast<int>(interval));
+}
+
+
+void DeltaHandler::clearMuteExpiries()
+{
+    m_muteExpiryTimer->stop();
+    m_muteExpiries.clear();
+    m_muteExpiryHeap = std::priority_queue<MuteExpiryStruct, std::vector<MuteExpiryStruct>, MuteExpiryIsLater>();
+}
+
+
+QVector<int> DeltaHandler::changedChatlistRoles(const ChatlistItem &oldItem, const ChatlistItem &newItem)
+{
+    QVector<int> roles;
+
+    if (oldItem.isArchiveLink != newItem.isArchiveLink) {
+        roles.append(IsArchiveLinkRole);
+    }
+
+    if (oldItem.name != newItem.name) {
+        roles.append(ChatNameRole);
+        roles.append(AvatarInitialRole);
+    }
+
+    if (oldItem.avatarPath != newItem.avatarPath) {
+        roles.append(AvatarPathRole);
+    }
+
+    if (oldItem.color != newItem.color) {
+        roles.append(ChatColorRole);
+    }
+
+    if (oldItem.summaryText1 != newItem.summaryText1) {
+        roles.append(SummaryText1Role);
+    }
+
+    if (oldItem.summaryText2 != newItem.summaryText2) {
+        roles.append(SummaryText2Role);
+    }
+
+    if (oldItem.summaryStatus != newItem.summaryStatus) {
+        roles.append(SummaryStatusRole);
+    }
+
+    if (oldItem.lastUpdated != newItem.lastUpdated) {
+        roles.append(LastUpdatedRole);
+    }
+
+    if (oldItem.freshMessageCounter != newItem.freshMessageCounter) {
+        roles.append(FreshMsgCountRole);
+    }
+
+    if (oldItem.isProtected != newItem.isProtected) {
+        roles.append(IsProtectedRole);
+    }
+
+    if (oldItem.isMuted != newItem.isMuted) {
+        roles.append(IsMutedRole);
+    }
+
+    if (oldItem.isPinned != newItem.isPinned) {
+        roles.append(IsPinnedRole);
+    }
+
+    if (oldItem.isArchived != newItem.isArchived) {
+        roles.append(IsArchivedRole);
+    }
+
+    if (oldItem.isContactRequest != newItem.isContactRequest) {
+        roles.append(IsContactRequestRole);
+    }
+
+    return roles;
+}
+
+
 bool DeltaHandler::isQueueEmpty()
 {
-    return (!m_signalQueue_refreshChatlist \
-            && m_signalQueue_chatsDataChanged.empty() \
-            && m_signalQueue_chatsNoticed.empty() \
-            && m_signalQueue_msgs.empty() \
-            && m_signalQueue_notificationsToRemove.empty());
+    return m_eventCoalescer.isEmpty();
 }
 
 
 void DeltaHandler::removeActiveNotificationsOfChat(uint32_t accID, int chatID)
 {
+    m_notificationHelper->removePendingMessagesOfChat(accID, chatID);
     m_notificationHelper->removeActiveNotificationsOfChat(accID, chatID);
 }
 
@@ -32,13 +32,20 @@
 
 #include "accountsmodel.h"
 #include "blockedcontactsmodel.h"
+#include "chatlistfetcherthread.h"
 #include "chatmodel.h"
+#include "contactCache.h"
 #include "contactsmodel.h"
 #include "dbusUrlReceiver.h"
 #include "emitterthread.h"
+#include "eventCoalescer.h"
 #include "fileImportSignalHelper.h"
+#include "globalsearchmodel.h"
 #include "groupmembermodel.h"
+#include "jsonrpcclient.h"
 #include "jsonrpcresponsethread.h"
+#include "messagesearchthread.h"
+#include "messagesendthread.h"
 #include "notificationHelper.h"
 #include "workflowConvertDbToEncrypted.h"
 #include "workflowConvertDbToUnencrypted.h"
@@ -46,18 +53,39 @@
 #include "../deltachat.h"
 #include "quirc.h"
 
-struct AccIdAndChatIdStruct {
+// Entry of DeltaHandler::m_muteExpiryHeap
+struct MuteExpiryStruct {
+    // milliseconds since epoch
+    qint64 expiresAt;
     uint32_t accID;
-    int chatID;
+    uint32_t chatID;
+};
+
+// to turn std::priority_queue into a min-heap
+struct MuteExpiryIsLater {
+    bool operator()(const MuteExpiryStruct &a, const MuteExpiryStruct &b) const {
+        return a.expiresAt > b.expiresAt;
+    }
+};
+
+// Entry of DeltaHandler::m_chatlistRowCache
+struct ChatlistRowCacheEntry {
+    ChatlistItem item;
+    // set if the chat has changed, but the new data
+    // has not been fetched yet
+    bool isStale;
 };
 
 class ChatModel;
 class AccountsModel;
 class EmitterThread;
 class JsonrpcResponseThread;
+class JsonrpcClient;
+class ChatlistFetcherThread;
 class ContactsModel;
 class BlockedContactsModel;
 class GroupMemberModel;
+class GlobalSearchModel;
 class NotificationHelper;
 class NotificationsLomiriPostal;
 class NotificationsFreedesktop;
@@ -68,11 +96,15 @@ class DbusUrlReceiver;
 
 class DeltaHandler : public QAbstractListModel {
     Q_OBJECT
+
+    // benchmark/modelbenchmark.cpp drives the private hot paths directly
+    friend class ModelBenchmark;
+
 public:
     explicit DeltaHandler(QObject *parent = 0);
     ~DeltaHandler();
 
-    enum { ChatlistEntryRole, BasicChatInfoRole };
+    enum { ChatIdRole, IsArchiveLinkRole, ChatNameRole, AvatarPathRole, AvatarInitialRole, ChatColorRole, SummaryText1Role, SummaryText2Role, SummaryStatusRole, LastUpdatedRole, FreshMsgCountRole, IsProtectedRole, IsMutedRole, IsPinnedRole, IsArchivedRole, IsContactRequestRole };
     //enum { AccountIdRole, ChatlistEntryRole, ChatIdRole, BasicChatInfoRole };
 
     // TODO: belongs to ChatModel, but ChatModel isn't registered as
@@ -123,12 +155,24 @@ public:
 
     Q_INVOKABLE uint32_t getCurrentAccountId() const;
 
+    // shared by the models that display contacts
+    ContactCache* getContactCache() const;
+
+    // used by ChatModel to send messages outside of the GUI thread
+    MessageSendThread* getMessageSendThread() const;
+
+    // used by ChatModel to search messages outside of the GUI thread
+    MessageSearchThread* getMessageSearchThread() const;
+
     // returns the ID of the currently opened chat (-1 if no
     // chat opened)
     int getCurrentChatId() const;
 
     Q_INVOKABLE void sendJsonrpcRequest(QString request);
 
+    // for jsonrpc calls from C++ code that should not block
+    JsonrpcClient* getJsonrpcClient() const;
+
     Q_INVOKABLE QString sendJsonrpcBlockingCall(QString request) const;
 
     // Checks if a jsonrpc response from the core contains an
@@ -143,6 +187,7 @@ public:
     // Example for a method call:
     // constructJsonrpcRequestString("get_backup", "12, \"qrcode:xxxxx\"");
     Q_INVOKABLE QString constructJsonrpcRequestString(QString method, QString arguments) const;
+    QString constructJsonrpcRequestString(QString method, QString arguments, uint32_t requestId) const;
 
     // Parameter is the version for which the message applies,
     // not the message text itself
@@ -382,6 +427,19 @@ public:
 
     Q_INVOKABLE QString saveLog(QString logtext, QString datetime);
 
+    // The recent core events as kept in the EventLog of
+    // eventThread, as text. They are in the log file as well.
+    Q_INVOKABLE QString getEventLog();
+
+    // for the Profiler page, see Profiler
+    Q_INVOKABLE bool profilerIsEnabled();
+    // recording is off after the start of the app
+    Q_INVOKABLE void setProfilerEnabled(bool enabled);
+    Q_INVOKABLE QVariantList getProfilerSummary();
+    // returns the name of the file in the cache dir
+    Q_INVOKABLE QString exportProfilerTrace();
+    Q_INVOKABLE void resetProfiler();
+
     Q_INVOKABLE dc_jsonrpc_instance_t* getJsonrpcInstance();
     Q_INVOKABLE uint32_t getJsonrpcRequestId() const;
 
@@ -535,6 +593,7 @@ public:
     Q_PROPERTY(ContactsModel* contactsmodel READ contactsmodel NOTIFY contactsmodelChanged);
     Q_PROPERTY(BlockedContactsModel* blockedcontactsmodel READ blockedcontactsmodel NOTIFY blockedcontactsmodelChanged);
     Q_PROPERTY(GroupMemberModel* groupmembermodel READ groupmembermodel NOTIFY groupmembermodelChanged);
+    Q_PROPERTY(GlobalSearchModel* globalsearchmodel READ globalsearchmodel NOTIFY globalsearchmodelChanged);
     // Reason: GUI needs to connect to signal imexProgress from eventThread directly because
     // dc_receive_backup() blocks, so the DeltaHandler singleton will not pass the progress events
     // until dc_receive_backup() returns, and at this point, everything has already happened
@@ -549,6 +608,7 @@ public:
     ContactsModel* contactsmodel();
     BlockedContactsModel* blockedcontactsmodel();
     GroupMemberModel* groupmembermodel();
+    GlobalSearchModel* globalsearchmodel();
     EmitterThread* emitterthread();
     NotificationHelper* notificationHelper();
     WorkflowDbToEncrypted* workflowdbencryption();
@@ -580,6 +640,7 @@ signals:
     void contactsmodelChanged();
     void blockedcontactsmodelChanged();
     void groupmembermodelChanged();
+    void globalsearchmodelChanged();
     void emitterthreadChanged();
     void notificationHelperChanged();
     void workflowdbencryptionChanged();
@@ -698,12 +759,13 @@ public slots:
     void deleteQrDecoder();
     void prepareContactsmodelForGroupMemberAddition();
 
-    // Main.qml emits a signal every 5 minutes that is connected
-    // to this slot
+    // Main.qml emits a signal every 5 minutes (and when the app
+    // becomes active again) that is connected to this slot
     void periodicTimerActions();
     void updateChatlistQueryText(QString query);
     void getProviderHintSignal(QString emailAddress);
     void receiveJsonrcpResponse(QString response);
+    void chatlistRowsFetched(uint32_t accID, std::vector<uint32_t> requestedChatIDs, QVector<ChatlistItem> chatlistItems);
 
 protected:
     QHash<int, QByteArray> roleNames() const;
@@ -735,7 +797,11 @@ private slots:
     void resetPassphrase();
     void addClosedAccountToList(uint32_t accID);
     void connectivityUpdate(uint32_t accID);
+    // name or avatar of an account changed by the core, e.g. synced
+    // from another device
+    void accountDataChangedByCore(uint32_t accID);
     void processSignalQueueTimerTimeout();
+    void processMuteExpiries();
     void internalOpenOskViaDbus();
     void startQrBackupImport();
 
@@ -756,8 +822,42 @@ private:
 
     EmitterThread* eventThread;
     JsonrpcResponseThread* m_jsonrpcResponseThread;
+    JsonrpcClient* m_jsonrpcClient;
     dc_jsonrpc_instance_t* m_jsonrpcInstance;
+
+    // Cache for the data of the chatlist, keyed by
+    // chatlistCacheKey(accID, chatID). Filled by
+    // m_chatlistFetcherThread, so data() doesn't have to
+    // do any jsonrpc calls itself.
+    ChatlistFetcherThread* m_chatlistFetcherThread;
+
+    MessageSendThread* m_messageSendThread;
+    MessageSearchThread* m_messageSearchThread;
+    mutable QHash<quint64, ChatlistRowCacheEntry> m_chatlistRowCache;
+    // keys of the chats that have been requested from
+    // m_chatlistFetcherThread, but not received yet
+    mutable QSet<quint64> m_chatlistRowsPending;
+    // chat IDs that have become dirty or were added to the
+    // chatlist during the current processSignalQueue() run, will
+    // be requested at once via requestQueuedChatlistRows()
+    std::vector<uint32_t> m_chatlistRowsToFetch;
+
+    // Scheduler for the end of temporary chat mutes of the current
+    // account. m_muteExpiries contains the valid expiry time per
+    // chatlistCacheKey(). Entries in m_muteExpiryHeap that don't match
+    // m_muteExpiries are outdated and just skipped. m_muteExpiryTimer
+    // always fires when the earliest entry of the heap expires.
+    std::priority_queue<MuteExpiryStruct, std::vector<MuteExpiryStruct>, MuteExpiryIsLater> m_muteExpiryHeap;
+    QHash<quint64, qint64> m_muteExpiries;
+    QTimer* m_muteExpiryTimer;
+    // max interval of m_muteExpiryTimer, 1 day
+    static constexpr qint64 maxMuteExpiryTimerInterval = 86400000;
+    // number of rows above and below the requested row
+    // that are prefetched in case of a cache miss
+    static constexpr int chatlistPrefetchMargin = 20;
+    ContactCache* m_contactCache;
     ChatModel* m_chatmodel;
+    GlobalSearchModel* m_globalsearchmodel;
     AccountsModel* m_accountsmodel;
     BlockedContactsModel* m_blockedcontactsmodel;
     ContactsModel* m_contactsmodel;
@@ -835,23 +935,21 @@ private:
 
     mutable uint32_t m_jsonrpcRequestId;
 
-    // for the signal queue
-    bool m_signalQueue_refreshChatlist;
-
-    // queue for the active account
-    std::queue<int> m_signalQueue_chatsDataChanged;
-    std::queue<int> m_signalQueue_chatsNoticed;
-    std::queue<int> m_signalQueue_msgs;
-    std::queue<AccIdAndChatIdStruct> m_signalQueue_notificationsToRemove;
-
-    // vector for all accounts, will be used by m_accountsmodel,
-    // contains all accID/chatID combinations for which DeltaHandler::messagesChanged()
-    // was called
-    std::vector<uint32_t> m_signalQueue_accountsmodelInfo;
+    // Changes signalled by the core events that still have to be
+    // handled by processSignalQueue(), merged per account
+    EventCoalescer m_eventCoalescer;
 
     QTimer* m_signalQueueTimer;
 
-    static constexpr int queueTimerFreq = 1000;
+    // Used to measure the duration of processSignalQueue(), the
+    // interval of m_signalQueueTimer is adapted to it
+    QElapsedTimer m_signalQueueStopwatch;
+
+    // If processSignalQueue() is cheap, it runs once per frame at
+    // most. The more expensive it gets (large chatlists, many chats
+    // affected), the longer the interval, up to maxQueueTimerInterval.
+    static constexpr int minQueueTimerInterval = 16;
+    static constexpr int maxQueueTimerInterval = 1000;
 
     bool m_onUbuntuTouch;
     bool m_isDesktopMode;
@@ -870,6 +968,15 @@ private:
     void enableVerifiedOneOnOneForAllAccs();
     void addDeviceMessageToAllContexts(QString deviceMessage, QString messageLabel);
 
+    // Processes the queue immediately if nothing has been processed
+    // recently, otherwise the next timeout of m_signalQueueTimer will
+    // take care of it
+    void scheduleSignalQueue();
+
+    // Adds what is needed for a new or changed message to
+    // m_eventCoalescer, shared by incomingMessage() and
+    // messagesChanged()
+    void queueChangedMessage(uint32_t accID, int chatID, int msgID);
     void processSignalQueue();
     bool isQueueEmpty();
 
@@ -881,6 +988,32 @@ private:
     // beginResetModel() / endResetModel()
     void resetChatlistVector(dc_chatlist_t* tempChatlist);
 
+    static quint64 chatlistCacheKey(uint32_t accID, uint32_t chatID);
+
+    // requests all rows between firstRow and lastRow (including)
+    // that are not cached, stale or already requested
+    void prefetchChatlistRows(int firstRow, int lastRow) const;
+
+    // marks the entries of the passed chat IDs (of the current
+    // account) as stale and adds them to m_chatlistRowsToFetch. The
+    // view is notified via dataChanged once the new data has arrived.
+    void invalidateChatlistRows(const std::vector<uint32_t> &chatIDs);
+    void invalidateAllChatlistRows();
+
+    // requests all chats in m_chatlistRowsToFetch that are not cached,
+    // stale or already requested in one batch
+    void requestQueuedChatlistRows();
+
+    // checks the remaining mute duration of the chat (must be part of
+    // currentContext) and adds it to m_muteExpiryHeap if it's muted
+    // temporarily
+    void scheduleMuteExpiry(uint32_t chatID);
+    void rearmMuteExpiryTimer();
+    void clearMuteExpiries();
+
+    // returns the roles whose values differ between oldItem and newItem
+    static QVector<int> changedChatlistRoles(const ChatlistItem &oldItem, const ChatlistItem &newItem);
+
     void triggerProviderHintSignal(QString emailAddress);
 };
 
@@ -17,11 +17,28 @@
  */
 
 #include "emitterthread.h"
+#include "profiler.h"
+
+#include <set>
+#include <tuple>
 
 EmitterThread::EmitterThread(dc_accounts_t* accs, std::atomic<bool>* _stopLoop)
 {
     m_accounts = accs;
     m_stopLoop = _stopLoop;
+    m_drainScheduled = false;
+
+    // The EmitterThread object itself (in contrast to run()) lives
+    // in the GUI thread, and so does the timer
+    m_drainTimer = new QTimer(this);
+    m_drainTimer->setSingleShot(true);
+    m_drainTimer->setInterval(drainInterval);
+    bool connectSuccess = connect(m_drainTimer, SIGNAL(timeout()), this, SLOT(drainEventRing()));
+    if (!connectSuccess) {
+        qFatal("EmitterThread::EmitterThread(): Could not connect signal timeout of m_drainTimer to slot drainEventRing");
+    }
+
+    m_drainBatch.reserve(eventRingSize);
 }
 
 void EmitterThread::run()
@@ -40,6 +57,10 @@ void EmitterThread::run()
                 continue;
             }
 
+            // only the handling of the event, not the waiting for it
+            DT_PROFILE_SCOPE("EmitterThread::run (one event)");
+            DT_PROFILE_COUNT("Core events");
+
             int eventType {0};
             char* eventData2Str {nullptr};
             unsigned char* ucharPtr {nullptr};
@@ -49,43 +70,44 @@ void EmitterThread::run()
             int i;
 
             eventType = dc_event_get_id(event);
-            switch (eventType) {
-                case DC_EVENT_CHAT_EPHEMERAL_TIMER_MODIFIED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_CHAT_EPHEMERAL_TIMER_MODIFIED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", timer val in s or 0 for disabled timer: " << dc_event_get_data2_int(event);
-                    break;
 
+            // Except for the realtime data (binary, queried below),
+            // all string payloads are fetched here
+            if (DC_EVENT_DATA2_IS_STRING(eventType) || eventType == DC_EVENT_CONFIG_SYNCED) {
+                eventData2Str = dc_event_get_data2_str(event);
+            }
+
+            if (EventLog::isLogged(eventType) && eventType != DC_EVENT_WEBXDC_REALTIME_DATA) {
+                // data2 of DC_EVENT_WEBXDC_STATUS_UPDATE must not be queried
+                // to avoid "races in the status replication"
+                m_eventLog.append(eventType, dc_event_get_account_id(event), dc_event_get_data1_int(event), (eventType == DC_EVENT_WEBXDC_STATUS_UPDATE || eventData2Str) ? 0 : dc_event_get_data2_int(event), eventData2Str);
+            }
+
+            switch (eventType) {
                 case DC_EVENT_CHAT_MODIFIED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_CHAT_MODIFIED" << ", account " << dc_event_get_account_id(event) << ", chat id: " << dc_event_get_data1_int(event);
-                    emit chatDataModified(dc_event_get_account_id(event), dc_event_get_data1_int(event));
+                    pushEvent(EmitterEvent::ChatDataModified, dc_event_get_account_id(event), dc_event_get_data1_int(event), 0);
                     break;
 
                 case DC_EVENT_CONFIGURE_PROGRESS:
-                    eventData2Str = dc_event_get_data2_str(event);
                     if (eventData2Str) {
                         data2info = eventData2Str;
                     }
                     else {
                         data2info = "";
                     }
-                    qInfo().nospace() << "Emitter: DC_EVENT_CONFIGURE_PROGRESS" << ", account " << dc_event_get_account_id(event) << ", progress from 1 - 1000, 0 = error: " << dc_event_get_data1_int(event) << ", comment/error: " << qUtf8Printable(data2info);
                     emit configureProgress(dc_event_get_data1_int(event), data2info);
                     break;
 
                 case DC_EVENT_CONNECTIVITY_CHANGED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_CONNECTIVITY_CHANGED" << ", account " << dc_event_get_account_id(event);
-                    emit connectivityChanged(dc_event_get_account_id(event));
+                    pushEvent(EmitterEvent::ConnectivityChanged, dc_event_get_account_id(event), 0, 0);
                     break;
-                    
+
                 case DC_EVENT_CONTACTS_CHANGED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_CONTACTS_CHANGED" << ", account " << dc_event_get_account_id(event);
-                    emit contactsChanged();
+                    // contactDataChanged first so the ContactCache is
+                    // up to date once the models react to contactsChanged
+                    pushEvent(EmitterEvent::ContactsChanged, dc_event_get_account_id(event), dc_event_get_data1_int(event), 0);
                     break;
-                    
-                case DC_EVENT_DELETED_BLOB_FILE:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_DELETED_BLOB_FILE" << ", account " << dc_event_get_account_id(event) << ", path name: " << qUtf8Printable(eventData2Str);
-                    break;
-                    
+
                 case DC_EVENT_ERROR:
                     /*
                      * TODO:
@@ -99,142 +121,61 @@ void EmitterThread::run()
                      * showing these events until the function has really failed (returned false). It
                      * should be sufficient to report only the last error in a message box then.
                      */
-                    eventData2Str = dc_event_get_data2_str(event); 
-                    qInfo().nospace() << "Emitter: DC_EVENT_ERROR" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
                     emit errorEvent(eventData2Str);
                     break;
-                    
-                case DC_EVENT_ERROR_SELF_NOT_IN_GROUP:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_ERROR_SELF_NOT_IN_GROUP" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-                    
-                case DC_EVENT_IMAP_CONNECTED:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMAP_CONNECTED" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-                    
-                case DC_EVENT_IMAP_INBOX_IDLE:
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMAP_INBOX_IDLE" << ", account " << dc_event_get_account_id(event);
-                    break;
 
-                case DC_EVENT_IMAP_MESSAGE_DELETED:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMAP_MESSAGE_DELETED" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-                    
-                case DC_EVENT_IMAP_MESSAGE_MOVED:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMAP_MESSAGE_MOVED" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-                    
                 case DC_EVENT_IMEX_FILE_WRITTEN:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMEX_FILE_WRITTEN" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
                     data2info = eventData2Str;
                     emit imexFileWritten(data2info);
                     break;
-                    
+
                 case DC_EVENT_IMEX_PROGRESS:
-                    qInfo().nospace() << "Emitter: DC_EVENT_IMEX_PROGRESS" << ", account " << dc_event_get_account_id(event) << ", progress from 1 - 1000, 0 = error: " << dc_event_get_data1_int(event);
                     emit imexProgress(dc_event_get_data1_int(event));
                     break;
-                    
+
                 case DC_EVENT_INCOMING_MSG:
-                    qInfo().nospace() << "Emitter: DC_EVENT_INCOMING_MSG" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    emit newMsg(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::NewMsg, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
-                    
+
                 case DC_EVENT_INCOMING_MSG_BUNCH:
                     // TODO: might be removed from the event soon
-                    qInfo().nospace() << "Emitter: DC_EVENT_INCOMING_MSG_BUNCH" << ", account " << dc_event_get_account_id(event);
-                    emit incomingMsgBunch(dc_event_get_account_id(event));
-                    break;
-                    
-                case DC_EVENT_INFO: 
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_INFO" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-
-                case DC_EVENT_LOCATION_CHANGED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_LOCATION_CHANGED" << ", account " << dc_event_get_account_id(event) << ", contact_id: " << dc_event_get_data1_int(event);
+                    pushEvent(EmitterEvent::IncomingMsgBunch, dc_event_get_account_id(event), 0, 0);
                     break;
 
-                case DC_EVENT_MSG_DELETED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSG_DELETED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    break;
-
-
                 case DC_EVENT_MSG_DELIVERED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSG_DELIVERED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    emit msgDelivered(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::MsgDelivered, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
 
                 case DC_EVENT_MSG_FAILED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSG_FAILED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    emit msgFailed(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::MsgFailed, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
 
                 case DC_EVENT_MSG_READ:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSG_READ" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    emit msgRead(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::MsgRead, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
 
                 case DC_EVENT_MSGS_CHANGED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSGS_CHANGED" << ", account " << dc_event_get_account_id(event) << ", chat_id (if multiple: 0): " << dc_event_get_data1_int(event) << ", msg_id (if multiple: 0): " << dc_event_get_data2_int(event);
-                    emit msgsChanged(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::MsgsChanged, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
 
                 case DC_EVENT_MSGS_NOTICED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_MSGS_NOTICED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event);
-                    emit msgsNoticed(dc_event_get_account_id(event), dc_event_get_data1_int(event));
-                    break;
-
-                case DC_EVENT_NEW_BLOB_FILE:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_NEW_BLOB_FILE" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
+                    pushEvent(EmitterEvent::MsgsNoticed, dc_event_get_account_id(event), dc_event_get_data1_int(event), 0);
                     break;
 
                 case DC_EVENT_REACTIONS_CHANGED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_REACTIONS_CHANGED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event) << ", msg_id: " << dc_event_get_data2_int(event);
-                    emit reactionsChanged(dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
+                    pushEvent(EmitterEvent::ReactionsChanged, dc_event_get_account_id(event), dc_event_get_data1_int(event), dc_event_get_data2_int(event));
                     break;
 
-                case DC_EVENT_SECUREJOIN_INVITER_PROGRESS:
-                    qInfo().nospace() << "Emitter: DC_EVENT_SECUREJOIN_INVITER_PROGRESS" << ", account " << dc_event_get_account_id(event) << ", contact_id: " << dc_event_get_data1_int(event) << ", progress: " << dc_event_get_data2_int(event);
-                    break;
-
-                case DC_EVENT_SECUREJOIN_JOINER_PROGRESS:
-                    qInfo().nospace() << "Emitter: DC_EVENT_SECUREJOIN_JOINER_PROGRESS" << ", account " << dc_event_get_account_id(event) << ", contact_id: " << dc_event_get_data1_int(event) << ", progress: " << dc_event_get_data2_int(event);
-                    break;
-
-                case DC_EVENT_SELFAVATAR_CHANGED: 
-                    qInfo().nospace() << "Emitter: DC_EVENT_SELFAVATAR_CHANGED" << ", account " << dc_event_get_account_id(event);
-                    break;
-
-                case DC_EVENT_SMTP_CONNECTED:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_SMTP_CONNECTED" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-
-                case DC_EVENT_SMTP_MESSAGE_SENT:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_SMTP_MESSAGE_SENT" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
-                    break;
-
-                case DC_EVENT_WARNING:
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_WARNING" << ", account " << dc_event_get_account_id(event) << ": " << qUtf8Printable(eventData2Str);
+                case DC_EVENT_SELFAVATAR_CHANGED:
+                    pushEvent(EmitterEvent::AccountDataChanged, dc_event_get_account_id(event), 0, 0);
                     break;
 
                 case DC_EVENT_WEBXDC_INSTANCE_DELETED:
-                    qInfo().nospace() << "Emitter: DC_EVENT_WEBXDC_INSTANCE_DELETED" << ", account " << dc_event_get_account_id(event) << ", msg_id: " << dc_event_get_data1_int(event);
-                    emit webxdcInstanceDeleted(dc_event_get_account_id(event), dc_event_get_data1_int(event));
+                    pushEvent(EmitterEvent::WebxdcInstanceDeleted, dc_event_get_account_id(event), dc_event_get_data1_int(event), 0);
                     break;
 
                 case DC_EVENT_WEBXDC_STATUS_UPDATE:
-                    qInfo().nospace() << "Emitter: DC_EVENT_WEBXDC_STATUS_UPDATE" << ", account " << dc_event_get_account_id(event);
-                    emit  webxdcStatusUpdate(dc_event_get_account_id(event), dc_event_get_data1_int(event));
+                    pushEvent(EmitterEvent::WebxdcStatusUpdate, dc_event_get_account_id(event), dc_event_get_data1_int(event), 0);
                     // has parameters, but at least one of them (data2) must
                     // not be queried to avoid "races in the status replication".
                     break;
@@ -253,27 +194,25 @@ void EmitterThread::run()
 
                 case DC_EVENT_ACCOUNTS_BACKGROUND_FETCH_DONE:
                     // TODO: emit and react to this event
-                    qInfo().nospace() << "Emitter: DC_EVENT_ACCOUNTS_BACKGROUND_FETCH_DONE" << ", account " << dc_event_get_account_id(event);
                     break;
 
                 case DC_EVENT_CHATLIST_CHANGED:
                     // TODO: emit and react to this event
-                    qInfo().nospace() << "Emitter: DC_EVENT_CHATLIST_CHANGED" << ", account " << dc_event_get_account_id(event);
                     break;
 
                 case DC_EVENT_CHATLIST_ITEM_CHANGED:
                     // TODO: emit and react to this event
-                    qInfo().nospace() << "Emitter: DC_EVENT_CHATLIST_ITEM_CHANGED" << ", account " << dc_event_get_account_id(event) << ", chat_id: " << dc_event_get_data1_int(event);
                     break;
 
                 case DC_EVENT_CONFIG_SYNCED:
-                    // TODO: emit and react to this event
-                    eventData2Str = dc_event_get_data2_str(event);
-                    qInfo().nospace() << "Emitter: DC_EVENT_CONFIG_SYNCED" << ", account " << dc_event_get_account_id(event)  << ", key: " << qUtf8Printable(eventData2Str);
+                    // only the keys that are shown in the account switcher
+                    if (eventData2Str && (qstrcmp(eventData2Str, "displayname") == 0 || qstrcmp(eventData2Str, "selfavatar") == 0)) {
+                        pushEvent(EmitterEvent::AccountDataChanged, dc_event_get_account_id(event), 0, 0);
+                    }
                     break;
 
                 default:
-                    qInfo().nospace() << "Emitter: Unknown event received" << ", account " << dc_event_get_account_id(event) << ": " << eventType;
+                    break;
             }
 
             if (eventData2Str) {
@@ -293,3 +232,160 @@ void EmitterThread::run()
          qDebug() << "Emitter: Fatal error: No account defined, could not start emitter.";
     }
 }
+
+
+void EmitterThread::pushEvent(int type, uint32_t accID, int data1, int data2)
+{
+    EmitterEvent ev { type, accID, data1, data2 };
+
+    while (!m_eventRing.push(ev)) {
+        // The GUI thread is behind. Events must not get lost, so
+        // wait for it to catch up. The core buffers its events in
+        // the meantime.
+        requestDrain();
+        if (*m_stopLoop) {
+            return;
+        }
+        QThread::msleep(1);
+    }
+
+    requestDrain();
+}
+
+
+void EmitterThread::requestDrain()
+{
+    if (!m_drainScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, "startDrainTimer", Qt::QueuedConnection);
+    }
+}
+
+
+void EmitterThread::startDrainTimer()
+{
+    if (!m_drainTimer->isActive()) {
+        m_drainTimer->start();
+    }
+}
+
+
+void EmitterThread::drainEventRing()
+{
+    DT_PROFILE_SCOPE("EmitterThread::drainEventRing");
+
+    // Has to be reset before popping. Events pushed from now on
+    // will request a new drain, even if they are already popped in
+    // this run (the next drain will just be empty then).
+    m_drainScheduled = false;
+
+    m_drainBatch.clear();
+
+    // Not more than one ring size per drain so the GUI thread
+    // can't get stuck here if events keep coming in
+    EmitterEvent ev;
+    while (m_drainBatch.size() < eventRingSize && m_eventRing.pop(ev)) {
+        m_drainBatch.push_back(ev);
+    }
+
+    if (m_drainBatch.empty()) {
+        return;
+    }
+
+    // Exact duplicates of events that only trigger a refresh are
+    // only emitted once. The last one is kept so the refresh
+    // doesn't happen before other events that came in between.
+    std::vector<bool> skip(m_drainBatch.size(), false);
+    if (m_drainBatch.size() > 1) {
+        std::set<std::tuple<int, uint32_t, int, int>> seen;
+        for (size_t i = m_drainBatch.size(); i-- > 0; ) {
+            const EmitterEvent &e = m_drainBatch[i];
+            if (!isIdempotent(e.type)) {
+                continue;
+            }
+            if (!seen.insert(std::make_tuple(e.type, e.accID, e.data1, e.data2)).second) {
+                skip[i] = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < m_drainBatch.size(); ++i) {
+        if (!skip[i]) {
+            emitEvent(m_drainBatch[i]);
+        }
+    }
+
+    // ring had more than could be drained in one go
+    if (m_drainBatch.size() == eventRingSize) {
+        m_drainScheduled = true;
+        m_drainTimer->start();
+    }
+}
+
+
+bool EmitterThread::isIdempotent(int type)
+{
+    switch (type) {
+        case EmitterEvent::IncomingMsgBunch:
+        case EmitterEvent::MsgsChanged:
+        case EmitterEvent::MsgsNoticed:
+        case EmitterEvent::ContactsChanged:
+        case EmitterEvent::ChatDataModified:
+        case EmitterEvent::ConnectivityChanged:
+        case EmitterEvent::AccountDataChanged:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+void EmitterThread::emitEvent(const EmitterEvent &ev)
+{
+    switch (ev.type) {
+        case EmitterEvent::NewMsg:
+            emit newMsg(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::IncomingMsgBunch:
+            emit incomingMsgBunch(ev.accID);
+            break;
+        case EmitterEvent::MsgsChanged:
+            emit msgsChanged(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::MsgsNoticed:
+            emit msgsNoticed(ev.accID, ev.data1);
+            break;
+        case EmitterEvent::MsgFailed:
+            emit msgFailed(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::MsgDelivered:
+            emit msgDelivered(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::MsgRead:
+            emit msgRead(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::ReactionsChanged:
+            emit reactionsChanged(ev.accID, ev.data1, ev.data2);
+            break;
+        case EmitterEvent::ContactsChanged:
+            emit contactDataChanged(ev.accID, ev.data1);
+            emit contactsChanged();
+            break;
+        case EmitterEvent::ChatDataModified:
+            emit chatDataModified(ev.accID, ev.data1);
+            break;
+        case EmitterEvent::ConnectivityChanged:
+            emit connectivityChanged(ev.accID);
+            break;
+        case EmitterEvent::WebxdcStatusUpdate:
+            emit webxdcStatusUpdate(ev.accID, ev.data1);
+            break;
+        case EmitterEvent::WebxdcInstanceDeleted:
+            emit webxdcInstanceDeleted(ev.accID, ev.data1);
+            break;
+        case EmitterEvent::AccountDataChanged:
+            emit accountDataChanged(ev.accID);
+            break;
+        default:
+            qDebug() << "EmitterThread::emitEvent(): Unknown event type " << ev.type;
+    }
+}
@@ -23,8 +23,48 @@
 #include <QtGui>
 #include <string>
 #include <atomic>
+#include <vector>
 #include "../deltachat.h"
+#include "eventLog.h"
+#include "eventRing.h"
 
+// Plain data of one core event that is passed from the emitter thread
+// to the GUI thread via the event ring. Only used for events that don't
+// carry a string, these are the ones that come in large numbers.
+struct EmitterEvent {
+    enum Type : int {
+        NewMsg,
+        IncomingMsgBunch,
+        MsgsChanged,
+        MsgsNoticed,
+        MsgFailed,
+        MsgDelivered,
+        MsgRead,
+        ReactionsChanged,
+        ContactsChanged,
+        ChatDataModified,
+        ConnectivityChanged,
+        WebxdcStatusUpdate,
+        WebxdcInstanceDeleted,
+        AccountDataChanged
+    };
+
+    int type;
+    uint32_t accID;
+    int data1;
+    int data2;
+};
+
+/*
+ * Loops over the events of the core and passes them to the GUI thread
+ * via the signals below. Events without string payload are not emitted
+ * directly from the emitter thread (this would post one queued call
+ * per event and per connected slot), but are put into a lock-free ring
+ * buffer instead. The GUI thread drains the ring once per frame and
+ * emits the signals from there, so all connections keep working as
+ * before. Events with string payload are still emitted directly, these
+ * are rare.
+ */
 class EmitterThread : public QThread {
     Q_OBJECT
 
@@ -33,6 +73,10 @@ class EmitterThread : public QThread {
 
         void run();
 
+        // the recent core events for the log viewer, rendered
+        // only on demand
+        const EventLog* eventLog() const { return &m_eventLog; }
+
     signals:
             void newMsg(uint32_t accID, int chatID, int msgID);
             void incomingMsgBunch(uint32_t accID);
@@ -46,16 +90,53 @@ class EmitterThread : public QThread {
             void imexProgress(int permill);
             void imexFileWritten(QString filepath);
             void contactsChanged();
+            void contactDataChanged(uint32_t accID, int contactID);
             void errorEvent(QString errorMessage);
             void chatDataModified(uint32_t accID, int chatID);
             void connectivityChanged(uint32_t accID);
             void webxdcStatusUpdate(uint32_t accID, int msgID);
             void webxdcInstanceDeleted(uint32_t accID, int msgID);
             void webxdcRealtimeData(uint32_t accID, int msgID, QString rtData);
+            // display name or avatar of the account have been changed,
+            // e.g. by another device
+            void accountDataChanged(uint32_t accID);
+
+    private slots:
+        // GUI thread only
+        void startDrainTimer();
+        void drainEventRing();
 
     private:
         dc_accounts_t* m_accounts;
         std::atomic<bool>* m_stopLoop;
+
+        static constexpr size_t eventRingSize = 4096;
+        // roughly one frame
+        static constexpr int drainInterval = 16;
+
+        SpscRing<EmitterEvent, eventRingSize> m_eventRing;
+
+        EventLog m_eventLog;
+
+        // Set by the emitter thread when it has requested a drain,
+        // reset by the GUI thread before it starts draining. Makes sure
+        // only one queued call is posted no matter how many events
+        // come in until the next drain.
+        std::atomic<bool> m_drainScheduled;
+
+        // lives in the GUI thread
+        QTimer* m_drainTimer;
+
+        // only accessed in the GUI thread, kept as member to
+        // avoid re-allocating for each drain
+        std::vector<EmitterEvent> m_drainBatch;
+
+        // emitter thread only
+        void pushEvent(int type, uint32_t accID, int data1, int data2);
+        void requestDrain();
+
+        void emitEvent(const EmitterEvent &ev);
+        static bool isIdempotent(int type);
 };
 
 #endif
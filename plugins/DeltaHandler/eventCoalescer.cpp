@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eventCoalescer.h"
+
+
+void EventCoalescer::markChatlistChanged(uint32_t accID)
+{
+    m_dirtyStates[accID].chatlistChanged = true;
+}
+
+
+void EventCoalescer::markChatChanged(uint32_t accID, int chatID)
+{
+    AccountDirtyState &state = m_dirtyStates[accID];
+
+    if (state.allChatsChanged) {
+        return;
+    }
+
+    if (0 == chatID) {
+        state.allChatsChanged = true;
+        state.changedChats.clear();
+    } else {
+        state.changedChats.insert(chatID);
+    }
+}
+
+
+void EventCoalescer::markChatNoticed(uint32_t accID, int chatID)
+{
+    m_dirtyStates[accID].noticedChats.insert(chatID);
+}
+
+
+void EventCoalescer::markMsgChanged(uint32_t accID, int msgID)
+{
+    m_dirtyStates[accID].changedMsgs.insert(msgID);
+}
+
+
+void EventCoalescer::markNotificationsToRemove(uint32_t accID, int chatID)
+{
+    m_dirtyStates[accID].chatsWithNotificationsToRemove.insert(chatID);
+}
+
+
+void EventCoalescer::markContactRequestChanged(uint32_t accID, int chatID)
+{
+    AccountDirtyState &state = m_dirtyStates[accID];
+
+    if (state.contactRequestsStale) {
+        return;
+    }
+
+    if (0 == chatID) {
+        state.contactRequestsStale = true;
+        state.contactRequestCandidates.clear();
+    } else {
+        state.contactRequestCandidates.insert(chatID);
+    }
+}
+
+
+void EventCoalescer::markIncomingMsg(uint32_t accID, int chatID, int msgID)
+{
+    AccountDirtyState &state = m_dirtyStates[accID];
+
+    // no need to collect them if everything
+    // is recounted anyway
+    if (!state.freshMsgCountStale) {
+        state.incomingMsgs.insert(msgID, chatID);
+    }
+}
+
+
+void EventCoalescer::markFreshMsgChanged(uint32_t accID, int msgID)
+{
+    AccountDirtyState &state = m_dirtyStates[accID];
+
+    if (!state.freshMsgCountStale) {
+        state.freshMsgCandidates.insert(msgID);
+    }
+}
+
+
+void EventCoalescer::markFreshMsgCountStale(uint32_t accID)
+{
+    AccountDirtyState &state = m_dirtyStates[accID];
+    state.freshMsgCountStale = true;
+    state.incomingMsgs.clear();
+    state.freshMsgCandidates.clear();
+}
+
+
+bool EventCoalescer::isEmpty() const
+{
+    // entries are only created by the mark* methods, which
+    // always set something
+    return m_dirtyStates.isEmpty();
+}
+
+
+QHash<uint32_t, AccountDirtyState> EventCoalescer::takeAll()
+{
+    QHash<uint32_t, AccountDirtyState> retval;
+    retval.swap(m_dirtyStates);
+    return retval;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTCOALESCER_H
+#define EVENTCOALESCER_H
+
+#include <QtCore>
+
+// Everything that has to be done for one account in the next
+// run of DeltaHandler::processSignalQueue()
+struct AccountDirtyState {
+    // chats may have been added, removed or re-ordered
+    bool chatlistChanged {false};
+    // set if the core passed chat ID 0, changedChats is
+    // not filled anymore in this case
+    bool allChatsChanged {false};
+    // the contact request index of AccountsModel has to be
+    // rebuilt, set if the core passed chat ID 0
+    bool contactRequestsStale {false};
+    // the fresh message count of AccountsModel has to be
+    // recounted as it cannot be updated incrementally
+    bool freshMsgCountStale {false};
+
+    // msgID => chatID of the incoming messages, so
+    // AccountsModel can update its fresh messages
+    QHash<int, int> incomingMsgs;
+    // messages of all chats that may have stopped being fresh,
+    // only those that are counted as fresh are looked up
+    QSet<int> freshMsgCandidates;
+
+    QSet<int> changedChats;
+    QSet<int> noticedChats;
+    // only messages of the currently opened chat
+    QSet<int> changedMsgs;
+    QSet<int> chatsWithNotificationsToRemove;
+    // chats that may have become or stopped being a contact
+    // request, for all accounts
+    QSet<int> contactRequestCandidates;
+};
+
+/*
+ * Collects the changes signalled by the core events until
+ * DeltaHandler::processSignalQueue() runs. Repeated events for the
+ * same account/chat/message are merged on insertion, so no matter
+ * how many events come in, each chat and message is only handled
+ * once per run.
+ */
+class EventCoalescer {
+
+public:
+    void markChatlistChanged(uint32_t accID);
+    // chatID 0 means all chats
+    void markChatChanged(uint32_t accID, int chatID);
+    void markChatNoticed(uint32_t accID, int chatID);
+    void markMsgChanged(uint32_t accID, int msgID);
+    void markNotificationsToRemove(uint32_t accID, int chatID);
+    // chatID 0 means all chats
+    void markContactRequestChanged(uint32_t accID, int chatID);
+    void markIncomingMsg(uint32_t accID, int chatID, int msgID);
+    void markFreshMsgChanged(uint32_t accID, int msgID);
+    void markFreshMsgCountStale(uint32_t accID);
+
+    bool isEmpty() const;
+
+    // Returns the collected states and starts over with an
+    // empty one. Accounts without changes are not contained.
+    QHash<uint32_t, AccountDirtyState> takeAll();
+
+private:
+    QHash<uint32_t, AccountDirtyState> m_dirtyStates;
+};
+
+#endif // EVENTCOALESCER_H
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eventLog.h"
+
+
+EventLog::EventLog()
+    : m_sink {nullptr}, m_entries(capacity), m_next {0}, m_wrapped {false}
+{
+    if (QCoreApplication::instance()) {
+        // see enqueueDeferredLogMessage() in main.cpp
+        QVariant sinkVariant = QCoreApplication::instance()->property("deferredLogSink");
+        if (sinkVariant.isValid()) {
+            m_sink = reinterpret_cast<DeferredLogSink>(sinkVariant.value<quintptr>());
+        }
+    }
+}
+
+
+void EventLog::append(int eventType, uint32_t accID, int data1, int data2, const char* data2Str)
+{
+    qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
+    // Copy for the log file. Shares the data of the ring entry,
+    // so data2Str is not copied.
+    EventLogEntry loggedEntry;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        EventLogEntry &entry = m_entries[m_next];
+        entry.timestamp = timestamp;
+        entry.eventType = eventType;
+        entry.accID = accID;
+        entry.data1 = data1;
+        entry.data2 = data2;
+        // re-uses the buffer of the overwritten entry if possible
+        if (data2Str) {
+            entry.data2Str = data2Str;
+        } else {
+            entry.data2Str.clear();
+        }
+
+        loggedEntry = entry;
+
+        ++m_next;
+        if (m_next == capacity) {
+            m_next = 0;
+            m_wrapped = true;
+        }
+    }
+
+    QtMsgType msgType = QtInfoMsg;
+    if (eventType == DC_EVENT_ERROR || eventType == DC_EVENT_ERROR_SELF_NOT_IN_GROUP || eventType == DC_EVENT_WARNING) {
+        msgType = QtWarningMsg;
+    }
+
+    if (m_sink) {
+        // formatted in the LogWriter thread
+        m_sink(timestamp, msgType, [loggedEntry]() {
+            return QString("Emitter: ") + formatEntry(loggedEntry);
+        });
+    } else if (msgType == QtWarningMsg) {
+        qWarning().noquote() << "Emitter:" << formatEntry(loggedEntry);
+    } else {
+        qInfo().noquote() << "Emitter:" << formatEntry(loggedEntry);
+    }
+}
+
+
+QString EventLog::render() const
+{
+    std::vector<EventLogEntry> entries;
+
+    {
+        // copy first so the emitter thread isn't blocked
+        // during the formatting
+        QMutexLocker locker(&m_mutex);
+        if (m_wrapped) {
+            entries.assign(m_entries.begin() + m_next, m_entries.end());
+        }
+        entries.insert(entries.end(), m_entries.begin(), m_entries.begin() + m_next);
+    }
+
+    QString retval;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const EventLogEntry &entry = entries[i];
+
+        retval.append(QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("MMM dd hh:mm:ss.zzz "));
+        retval.append(formatEntry(entry));
+        retval.append("\n");
+    }
+
+    return retval;
+}
+
+
+QString EventLog::formatEntry(const EventLogEntry &entry)
+{
+    QString retval(eventName(entry.eventType));
+    if (qstrcmp(eventName(entry.eventType), "Unknown event") == 0) {
+        retval.append(" ");
+        retval.append(QString::number(entry.eventType));
+    }
+    retval.append(", account ");
+    retval.append(QString::number(entry.accID));
+
+    if (entry.data1 != 0 || entry.data2 != 0) {
+        retval.append(", data1: ");
+        retval.append(QString::number(entry.data1));
+        retval.append(", data2: ");
+        retval.append(QString::number(entry.data2));
+    }
+
+    if (!entry.data2Str.isEmpty()) {
+        retval.append(": ");
+        retval.append(QString::fromUtf8(entry.data2Str));
+    }
+
+    return retval;
+}
+
+
+const char* EventLog::eventName(int eventType)
+{
+    switch (eventType) {
+        case DC_EVENT_INFO: return "DC_EVENT_INFO";
+        case DC_EVENT_SMTP_CONNECTED: return "DC_EVENT_SMTP_CONNECTED";
+        case DC_EVENT_IMAP_CONNECTED: return "DC_EVENT_IMAP_CONNECTED";
+        case DC_EVENT_SMTP_MESSAGE_SENT: return "DC_EVENT_SMTP_MESSAGE_SENT";
+        case DC_EVENT_IMAP_MESSAGE_DELETED: return "DC_EVENT_IMAP_MESSAGE_DELETED";
+        case DC_EVENT_IMAP_MESSAGE_MOVED: return "DC_EVENT_IMAP_MESSAGE_MOVED";
+        case DC_EVENT_IMAP_INBOX_IDLE: return "DC_EVENT_IMAP_INBOX_IDLE";
+        case DC_EVENT_NEW_BLOB_FILE: return "DC_EVENT_NEW_BLOB_FILE";
+        case DC_EVENT_DELETED_BLOB_FILE: return "DC_EVENT_DELETED_BLOB_FILE";
+        case DC_EVENT_WARNING: return "DC_EVENT_WARNING";
+        case DC_EVENT_ERROR: return "DC_EVENT_ERROR";
+        case DC_EVENT_ERROR_SELF_NOT_IN_GROUP: return "DC_EVENT_ERROR_SELF_NOT_IN_GROUP";
+        case DC_EVENT_MSGS_CHANGED: return "DC_EVENT_MSGS_CHANGED";
+        case DC_EVENT_REACTIONS_CHANGED: return "DC_EVENT_REACTIONS_CHANGED";
+        case DC_EVENT_INCOMING_REACTION: return "DC_EVENT_INCOMING_REACTION";
+        case DC_EVENT_INCOMING_WEBXDC_NOTIFY: return "DC_EVENT_INCOMING_WEBXDC_NOTIFY";
+        case DC_EVENT_INCOMING_MSG: return "DC_EVENT_INCOMING_MSG";
+        case DC_EVENT_INCOMING_MSG_BUNCH: return "DC_EVENT_INCOMING_MSG_BUNCH";
+        case DC_EVENT_MSGS_NOTICED: return "DC_EVENT_MSGS_NOTICED";
+        case DC_EVENT_MSG_DELIVERED: return "DC_EVENT_MSG_DELIVERED";
+        case DC_EVENT_MSG_FAILED: return "DC_EVENT_MSG_FAILED";
+        case DC_EVENT_MSG_READ: return "DC_EVENT_MSG_READ";
+        case DC_EVENT_MSG_DELETED: return "DC_EVENT_MSG_DELETED";
+        case DC_EVENT_CHAT_MODIFIED: return "DC_EVENT_CHAT_MODIFIED";
+        case DC_EVENT_CHAT_EPHEMERAL_TIMER_MODIFIED: return "DC_EVENT_CHAT_EPHEMERAL_TIMER_MODIFIED";
+        case DC_EVENT_CONTACTS_CHANGED: return "DC_EVENT_CONTACTS_CHANGED";
+        case DC_EVENT_LOCATION_CHANGED: return "DC_EVENT_LOCATION_CHANGED";
+        case DC_EVENT_CONFIGURE_PROGRESS: return "DC_EVENT_CONFIGURE_PROGRESS";
+        case DC_EVENT_IMEX_PROGRESS: return "DC_EVENT_IMEX_PROGRESS";
+        case DC_EVENT_IMEX_FILE_WRITTEN: return "DC_EVENT_IMEX_FILE_WRITTEN";
+        case DC_EVENT_SECUREJOIN_INVITER_PROGRESS: return "DC_EVENT_SECUREJOIN_INVITER_PROGRESS";
+        case DC_EVENT_SECUREJOIN_JOINER_PROGRESS: return "DC_EVENT_SECUREJOIN_JOINER_PROGRESS";
+        case DC_EVENT_CONNECTIVITY_CHANGED: return "DC_EVENT_CONNECTIVITY_CHANGED";
+        case DC_EVENT_SELFAVATAR_CHANGED: return "DC_EVENT_SELFAVATAR_CHANGED";
+        case DC_EVENT_CONFIG_SYNCED: return "DC_EVENT_CONFIG_SYNCED";
+        case DC_EVENT_WEBXDC_STATUS_UPDATE: return "DC_EVENT_WEBXDC_STATUS_UPDATE";
+        case DC_EVENT_WEBXDC_INSTANCE_DELETED: return "DC_EVENT_WEBXDC_INSTANCE_DELETED";
+        case DC_EVENT_WEBXDC_REALTIME_DATA: return "DC_EVENT_WEBXDC_REALTIME_DATA";
+        case DC_EVENT_WEBXDC_REALTIME_ADVERTISEMENT: return "DC_EVENT_WEBXDC_REALTIME_ADVERTISEMENT";
+        case DC_EVENT_ACCOUNTS_BACKGROUND_FETCH_DONE: return "DC_EVENT_ACCOUNTS_BACKGROUND_FETCH_DONE";
+        case DC_EVENT_CHATLIST_CHANGED: return "DC_EVENT_CHATLIST_CHANGED";
+        case DC_EVENT_CHATLIST_ITEM_CHANGED: return "DC_EVENT_CHATLIST_ITEM_CHANGED";
+        case DC_EVENT_ACCOUNTS_CHANGED: return "DC_EVENT_ACCOUNTS_CHANGED";
+        case DC_EVENT_ACCOUNTS_ITEM_CHANGED: return "DC_EVENT_ACCOUNTS_ITEM_CHANGED";
+        case DC_EVENT_CHANNEL_OVERFLOW: return "DC_EVENT_CHANNEL_OVERFLOW";
+        default: return "Unknown event";
+    }
+}
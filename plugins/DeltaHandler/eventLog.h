@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QtCore>
+#include <functional>
+#include <vector>
+#include "../deltachat.h"
+
+// Compile-time filter for the core events in EventLog:
+// 0 - no events are logged except DC_EVENT_ERROR
+// 1 - all events except DC_EVENT_INFO (by far the most frequent one)
+// 2 - all events
+#ifndef DT_EVENT_LOG_LEVEL
+#define DT_EVENT_LOG_LEVEL 1
+#endif
+
+// Passes a log message to the LogWriter thread in main.cpp, which
+// calls formatMsg and writes the result to the log file. Has to match
+// the signature of enqueueDeferredLogMessage() in main.cpp.
+typedef void (*DeferredLogSink)(qint64 timestamp, QtMsgType type, std::function<QString()> &&formatMsg);
+
+// One core event as stored in EventLog, the values are stored
+// as they come from the core, no formatting is done
+struct EventLogEntry {
+    // ms since epoch
+    qint64 timestamp {0};
+    int eventType {0};
+    uint32_t accID {0};
+    int data1 {0};
+    int data2 {0};
+    QByteArray data2Str;
+};
+
+/*
+ * Keeps the most recent core events for the "Core Events" view of
+ * LogViewer.qml. Each event is additionally passed to the LogWriter
+ * thread in main.cpp, so it ends up in the log file in order with the
+ * other log messages and is not lost in case of a crash. The event is
+ * passed unformatted, the text is only created by the LogWriter thread
+ * (and by render()), so EmitterThread doesn't do any formatting.
+ */
+class EventLog {
+
+public:
+    EventLog();
+
+    static constexpr bool isLogged(int eventType) {
+        return DT_EVENT_LOG_LEVEL > 1 || (DT_EVENT_LOG_LEVEL > 0 && eventType != DC_EVENT_INFO) || eventType == DC_EVENT_ERROR;
+    }
+
+    // Called from EmitterThread. data2Str may be nullptr.
+    void append(int eventType, uint32_t accID, int data1, int data2, const char* data2Str);
+
+    // Renders the stored events, oldest first. Can be
+    // called from any thread.
+    QString render() const;
+
+    static const char* eventName(int eventType);
+
+private:
+    // without timestamp and trailing newline
+    static QString formatEntry(const EventLogEntry &entry);
+
+    static constexpr size_t capacity = 8192;
+
+    // nullptr if the app doesn't provide it (e.g., in the benchmark),
+    // the events are then passed to qInfo() etc.
+    DeferredLogSink m_sink;
+
+    mutable QMutex m_mutex;
+    std::vector<EventLogEntry> m_entries;
+    // position of the next entry to be written
+    size_t m_next;
+    bool m_wrapped;
+};
+
+#endif // EVENTLOG_H
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTRING_H
+#define EVENTRING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Fixed size ring buffer for exactly one producer thread and
+ * one consumer thread. push() must only be called by the
+ * producer, pop() only by the consumer. Neither blocks or
+ * allocates. Capacity has to be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing: Capacity has to be a power of two");
+
+public:
+    SpscRing() : m_head {0}, m_tail {0} {}
+
+    // returns false if the ring is full
+    bool push(const T &item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // returns false if the ring is empty
+    bool pop(T &item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> m_items;
+    // head is written by the consumer, tail by the producer. The
+    // padding keeps them on separate cache lines so they don't
+    // interfere (no alignas as the ring is allocated via new as
+    // part of EmitterThread, which doesn't respect over-alignment
+    // before C++17).
+    std::atomic<size_t> m_head;
+    char m_padding[64];
+    std::atomic<size_t> m_tail;
+};
+
+#endif // EVENTRING_H
@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "globalsearchmodel.h"
+
+#include <algorithm>
+
+GlobalSearchModel::GlobalSearchModel(DeltaHandler* dhandler, dc_accounts_t* accounts, std::atomic<bool>* _stopThreads, QObject* parent)
+    : QAbstractListModel(parent), m_dhandler {dhandler}, m_accounts {accounts}, m_stopThreads {_stopThreads}, m_generation {0}, m_shownCount {0}, m_shownLimit {resultPageSize}
+{
+}
+
+
+GlobalSearchModel::~GlobalSearchModel()
+{
+    // only if stopThreads() has not been called
+    QHash<uint32_t, GlobalSearchThread*>::iterator it;
+    for (it = m_searchThreads.begin(); it != m_searchThreads.end(); ++it) {
+        it.value()->stop();
+        it.value()->wait();
+        delete it.value();
+    }
+    m_searchThreads.clear();
+
+    releaseContexts();
+}
+
+
+QHash<int, QByteArray> GlobalSearchModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[AccountIdRole] = "accountId";
+    roles[ChatIdRole] = "chatId";
+    roles[MsgIdRole] = "msgId";
+    roles[AccountNameRole] = "accountName";
+    roles[ChatNameRole] = "chatName";
+    roles[SummaryRole] = "summary";
+    roles[DateRole] = "date";
+
+    return roles;
+}
+
+
+int GlobalSearchModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return m_shownCount;
+}
+
+
+bool GlobalSearchModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return false;
+    }
+
+    return static_cast<size_t>(m_shownCount) < m_results.size();
+}
+
+
+void GlobalSearchModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    m_shownLimit = m_shownCount + resultPageSize;
+    showUpToLimit();
+}
+
+
+QVariant GlobalSearchModel::data(const QModelIndex &index, int role) const
+{
+    int row = index.row();
+
+    if (row < 0 || row >= m_shownCount) {
+        return QVariant();
+    }
+
+    const GlobalSearchResult &tempResult = m_results[row];
+
+    QVariant retval;
+    QDateTime msgDate;
+    quint64 chatKey {0};
+    QHash<quint64, QString>::const_iterator it;
+    dc_context_t* tempContext {nullptr};
+    dc_chat_t* tempChat {nullptr};
+    char* tempText {nullptr};
+
+    switch(role) {
+        case GlobalSearchModel::AccountIdRole:
+            retval = tempResult.accID;
+            break;
+
+        case GlobalSearchModel::ChatIdRole:
+            retval = tempResult.chatID;
+            break;
+
+        case GlobalSearchModel::MsgIdRole:
+            retval = tempResult.msgID;
+            break;
+
+        case GlobalSearchModel::AccountNameRole:
+            retval = m_accountNames.value(tempResult.accID);
+            break;
+
+        case GlobalSearchModel::ChatNameRole:
+            // Results tend to be from the same few chats, so
+            // the names are only looked up once per search
+            chatKey = (static_cast<quint64>(tempResult.accID) << 32) | tempResult.chatID;
+            it = m_chatNameCache.constFind(chatKey);
+            if (it != m_chatNameCache.constEnd()) {
+                retval = it.value();
+                break;
+            }
+
+            tempContext = m_contexts.value(tempResult.accID, nullptr);
+            if (tempContext) {
+                tempChat = dc_get_chat(tempContext, tempResult.chatID);
+            }
+            if (tempChat) {
+                tempText = dc_chat_get_name(tempChat);
+                m_chatNameCache.insert(chatKey, QString(tempText));
+                retval = QString(tempText);
+                dc_str_unref(tempText);
+                dc_chat_unref(tempChat);
+            } else {
+                retval = QString("");
+            }
+            break;
+
+        case GlobalSearchModel::SummaryRole:
+            retval = tempResult.summary;
+            break;
+
+        case GlobalSearchModel::DateRole:
+            msgDate = QDateTime::fromSecsSinceEpoch(tempResult.timestamp);
+            if (msgDate.date() == QDate::currentDate()) {
+                retval = msgDate.toString("hh:mm");
+            }
+            else {
+                retval = msgDate.toString("dd MMM yy hh:mm");
+            }
+            break;
+
+        default:
+            retval = QVariant();
+            qDebug() << "GlobalSearchModel::data switch reached default";
+            break;
+    }
+
+    return retval;
+}
+
+
+bool GlobalSearchModel::searching() const
+{
+    return !m_pendingAccounts.isEmpty();
+}
+
+
+int GlobalSearchModel::resultCount() const
+{
+    return static_cast<int>(m_results.size());
+}
+
+
+void GlobalSearchModel::search(QString query, bool allAccounts)
+{
+    clear();
+
+    if (query == "") {
+        return;
+    }
+
+    std::vector<uint32_t> accIDs;
+
+    if (allAccounts) {
+        dc_array_t* tempArray = dc_accounts_get_all(m_accounts);
+        for (size_t i = 0; i < dc_array_get_cnt(tempArray); ++i) {
+            accIDs.push_back(dc_array_get_id(tempArray, i));
+        }
+        dc_array_unref(tempArray);
+    } else if (m_dhandler->getCurrentAccountId() != 0) {
+        accIDs.push_back(m_dhandler->getCurrentAccountId());
+    }
+
+    for (size_t i = 0; i < accIDs.size(); ++i) {
+        dc_context_t* tempContext = dc_accounts_get_account(m_accounts, accIDs[i]);
+        if (!tempContext) {
+            continue;
+        }
+
+        // skip accounts that are locked (encrypted database
+        // that has not been opened) or not configured
+        if (!dc_context_is_open(tempContext) || !dc_is_configured(tempContext)) {
+            dc_context_unref(tempContext);
+            continue;
+        }
+
+        m_contexts.insert(accIDs[i], tempContext);
+
+        char* tempText = dc_get_config(tempContext, "displayname");
+        QString accountName = tempText;
+        dc_str_unref(tempText);
+        if (accountName == "") {
+            tempText = dc_get_config(tempContext, "addr");
+            accountName = tempText;
+            dc_str_unref(tempText);
+        }
+        m_accountNames.insert(accIDs[i], accountName);
+
+        getSearchThread(accIDs[i])->search(m_generation, accIDs[i], query);
+        m_pendingAccounts.insert(accIDs[i]);
+    }
+
+    if (!m_pendingAccounts.isEmpty()) {
+        emit searchingChanged();
+    }
+}
+
+
+void GlobalSearchModel::clear()
+{
+    // results of searches that are still running will be ignored
+    ++m_generation;
+
+    beginResetModel();
+    m_results.clear();
+    m_shownCount = 0;
+    m_shownLimit = resultPageSize;
+    m_chatNameCache.clear();
+    m_accountNames.clear();
+    releaseContexts();
+    endResetModel();
+
+    if (!m_pendingAccounts.isEmpty()) {
+        m_pendingAccounts.clear();
+        emit searchingChanged();
+    }
+
+    emit resultCountChanged();
+}
+
+
+void GlobalSearchModel::openResult(int myindex)
+{
+    if (myindex < 0 || myindex >= m_shownCount) {
+        return;
+    }
+
+    // copy the values, selecting another account may
+    // cause changes to this model
+    uint32_t accID = m_results[myindex].accID;
+    uint32_t chatID = m_results[myindex].chatID;
+    uint32_t msgID = m_results[myindex].msgID;
+
+    if (accID != m_dhandler->getCurrentAccountId()) {
+        m_dhandler->selectAccount(accID);
+    }
+
+    // the chat view jumps to the message once it has loaded the chat
+    m_dhandler->chatmodel()->setMsgToJumpTo(chatID, msgID);
+
+    m_dhandler->selectChatByChatId(chatID);
+    m_dhandler->openChat();
+}
+
+
+void GlobalSearchModel::stopThreads()
+{
+    QHash<uint32_t, GlobalSearchThread*>::iterator it;
+    for (it = m_searchThreads.begin(); it != m_searchThreads.end(); ++it) {
+        it.value()->wakeUpForStop();
+    }
+
+    for (it = m_searchThreads.begin(); it != m_searchThreads.end(); ++it) {
+        if (it.value()->wait(1000)) {
+            delete it.value();
+        } else {
+            // can't be deleted while still running
+            qDebug() << "GlobalSearchModel::stopThreads(): waiting for search thread of account " << it.key() << " timed out.";
+        }
+    }
+
+    m_searchThreads.clear();
+}
+
+
+void GlobalSearchModel::removeAccount(uint32_t accID)
+{
+    GlobalSearchThread* searchThread = m_searchThreads.take(accID);
+
+    if (m_pendingAccounts.remove(accID) && m_pendingAccounts.isEmpty()) {
+        emit searchingChanged();
+    }
+
+    if (!searchThread) {
+        return;
+    }
+
+    // The thread might still be busy with a search, so it's
+    // not waited for here but deleted once it has terminated
+    disconnect(searchThread, nullptr, this, nullptr);
+    bool connectSuccess = connect(searchThread, SIGNAL(finished()), searchThread, SLOT(deleteLater()));
+    if (!connectSuccess) {
+        qFatal("GlobalSearchModel::removeAccount(): Could not connect signal finished to slot deleteLater");
+    }
+    searchThread->stop();
+}
+
+
+void GlobalSearchModel::resultsFound(quint64 generation, uint32_t accID, QVector<GlobalSearchResult> results)
+{
+    Q_UNUSED(accID);
+
+    if (generation != m_generation || results.isEmpty()) {
+        return;
+    }
+
+    std::vector<GlobalSearchResult> newResults(results.begin(), results.end());
+    std::sort(newResults.begin(), newResults.end(), ranksHigher);
+
+    // Merge the new results into m_results. New results that belong
+    // to the same position in m_results are inserted as one block. Rows
+    // are only inserted into the view if the block lands within the
+    // shown rows, otherwise it becomes visible via showUpToLimit() or
+    // fetchMore().
+    size_t i = 0;
+    while (i < newResults.size()) {
+        std::vector<GlobalSearchResult>::iterator insertIt = std::upper_bound(m_results.begin(), m_results.end(), newResults[i], ranksHigher);
+        size_t insertPos = insertIt - m_results.begin();
+
+        size_t blockEnd = i + 1;
+        while (blockEnd < newResults.size() && (insertPos == m_results.size() || ranksHigher(newResults[blockEnd], m_results[insertPos]))) {
+            ++blockEnd;
+        }
+
+        int blockSize = static_cast<int>(blockEnd - i);
+
+        if (static_cast<int>(insertPos) < m_shownCount) {
+            beginInsertRows(QModelIndex(), insertPos, insertPos + blockSize - 1);
+            m_results.insert(insertIt, newResults.begin() + i, newResults.begin() + blockEnd);
+            m_shownCount += blockSize;
+            endInsertRows();
+        } else {
+            m_results.insert(insertIt, newResults.begin() + i, newResults.begin() + blockEnd);
+        }
+
+        i = blockEnd;
+    }
+
+    // rows inserted within the shown ones count towards the limit
+    if (m_shownLimit < m_shownCount) {
+        m_shownLimit = m_shownCount;
+    }
+    showUpToLimit();
+
+    emit resultCountChanged();
+}
+
+
+void GlobalSearchModel::searchDone(quint64 generation, uint32_t accID)
+{
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (m_pendingAccounts.remove(accID) && m_pendingAccounts.isEmpty()) {
+        emit searchingChanged();
+    }
+}
+
+
+GlobalSearchThread* GlobalSearchModel::getSearchThread(uint32_t accID)
+{
+    GlobalSearchThread* searchThread = m_searchThreads.value(accID, nullptr);
+    if (searchThread) {
+        return searchThread;
+    }
+
+    searchThread = new GlobalSearchThread(m_accounts, m_stopThreads);
+
+    bool connectSuccess = connect(searchThread, SIGNAL(resultsFound(quint64, uint32_t, QVector<GlobalSearchResult>)), this, SLOT(resultsFound(quint64, uint32_t, QVector<GlobalSearchResult>)));
+    if (!connectSuccess) {
+        qFatal("GlobalSearchModel::getSearchThread(): Could not connect signal resultsFound to slot resultsFound");
+    }
+
+    connectSuccess = connect(searchThread, SIGNAL(searchDone(quint64, uint32_t)), this, SLOT(searchDone(quint64, uint32_t)));
+    if (!connectSuccess) {
+        qFatal("GlobalSearchModel::getSearchThread(): Could not connect signal searchDone to slot searchDone");
+    }
+
+    searchThread->start();
+    m_searchThreads.insert(accID, searchThread);
+
+    return searchThread;
+}
+
+
+bool GlobalSearchModel::ranksHigher(const GlobalSearchResult &a, const GlobalSearchResult &b)
+{
+    // newest first, account and message ID only to
+    // get a stable order for equal timestamps
+    if (a.timestamp != b.timestamp) {
+        return a.timestamp > b.timestamp;
+    }
+
+    if (a.accID != b.accID) {
+        return a.accID < b.accID;
+    }
+
+    return a.msgID > b.msgID;
+}
+
+
+void GlobalSearchModel::showUpToLimit()
+{
+    int target = std::min(static_cast<int>(m_results.size()), m_shownLimit);
+
+    if (target > m_shownCount) {
+        beginInsertRows(QModelIndex(), m_shownCount, target - 1);
+        m_shownCount = target;
+        endInsertRows();
+    }
+}
+
+
+void GlobalSearchModel::releaseContexts()
+{
+    QHash<uint32_t, dc_context_t*>::iterator it;
+    for (it = m_contexts.begin(); it != m_contexts.end(); ++it) {
+        dc_context_unref(it.value());
+    }
+    m_contexts.clear();
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLOBALSEARCHMODEL_H
+#define GLOBALSEARCHMODEL_H
+
+#include <QtCore>
+#include <QtGui>
+#include <atomic>
+#include <vector>
+
+#include "deltahandler.h"
+#include "globalsearchthread.h"
+#include "../deltachat.h"
+
+class DeltaHandler;
+
+/*
+ * Model for searching messages in all chats of the current account
+ * or of all accounts that are opened and configured. Each account is
+ * searched by its own GlobalSearchThread, and the results are merged
+ * into the model as they arrive, newest first. Only a page of the
+ * results is exposed at first, more are added via fetchMore().
+ */
+class GlobalSearchModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit GlobalSearchModel(DeltaHandler* dhandler, dc_accounts_t* accounts, std::atomic<bool>* _stopThreads, QObject *parent = 0);
+    ~GlobalSearchModel();
+
+    enum { AccountIdRole, ChatIdRole, MsgIdRole, AccountNameRole, ChatNameRole, SummaryRole, DateRole };
+
+    Q_PROPERTY(bool searching READ searching NOTIFY searchingChanged);
+    // total number of results received so far, including
+    // the ones not yet exposed via rowCount()
+    Q_PROPERTY(int resultCount READ resultCount NOTIFY resultCountChanged);
+
+    bool searching() const;
+    int resultCount() const;
+
+    // QAbstractListModel interface
+    virtual int rowCount(const QModelIndex &parent) const;
+    virtual QVariant data(const QModelIndex &index, int role) const;
+    virtual bool canFetchMore(const QModelIndex &parent) const;
+    virtual void fetchMore(const QModelIndex &parent);
+
+    // If allAccounts is false, only the current account is searched
+    Q_INVOKABLE void search(QString query, bool allAccounts);
+    Q_INVOKABLE void clear();
+
+    // switches to the account of the result if needed and opens
+    // the chat containing the message, scrolled to the message
+    Q_INVOKABLE void openResult(int myindex);
+
+    // To be called from DeltaHandler::shutdownTasks() after
+    // m_stopThreads has been set. The threads are deleted
+    // once they have terminated.
+    void stopThreads();
+
+public slots:
+    // stops and removes the search thread of the account
+    void removeAccount(uint32_t accID);
+
+signals:
+    void searchingChanged();
+    void resultCountChanged();
+
+protected:
+    QHash<int, QByteArray> roleNames() const;
+
+private slots:
+    void resultsFound(quint64 generation, uint32_t accID, QVector<GlobalSearchResult> results);
+    void searchDone(quint64 generation, uint32_t accID);
+
+private:
+    DeltaHandler* m_dhandler;
+    dc_accounts_t* m_accounts;
+    std::atomic<bool>* m_stopThreads;
+
+    // key: accID, created on first search of the account
+    QHash<uint32_t, GlobalSearchThread*> m_searchThreads;
+    GlobalSearchThread* getSearchThread(uint32_t accID);
+
+    // increased with each search or clear(), results of
+    // older searches are ignored
+    quint64 m_generation;
+    // accounts whose search has not finished yet
+    QSet<uint32_t> m_pendingAccounts;
+
+    // all results, sorted via ranksHigher()
+    std::vector<GlobalSearchResult> m_results;
+    static bool ranksHigher(const GlobalSearchResult &a, const GlobalSearchResult &b);
+
+    // the first m_shownCount entries of m_results are exposed
+    // as rows, m_shownLimit is the number of rows that should
+    // be shown once enough results have arrived
+    int m_shownCount;
+    int m_shownLimit;
+    static constexpr int resultPageSize = 50;
+    void showUpToLimit();
+
+    // contexts of the searched accounts, ref'd, for data()
+    QHash<uint32_t, dc_context_t*> m_contexts;
+    QHash<uint32_t, QString> m_accountNames;
+    // key: accID << 32 | chatID
+    mutable QHash<quint64, QString> m_chatNameCache;
+    void releaseContexts();
+};
+
+#endif // GLOBALSEARCHMODEL_H
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "globalsearchthread.h"
+
+GlobalSearchThread::GlobalSearchThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop)
+{
+    m_accounts = accounts;
+    m_stopLoop = _stopLoop;
+
+    m_hasPendingRequest = false;
+    m_pendingGeneration = 0;
+    m_pendingContext = nullptr;
+    m_latestGeneration = 0;
+    m_stopRequested = false;
+
+    // needed for queued connections
+    qRegisterMetaType<QVector<GlobalSearchResult>>("QVector<GlobalSearchResult>");
+}
+
+
+GlobalSearchThread::~GlobalSearchThread()
+{
+    if (m_pendingContext) {
+        dc_context_unref(m_pendingContext);
+    }
+}
+
+
+void GlobalSearchThread::search(quint64 generation, uint32_t accID, QString query)
+{
+    dc_context_t* context = dc_accounts_get_account(m_accounts, accID);
+    if (!context) {
+        qDebug() << "GlobalSearchThread::search(): ERROR: could not get context for account " << accID;
+        return;
+    }
+
+    QMutexLocker locker(&m_requestMutex);
+
+    // drop a request that has not been started yet
+    if (m_pendingContext) {
+        dc_context_unref(m_pendingContext);
+    }
+
+    m_hasPendingRequest = true;
+    m_pendingGeneration = generation;
+    m_pendingContext = context;
+    m_pendingQuery = query;
+    m_latestGeneration = generation;
+
+    m_requestCondition.wakeOne();
+}
+
+
+void GlobalSearchThread::wakeUpForStop()
+{
+    QMutexLocker locker(&m_requestMutex);
+    m_requestCondition.wakeAll();
+}
+
+
+void GlobalSearchThread::stop()
+{
+    QMutexLocker locker(&m_requestMutex);
+    m_stopRequested = true;
+    m_requestCondition.wakeAll();
+}
+
+
+bool GlobalSearchThread::stopRequested()
+{
+    QMutexLocker locker(&m_requestMutex);
+    return m_stopRequested;
+}
+
+
+bool GlobalSearchThread::isSuperseded(quint64 generation)
+{
+    QMutexLocker locker(&m_requestMutex);
+    return generation != m_latestGeneration || m_stopRequested;
+}
+
+
+void GlobalSearchThread::run()
+{
+    while (!(*m_stopLoop) && !stopRequested()) {
+        quint64 generation {0};
+        dc_context_t* context {nullptr};
+        QString query;
+
+        {
+            QMutexLocker locker(&m_requestMutex);
+            while (!m_hasPendingRequest && !(*m_stopLoop) && !m_stopRequested) {
+                m_requestCondition.wait(&m_requestMutex);
+            }
+
+            if (!m_hasPendingRequest || m_stopRequested) {
+                // woken up for stopping
+                break;
+            }
+
+            generation = m_pendingGeneration;
+            context = m_pendingContext;
+            query = m_pendingQuery;
+
+            m_hasPendingRequest = false;
+            m_pendingContext = nullptr;
+        }
+
+        uint32_t accID = dc_get_id(context);
+
+        // chat ID 0 means all chats
+        dc_array_t* resultArray = dc_search_msgs(context, 0, query.toUtf8().constData());
+        size_t count = resultArray ? dc_array_get_cnt(resultArray) : 0;
+
+        QVector<GlobalSearchResult> chunk;
+        chunk.reserve(resultChunkSize);
+        bool superseded {false};
+
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t msgID = dc_array_get_id(resultArray, i);
+            dc_msg_t* tempMsg = dc_get_msg(context, msgID);
+            if (!tempMsg) {
+                continue;
+            }
+
+            GlobalSearchResult tempResult;
+            tempResult.accID = accID;
+            tempResult.msgID = msgID;
+            tempResult.chatID = dc_msg_get_chat_id(tempMsg);
+            tempResult.timestamp = dc_msg_get_timestamp(tempMsg);
+            char* tempText = dc_msg_get_summarytext(tempMsg, summaryLength);
+            tempResult.summary = tempText;
+            dc_str_unref(tempText);
+            dc_msg_unref(tempMsg);
+
+            chunk.append(tempResult);
+
+            if (chunk.size() == resultChunkSize) {
+                // Reading the details of all results might take a
+                // while, so stop here if they are not needed anymore
+                if (isSuperseded(generation) || *m_stopLoop) {
+                    superseded = true;
+                    break;
+                }
+                emit resultsFound(generation, accID, chunk);
+                chunk.clear();
+            }
+        }
+
+        if (resultArray) {
+            dc_array_unref(resultArray);
+        }
+        dc_context_unref(context);
+
+        if (!superseded && !isSuperseded(generation)) {
+            if (!chunk.isEmpty()) {
+                emit resultsFound(generation, accID, chunk);
+            }
+            emit searchDone(generation, accID);
+        }
+    }
+
+    qDebug() << "GlobalSearchThread::run(): Loop terminated";
+}
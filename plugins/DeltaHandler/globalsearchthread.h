@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GLOBALSEARCHTHREAD_H
+#define GLOBALSEARCHTHREAD_H
+
+#include <QtCore>
+#include <atomic>
+#include "../deltachat.h"
+
+// One hit of the global search, see GlobalSearchModel
+struct GlobalSearchResult {
+    uint32_t accID {0};
+    uint32_t msgID {0};
+    uint32_t chatID {0};
+    // in seconds
+    int64_t timestamp {0};
+    QString summary {""};
+};
+
+/*
+ * Searches all chats of one account via dc_search_msgs() with chat ID 0.
+ * GlobalSearchModel creates one instance per account so several accounts
+ * are searched concurrently. As with MessageSearchThread, only the most
+ * recent request is kept. The results are emitted in chunks as soon as
+ * their details have been read, and the remaining chunks are dropped
+ * once a newer request comes in.
+ */
+class GlobalSearchThread : public QThread {
+    Q_OBJECT
+
+    public:
+        GlobalSearchThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop);
+        ~GlobalSearchThread();
+
+        void run();
+
+        // Can be called from the GUI thread. generation has to be
+        // increased with each call, it's passed back with the results.
+        void search(quint64 generation, uint32_t accID, QString query);
+
+        // To be called after _stopLoop has been set to true, wakes
+        // up the thread so it can terminate
+        void wakeUpForStop();
+
+        // Terminates only this thread, e.g. because its account
+        // has been removed. A search that is already running is
+        // finished first, its results are not emitted anymore.
+        void stop();
+
+    signals:
+        void resultsFound(quint64 generation, uint32_t accID, QVector<GlobalSearchResult> results);
+        // emitted once per request that has not been superseded,
+        // after all results have been passed via resultsFound
+        void searchDone(quint64 generation, uint32_t accID);
+
+    private:
+        dc_accounts_t* m_accounts;
+        std::atomic<bool>* m_stopLoop;
+
+        QMutex m_requestMutex;
+        QWaitCondition m_requestCondition;
+        // only valid if m_hasPendingRequest is true, the
+        // context is ref'd and has to be unref'd
+        bool m_hasPendingRequest;
+        quint64 m_pendingGeneration;
+        dc_context_t* m_pendingContext;
+        QString m_pendingQuery;
+        // generation of the most recent call to search()
+        quint64 m_latestGeneration;
+        // set via stop()
+        bool m_stopRequested;
+
+        bool stopRequested();
+
+        bool isSuperseded(quint64 generation);
+
+        static constexpr int resultChunkSize = 50;
+        static constexpr int summaryLength = 80;
+};
+
+#endif
@@ -19,8 +19,8 @@
 #include "groupmembermodel.h"
 //#include <unistd.h> // for sleep
 
-GroupMemberModel::GroupMemberModel(QObject* parent)
-    : QAbstractListModel(parent), m_context {nullptr}
+GroupMemberModel::GroupMemberModel(ContactCache* contactCache, QObject* parent)
+    : QAbstractListModel(parent), m_contactCache {contactCache}, m_context {nullptr}
 { 
 };
 
@@ -61,22 +61,18 @@ QVariant GroupMemberModel::data(const QModelIndex &index, int role) const
     QString tempQString;
     QColor tempQColor;
 
-    char* tempText {nullptr};
     uint32_t tempColor {0};
 
     uint32_t tempContactID = m_membervector[row];
-    dc_contact_t* tempContact = dc_get_contact(m_context, tempContactID);
+    const ContactSnapshot& tempContact = m_contactCache->getContact(m_context, tempContactID);
 
     switch(role) {
         case GroupMemberModel::DisplayNameRole:
-            tempText = dc_contact_get_display_name(tempContact);
-            tempQString = tempText;
-            retval = tempQString;
+            retval = tempContact.displayName;
             break;
 
         case GroupMemberModel::ProfilePicRole:
-            tempText = dc_contact_get_profile_image(tempContact);
-            tempQString = tempText;
+            tempQString = tempContact.profileImage;
             // see comment for ChatModel::data() in chatmodel.cpp
             if (tempQString.length() > QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length()) {
                 tempQString.remove(0, QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation).length());
@@ -88,20 +84,17 @@ QVariant GroupMemberModel::data(const QModelIndex &index, int role) const
             break;
 
         case GroupMemberModel::EmailAddressRole:
-            tempText = dc_contact_get_addr(tempContact);
-            tempQString = tempText;
-            retval = tempQString;
+            retval = tempContact.addr;
             break;
 
         case GroupMemberModel::AvatarColorRole:
-            tempColor = dc_contact_get_color(tempContact);
+            tempColor = tempContact.color;
             tempQColor = QColor((tempColor >> 16) % 256, (tempColor >> 8) % 256, tempColor % 256, 0);
             retval = QString(tempQColor.name());
             break;
 
         case GroupMemberModel::AvatarInitialRole:
-            tempText = dc_contact_get_display_name(tempContact);
-            tempQString = tempText;
+            tempQString = tempContact.displayName;
             if (tempQString == "") {
                 tempQString = "#";
             } else {
@@ -115,7 +108,7 @@ QVariant GroupMemberModel::data(const QModelIndex &index, int role) const
             break;
 
         case GroupMemberModel::IsVerifiedRole:
-            if (2 == dc_contact_is_verified(tempContact)) {
+            if (2 == tempContact.verifiedState) {
                 retval = true;
             } else {
                 retval = false;
@@ -128,12 +121,6 @@ QVariant GroupMemberModel::data(const QModelIndex &index, int role) const
             break;
     }
 
-    if (tempText) {
-        dc_str_unref(tempText);
-    }
-
-    dc_contact_unref(tempContact);
-
     return retval;
 }
 
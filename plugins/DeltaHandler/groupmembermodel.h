@@ -23,6 +23,7 @@
 #include <QtGui>
 //#include <string>
 #include <vector>
+#include "contactCache.h"
 #include "../deltachat.h"
 
 class GroupMemberModel : public QAbstractListModel {
@@ -32,7 +33,7 @@ signals:
     void groupMemberCountChanged(int mcount);
 
 public:
-    explicit GroupMemberModel(QObject *parent = 0);
+    explicit GroupMemberModel(ContactCache* contactCache, QObject *parent = 0);
     ~GroupMemberModel();
 
     enum { DisplayNameRole, ProfilePicRole, EmailAddressRole, AvatarColorRole, AvatarInitialRole, IsSelfRole, IsVerifiedRole};
@@ -62,6 +63,7 @@ protected:
     QHash<int, QByteArray> roleNames() const;
 
 private:
+    ContactCache* m_contactCache;
     dc_context_t* m_context;
     uint32_t m_chatID;
     std::vector<uint32_t> m_membervector;
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonrpcclient.h"
+
+namespace C {
+#include <libintl.h>
+}
+
+JsonrpcClient::JsonrpcClient(DeltaHandler* dhandler, dc_jsonrpc_instance_t* jsoninst, JsonrpcResponseThread* responseThread, QObject* parent)
+    : QObject(parent), m_dhandler {dhandler}, m_jsonrpcInstance {jsoninst}, m_responseThread {responseThread}
+{
+    m_clock.start();
+
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+
+    bool connectSuccess = connect(m_timeoutTimer, SIGNAL(timeout()), this, SLOT(timeoutCheck()));
+    if (!connectSuccess) {
+        qFatal("JsonrpcClient::JsonrpcClient(): Could not connect signal timeout of m_timeoutTimer to slot timeoutCheck");
+    }
+}
+
+
+uint32_t JsonrpcClient::request(QString method, QString arguments, QObject* context, Callback callback, int timeoutMs)
+{
+    uint32_t requestId = m_dhandler->getJsonrpcRequestId();
+
+    PendingRequest pending;
+    pending.callback = callback;
+    pending.context = context;
+    pending.hasContext = (context != nullptr);
+    pending.deadline = (timeoutMs > 0) ? m_clock.elapsed() + timeoutMs : -1;
+    m_pendingRequests.insert(requestId, pending);
+
+    // has to be done before sending, otherwise the response
+    // might arrive before the id is known
+    m_responseThread->expectResponse(requestId);
+
+    dc_jsonrpc_request(m_jsonrpcInstance, m_dhandler->constructJsonrpcRequestString(method, arguments, requestId).toUtf8().constData());
+
+    if (timeoutMs > 0) {
+        scheduleTimeoutCheck();
+    }
+
+    return requestId;
+}
+
+
+void JsonrpcClient::cancel(uint32_t requestId)
+{
+    m_responseThread->forgetResponse(requestId);
+    m_pendingRequests.remove(requestId);
+}
+
+
+int JsonrpcClient::pendingCount() const
+{
+    return m_pendingRequests.size();
+}
+
+
+void JsonrpcClient::responseReceived(uint32_t requestId, QByteArray response)
+{
+    QHash<uint32_t, PendingRequest>::iterator it = m_pendingRequests.find(requestId);
+    if (it == m_pendingRequests.end()) {
+        // cancelled or timed out in the meantime
+        return;
+    }
+
+    // removed before calling the callback as the
+    // callback might send or cancel requests
+    PendingRequest pending = it.value();
+    m_pendingRequests.erase(it);
+
+    if (pending.hasContext && !pending.context) {
+        // the receiver doesn't exist anymore
+        return;
+    }
+
+    QJsonObject jsonObj = QJsonDocument::fromJson(response).object();
+    QJsonValue errorVal = jsonObj.value("error");
+
+    if (errorVal.isUndefined()) {
+        pending.callback(jsonObj.value("result"), "");
+    } else {
+        QString errorMsg = errorVal.toObject().value("message").toString();
+        if (errorMsg == "") {
+            errorMsg = C::gettext("Error");
+        }
+        pending.callback(QJsonValue(QJsonValue::Undefined), errorMsg);
+    }
+}
+
+
+void JsonrpcClient::timeoutCheck()
+{
+    qint64 now = m_clock.elapsed();
+
+    std::vector<uint32_t> timedOutIDs;
+    QHash<uint32_t, PendingRequest>::const_iterator it;
+    for (it = m_pendingRequests.constBegin(); it != m_pendingRequests.constEnd(); ++it) {
+        if (it.value().deadline != -1 && it.value().deadline <= now) {
+            timedOutIDs.push_back(it.key());
+        }
+    }
+
+    for (size_t i = 0; i < timedOutIDs.size(); ++i) {
+        // might have been cancelled by the callback
+        // of a previous request
+        QHash<uint32_t, PendingRequest>::iterator pendingIt = m_pendingRequests.find(timedOutIDs[i]);
+        if (pendingIt == m_pendingRequests.end()) {
+            continue;
+        }
+
+        PendingRequest pending = pendingIt.value();
+        m_pendingRequests.erase(pendingIt);
+        m_responseThread->forgetResponse(timedOutIDs[i]);
+
+        qDebug() << "JsonrpcClient::timeoutCheck(): request " << timedOutIDs[i] << " timed out";
+
+        if (!pending.hasContext || pending.context) {
+            pending.callback(QJsonValue(QJsonValue::Undefined), "Timeout");
+        }
+    }
+
+    scheduleTimeoutCheck();
+}
+
+
+void JsonrpcClient::scheduleTimeoutCheck()
+{
+    qint64 earliest {-1};
+    QHash<uint32_t, PendingRequest>::const_iterator it;
+    for (it = m_pendingRequests.constBegin(); it != m_pendingRequests.constEnd(); ++it) {
+        qint64 deadline = it.value().deadline;
+        if (deadline != -1 && (earliest == -1 || deadline < earliest)) {
+            earliest = deadline;
+        }
+    }
+
+    if (earliest == -1) {
+        m_timeoutTimer->stop();
+        return;
+    }
+
+    qint64 remaining = earliest - m_clock.elapsed();
+    m_timeoutTimer->start(remaining > 0 ? static_cast<int>(remaining) : 0);
+}
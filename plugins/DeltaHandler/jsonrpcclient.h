@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JSONRPCCLIENT_H
+#define JSONRPCCLIENT_H
+
+#include <QtCore>
+#include <functional>
+
+#include "deltahandler.h"
+#include "jsonrpcresponsethread.h"
+#include "../deltachat.h"
+
+class DeltaHandler;
+class JsonrpcResponseThread;
+
+/*
+ * Non-blocking jsonrpc calls from C++ code. The request is passed to
+ * dc_jsonrpc_request() and the callback is called in the GUI thread
+ * once JsonrpcResponseThread has received the response. Further calls
+ * can be made from within the callback to chain requests.
+ */
+class JsonrpcClient : public QObject {
+    Q_OBJECT
+
+public:
+    // Called with the "result" member of the response, or with the
+    // error message if the response contains an error or if the
+    // request timed out (result is undefined in these cases)
+    typedef std::function<void(QJsonValue result, QString error)> Callback;
+
+    JsonrpcClient(DeltaHandler* dhandler, dc_jsonrpc_instance_t* jsoninst, JsonrpcResponseThread* responseThread, QObject* parent = nullptr);
+
+    // Sends the request and returns its id. If context is not nullptr
+    // and is destroyed before the response arrives, the callback is not
+    // called. timeoutMs 0 means no timeout, to be used for calls that
+    // are expected to take long, such as get_backup.
+    uint32_t request(QString method, QString arguments, QObject* context, Callback callback, int timeoutMs = defaultTimeout);
+
+    // The callback of the request will not be called
+    void cancel(uint32_t requestId);
+
+    int pendingCount() const;
+
+    static constexpr int defaultTimeout = 30000;
+
+public slots:
+    // connected to JsonrpcResponseThread::internalJsonrpcResponse
+    void responseReceived(uint32_t requestId, QByteArray response);
+
+private slots:
+    void timeoutCheck();
+
+private:
+    struct PendingRequest {
+        Callback callback;
+        QPointer<QObject> context;
+        bool hasContext;
+        // in ms of m_clock, -1 if no timeout
+        qint64 deadline;
+    };
+
+    DeltaHandler* m_dhandler;
+    dc_jsonrpc_instance_t* m_jsonrpcInstance;
+    JsonrpcResponseThread* m_responseThread;
+
+    QHash<uint32_t, PendingRequest> m_pendingRequests;
+
+    // single shot, set to the earliest deadline
+    // of all pending requests
+    QTimer* m_timeoutTimer;
+    QElapsedTimer m_clock;
+    void scheduleTimeoutCheck();
+};
+
+#endif // JSONRPCCLIENT_H
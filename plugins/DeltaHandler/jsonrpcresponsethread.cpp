@@ -24,6 +24,20 @@ JsonrpcResponseThread::JsonrpcResponseThread(dc_jsonrpc_instance_t* jsoninst, st
     m_stopLoop = _stopLoop;
 }
 
+void JsonrpcResponseThread::expectResponse(uint32_t id)
+{
+    QMutexLocker locker(&m_expectedIdsMutex);
+    m_expectedIds.insert(id);
+}
+
+
+void JsonrpcResponseThread::forgetResponse(uint32_t id)
+{
+    QMutexLocker locker(&m_expectedIdsMutex);
+    m_expectedIds.remove(id);
+}
+
+
 void JsonrpcResponseThread::run()
 {
 
@@ -34,9 +48,30 @@ void JsonrpcResponseThread::run()
                 dc_str_unref(response);
                 break;
             }
-            QString stringResponse = response;
-            
-            emit newJsonrpcResponse(stringResponse);
+
+            qint64 responseId = parseResponseId(response);
+
+            if (responseId >= firstInternalRequestId) {
+                bool isExpected {false};
+                {
+                    QMutexLocker locker(&m_expectedIdsMutex);
+                    isExpected = m_expectedIds.remove(static_cast<uint32_t>(responseId));
+                }
+
+                // nobody is waiting for responses that
+                // have not been registered, drop them
+                if (isExpected) {
+                    emit internalJsonrpcResponse(static_cast<uint32_t>(responseId), QByteArray(response));
+                }
+            } else if (responseId != 0) {
+                // Also the case if the id could not be determined, let
+                // jsonrpc.mjs decide what to do. Responses with id 0 are
+                // answers to notifications which are ignored by jsonrpc.mjs.
+                QString stringResponse = response;
+                emit newJsonrpcResponse(stringResponse);
+            }
+
+            dc_str_unref(response);
         } // while
  
         qDebug() << "JsonrpcResponseThread::run(): Loop terminated";
@@ -45,3 +80,71 @@ void JsonrpcResponseThread::run()
          qDebug() << "JsonrpcResponseThread::run(): Fatal error: No dc_jsonrpc_instance_t defined, could not start response loop.";
     }
 }
+
+
+qint64 JsonrpcResponseThread::parseResponseId(const char* response)
+{
+    // Walks over the response until the top level key "id" is found,
+    // skipping the content of strings and nested objects/arrays
+    // without decoding them. The core usually puts the id before
+    // the result, so in most cases only the first few bytes have
+    // to be looked at.
+    int depth {0};
+    const char* p = response;
+
+    while (*p) {
+        if (*p == '"') {
+            const char* keyStart = ++p;
+            while (*p && *p != '"') {
+                if (*p == '\\' && *(p + 1)) {
+                    ++p;
+                }
+                ++p;
+            }
+            if (!*p) {
+                return -1;
+            }
+            const char* keyEnd = p;
+            ++p;
+
+            if (depth != 1 || keyEnd - keyStart != 2 || keyStart[0] != 'i' || keyStart[1] != 'd') {
+                continue;
+            }
+
+            while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+                ++p;
+            }
+            if (*p != ':') {
+                // was a value, not a key
+                continue;
+            }
+            ++p;
+            while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+                ++p;
+            }
+
+            if (*p < '0' || *p > '9') {
+                // null or a string id, never sent by this app
+                return -1;
+            }
+
+            qint64 retval {0};
+            while (*p >= '0' && *p <= '9') {
+                retval = retval * 10 + (*p - '0');
+                if (retval > 0xffffffffLL) {
+                    return -1;
+                }
+                ++p;
+            }
+            return retval;
+
+        } else if (*p == '{' || *p == '[') {
+            ++depth;
+        } else if (*p == '}' || *p == ']') {
+            --depth;
+        }
+        ++p;
+    }
+
+    return -1;
+}
@@ -24,6 +24,14 @@
 #include <string>
 #include "../deltachat.h"
 
+/*
+ * Reads the responses to dc_jsonrpc_request() calls. Only the id of each
+ * response is extracted here, the payload is not parsed. Responses to
+ * requests of jsonrpc.mjs in QML are passed via newJsonrpcResponse().
+ * Responses to requests sent by C++ code are only passed on if their id
+ * has been registered via expectResponse(), and then only to
+ * internalJsonrpcResponse(), all others are dropped.
+ */
 class JsonrpcResponseThread : public QThread {
     Q_OBJECT
 
@@ -32,12 +40,31 @@ class JsonrpcResponseThread : public QThread {
 
         void run();
 
+        // Ids from this value on are used by DeltaHandler (see
+        // DeltaHandler::getJsonrpcRequestId()), lower ids belong
+        // to jsonrpc.mjs
+        static constexpr uint32_t firstInternalRequestId = 1000000000;
+
+        // Can be called from the GUI thread. Has to be called
+        // before the request with this id is sent.
+        void expectResponse(uint32_t id);
+        // The response for this id will be dropped
+        void forgetResponse(uint32_t id);
+
     signals:
         void newJsonrpcResponse(QString stringResponse);
+        void internalJsonrpcResponse(uint32_t id, QByteArray response);
 
     private:
         dc_jsonrpc_instance_t* m_jsonrpcInstance;
         std::atomic<bool>* m_stopLoop;
+
+        QMutex m_expectedIdsMutex;
+        QSet<uint32_t> m_expectedIds;
+
+        // Returns the value of the top level member "id",
+        // or -1 if it is missing or not a number
+        static qint64 parseResponseId(const char* response);
 };
 
 #endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "messagesearchthread.h"
+
+MessageSearchThread::MessageSearchThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop)
+{
+    m_accounts = accounts;
+    m_stopLoop = _stopLoop;
+
+    m_hasPendingRequest = false;
+    m_pendingGeneration = 0;
+    m_pendingContext = nullptr;
+    m_pendingChatID = 0;
+    m_latestGeneration = 0;
+
+    // needed for queued connections
+    qRegisterMetaType<std::vector<uint32_t>>("std::vector<uint32_t>");
+}
+
+
+MessageSearchThread::~MessageSearchThread()
+{
+    if (m_pendingContext) {
+        dc_context_unref(m_pendingContext);
+    }
+}
+
+
+void MessageSearchThread::search(quint64 generation, uint32_t accID, uint32_t chatID, QString query)
+{
+    // get the context here, not in the thread, so m_accounts
+    // is only accessed from the GUI thread
+    dc_context_t* context = dc_accounts_get_account(m_accounts, accID);
+    if (!context) {
+        qDebug() << "MessageSearchThread::search(): ERROR: could not get context for account " << accID;
+        return;
+    }
+
+    QMutexLocker locker(&m_requestMutex);
+
+    // drop a request that has not been started yet
+    if (m_pendingContext) {
+        dc_context_unref(m_pendingContext);
+    }
+
+    m_hasPendingRequest = true;
+    m_pendingGeneration = generation;
+    m_pendingContext = context;
+    m_pendingChatID = chatID;
+    m_pendingQuery = query;
+    m_latestGeneration = generation;
+
+    m_requestCondition.wakeOne();
+}
+
+
+void MessageSearchThread::wakeUpForStop()
+{
+    QMutexLocker locker(&m_requestMutex);
+    m_requestCondition.wakeAll();
+}
+
+
+void MessageSearchThread::run()
+{
+    while (!(*m_stopLoop)) {
+        quint64 generation {0};
+        dc_context_t* context {nullptr};
+        uint32_t chatID {0};
+        QString query;
+
+        {
+            QMutexLocker locker(&m_requestMutex);
+            while (!m_hasPendingRequest && !(*m_stopLoop)) {
+                m_requestCondition.wait(&m_requestMutex);
+            }
+
+            if (!m_hasPendingRequest) {
+                // woken up for stopping
+                break;
+            }
+
+            generation = m_pendingGeneration;
+            context = m_pendingContext;
+            chatID = m_pendingChatID;
+            query = m_pendingQuery;
+
+            m_hasPendingRequest = false;
+            m_pendingContext = nullptr;
+        }
+
+        dc_array_t* resultArray = dc_search_msgs(context, chatID, query.toUtf8().constData());
+
+        std::vector<uint32_t> msgIDs;
+        if (resultArray) {
+            size_t count = dc_array_get_cnt(resultArray);
+            msgIDs.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                msgIDs[i] = dc_array_get_id(resultArray, i);
+            }
+            dc_array_unref(resultArray);
+        }
+
+        uint32_t accID = dc_get_id(context);
+        dc_context_unref(context);
+
+        bool superseded {false};
+        {
+            QMutexLocker locker(&m_requestMutex);
+            superseded = (generation != m_latestGeneration);
+        }
+
+        if (!superseded) {
+            emit searchFinished(generation, accID, chatID, msgIDs);
+        }
+    }
+
+    qDebug() << "MessageSearchThread::run(): Loop terminated";
+}
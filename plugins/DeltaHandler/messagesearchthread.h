@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MESSAGESEARCHTHREAD_H
+#define MESSAGESEARCHTHREAD_H
+
+#include <QtCore>
+#include <atomic>
+#include <vector>
+#include "../deltachat.h"
+
+/*
+ * Runs dc_search_msgs() for the search field in ChatView outside of
+ * the GUI thread. Only the most recent request is kept; if a new
+ * request comes in before the previous one has been started, the
+ * previous one is dropped. Requests that are already running can't be
+ * aborted, but their results are not emitted if a newer request
+ * exists by the time they are done.
+ */
+class MessageSearchThread : public QThread {
+    Q_OBJECT
+
+    public:
+        MessageSearchThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop);
+        ~MessageSearchThread();
+
+        void run();
+
+        // Can be called from the GUI thread. generation has to be
+        // increased with each call, it's passed back with the results
+        // so the receiver can recognize outdated ones.
+        void search(quint64 generation, uint32_t accID, uint32_t chatID, QString query);
+
+        // To be called after _stopLoop has been set to true, wakes
+        // up the thread so it can terminate
+        void wakeUpForStop();
+
+    signals:
+        // msgIDs are in the order as returned by dc_search_msgs()
+        void searchFinished(quint64 generation, uint32_t accID, uint32_t chatID, std::vector<uint32_t> msgIDs);
+
+    private:
+        dc_accounts_t* m_accounts;
+        std::atomic<bool>* m_stopLoop;
+
+        QMutex m_requestMutex;
+        QWaitCondition m_requestCondition;
+        // only valid if m_hasPendingRequest is true, the
+        // context is ref'd and has to be unref'd
+        bool m_hasPendingRequest;
+        quint64 m_pendingGeneration;
+        dc_context_t* m_pendingContext;
+        uint32_t m_pendingChatID;
+        QString m_pendingQuery;
+        // generation of the most recent call to search()
+        quint64 m_latestGeneration;
+};
+
+#endif
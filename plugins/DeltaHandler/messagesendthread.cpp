@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "messagesendthread.h"
+
+MessageSendThread::MessageSendThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop)
+{
+    m_accounts = accounts;
+    m_stopLoop = _stopLoop;
+    m_nextJobID = 1;
+    m_jobInProgress = false;
+}
+
+
+quint64 MessageSendThread::queueMessage(uint32_t accID, uint32_t chatID, dc_msg_t* msg)
+{
+    // The context of the caller might be unref'd before the job
+    // is processed (e.g., ChatModel switching to a chat of a
+    // different account), so the job gets its own reference
+    dc_context_t* context = dc_accounts_get_account(m_accounts, accID);
+    if (!context) {
+        qDebug() << "MessageSendThread::queueMessage(): ERROR: could not get context for account " << accID;
+        dc_msg_unref(msg);
+        return 0;
+    }
+
+    QMutexLocker locker(&m_jobMutex);
+    quint64 jobID = m_nextJobID++;
+    m_jobs.push_back(MessageSendJob { jobID, context, chatID, msg });
+    m_jobCondition.wakeOne();
+
+    return jobID;
+}
+
+
+int MessageSendThread::pendingCount()
+{
+    QMutexLocker locker(&m_jobMutex);
+    return static_cast<int>(m_jobs.size()) + (m_jobInProgress ? 1 : 0);
+}
+
+
+void MessageSendThread::wakeUpForStop()
+{
+    QMutexLocker locker(&m_jobMutex);
+    m_jobCondition.wakeAll();
+}
+
+
+void MessageSendThread::run()
+{
+    while (true) {
+        MessageSendJob job;
+
+        {
+            QMutexLocker locker(&m_jobMutex);
+            while (m_jobs.empty() && !(*m_stopLoop)) {
+                m_jobCondition.wait(&m_jobMutex);
+            }
+
+            // Messages that have been queued are still sent
+            // if the loop is stopped, they would be lost otherwise
+            if (m_jobs.empty()) {
+                break;
+            }
+
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            m_jobInProgress = true;
+        }
+
+        uint32_t accID = dc_get_id(job.context);
+        emit sendingStarted(accID, job.chatID, job.jobID);
+
+        uint32_t msgID = dc_send_msg(job.context, job.chatID, job.msg);
+        if (0 == msgID) {
+            qDebug() << "MessageSendThread::run(): ERROR: dc_send_msg() failed for chat ID " << job.chatID << " of account " << accID;
+        }
+
+        dc_msg_unref(job.msg);
+        dc_context_unref(job.context);
+
+        {
+            QMutexLocker locker(&m_jobMutex);
+            m_jobInProgress = false;
+        }
+
+        emit sendingFinished(accID, job.chatID, job.jobID, msgID);
+    }
+
+    qDebug() << "MessageSendThread::run(): Loop terminated";
+}
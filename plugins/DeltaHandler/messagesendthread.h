@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MESSAGESENDTHREAD_H
+#define MESSAGESENDTHREAD_H
+
+#include <QtCore>
+#include <atomic>
+#include <deque>
+#include "../deltachat.h"
+
+struct MessageSendJob {
+    quint64 jobID;
+    // obtained via dc_accounts_get_account() when queueing the
+    // job, unref'd by the thread after sending
+    dc_context_t* context;
+    uint32_t chatID;
+    // owned by the job, unref'd by the thread after sending
+    dc_msg_t* msg;
+};
+
+/*
+ * Sends messages via dc_send_msg() outside of the GUI thread. For
+ * messages with attachments, the core copies the file to the blob
+ * directory and does some database work before dc_send_msg() returns,
+ * which would otherwise block the UI.
+ *
+ * Jobs are processed in the order they have been queued by a single
+ * thread, so the order of messages within a chat is preserved. The
+ * queue is drained before the thread terminates.
+ */
+class MessageSendThread : public QThread {
+    Q_OBJECT
+
+    public:
+        MessageSendThread(dc_accounts_t* accounts, std::atomic<bool>* _stopLoop);
+
+        void run();
+
+        // Takes ownership of msg. Returns the ID of the job as
+        // passed in the signals below, or 0 if the account
+        // doesn't exist (msg is unref'd in this case).
+        quint64 queueMessage(uint32_t accID, uint32_t chatID, dc_msg_t* msg);
+
+        // number of jobs that have not been finished yet
+        int pendingCount();
+
+        // To be called after _stopLoop has been set to true, wakes
+        // up the thread so it can terminate
+        void wakeUpForStop();
+
+    signals:
+        void sendingStarted(uint32_t accID, uint32_t chatID, quint64 jobID);
+        // msgID is 0 if sending failed
+        void sendingFinished(uint32_t accID, uint32_t chatID, quint64 jobID, uint32_t msgID);
+
+    private:
+        dc_accounts_t* m_accounts;
+        std::atomic<bool>* m_stopLoop;
+
+        QMutex m_jobMutex;
+        QWaitCondition m_jobCondition;
+        std::deque<MessageSendJob> m_jobs;
+        quint64 m_nextJobID;
+        // job taken from m_jobs, but not finished yet
+        bool m_jobInProgress;
+};
+
+#endif // MESSAGESENDTHREAD_H
@@ -16,8 +16,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QFile>
+#include <QGuiApplication>
+#include <QStandardPaths>
+
 #include "notificationHelper.h"
 
+namespace C {
+#include <libintl.h>
+}
+
 
 NotificationHelper::NotificationHelper(DeltaHandler* dhandler, dc_accounts_t* accounts, EmitterThread* emthread, AccountsModel* accmodel)
     : QObject(nullptr)
@@ -51,3 +59,271 @@ void NotificationHelper::setNotifyContactRequests(bool notifContReq)
 {
     m_notifyContactRequests = notifContReq;
 }
+
+
+void NotificationHelper::processIncomingMessage(uint32_t accID, int chatID, int msgID)
+{
+    // When the event DC_INCOMING_MSG is received, just store the information in
+    // m_pendingNotifications. It will be processed when the core has finished
+    // fetching the messages and emits the DC_INCOMING_MSG_BUNCH event.
+    //
+    // Don't create notifications if disabled in settings or if the account is muted
+    if (m_enablePushNotifications && !(m_accountsmodel->accountIsMuted(accID))) {
+        m_pendingNotifications.add(accID, chatID, msgID);
+    }
+}
+
+
+void NotificationHelper::removePendingMessagesOfChat(uint32_t accID, int chatID)
+{
+    m_pendingNotifications.removeChat(accID, chatID);
+}
+
+
+std::vector<ChatNotification> NotificationHelper::buildChatNotifications(uint32_t accID, const std::vector<PendingChat> &pendingChats) const
+{
+    std::vector<ChatNotification> retval;
+
+    if (pendingChats.empty()) {
+        return retval;
+    }
+
+    // no chat opened if this call returns -1
+    int currentChatID = m_deltaHandler->getCurrentChatId();
+    bool appIsActive = (QGuiApplication::applicationState() == Qt::ApplicationActive);
+
+    // don't send a notification if the user is looking at the chatlist of
+    // the account for which a message was received
+    if (accID == m_currentAccID && -1 == currentChatID && appIsActive) {
+        return retval;
+    }
+
+    dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
+
+    if (!tempCon) {
+        qWarning() << "NotificationHelper::buildChatNotifications(): ERROR: tempCon is NULL";
+        return retval;
+    }
+
+    // The chats are in the order in which they received their first
+    // message of the burst, within a chat, the last message is the
+    // newest one.
+    for (size_t i = 0; i < pendingChats.size(); ++i) {
+        int tempChatID = pendingChats[i].chatID;
+        const std::vector<int> &msgIDs = pendingChats[i].msgIDs;
+
+        dc_chat_t* tempChat = dc_get_chat(tempCon, tempChatID);
+
+        if (!tempChat) {
+            qDebug() << "NotificationHelper::buildChatNotifications(): ERROR: tempChat is NULL";
+            continue;
+        }
+
+        bool needToSendNotif = true;
+
+        // is the chat muted?
+        if (1 == dc_chat_is_muted(tempChat)) {
+            needToSendNotif = false;
+
+        // or is the chat a contact request, and contact requests
+        // should not be shown?
+        } else if (1 == dc_chat_is_contact_request(tempChat) && !m_notifyContactRequests) {
+            needToSendNotif = false;
+
+        // or is the user looking at the chat in question?
+        } else if (accID == m_currentAccID && tempChatID == currentChatID && appIsActive) {
+            needToSendNotif = false;
+        }
+
+        if (!needToSendNotif) {
+            dc_chat_unref(tempChat);
+            continue;
+        }
+
+        ChatNotification notif;
+        notif.accID = accID;
+        notif.chatID = tempChatID;
+        notif.msgID = msgIDs.back();
+        notif.msgCount = static_cast<int>(msgIDs.size());
+
+        // Only the newest message is shown, so only
+        // this one and its sender are looked up
+        dc_msg_t* tempMsg = dc_get_msg(tempCon, notif.msgID);
+        if (!tempMsg) {
+            qWarning() << "NotificationHelper::buildChatNotifications(): ERROR: tempMsg is NULL";
+            dc_chat_unref(tempChat);
+            continue;
+        }
+
+        char* tempText = dc_chat_get_name(tempChat);
+        notif.chatName = tempText;
+        dc_str_unref(tempText);
+        tempText = nullptr;
+
+        QString fromString;
+        tempText = dc_msg_get_override_sender_name(tempMsg);
+        if (!tempText) {
+            dc_contact_t* tempContact = dc_get_contact(tempCon, dc_msg_get_from_id(tempMsg));
+            tempText = dc_contact_get_display_name(tempContact);
+            fromString = tempText;
+            dc_str_unref(tempText);
+            tempText = nullptr;
+            if (tempContact) {
+                dc_contact_unref(tempContact);
+            }
+        } else {
+            fromString = "~";
+            fromString += tempText;
+            dc_str_unref(tempText);
+            tempText = nullptr;
+        }
+
+        QString messageExcerpt("?");
+        dc_lot_t* tempLot = dc_msg_get_summary(tempMsg, tempChat);
+        if (tempLot) {
+            tempText = dc_lot_get_text2(tempLot);
+            if (tempText) {
+                messageExcerpt = tempText;
+                dc_str_unref(tempText);
+                tempText = nullptr;
+            }
+            dc_lot_unref(tempLot);
+        }
+
+        tempText = dc_chat_get_profile_image(tempChat);
+        if (tempText) {
+            notif.icon = tempText;
+            dc_str_unref(tempText);
+            tempText = nullptr;
+        }
+
+        notif.sender = fromString;
+        notif.excerpt = messageExcerpt;
+        composeText(notif);
+
+        retval.push_back(notif);
+
+        dc_msg_unref(tempMsg);
+        dc_chat_unref(tempChat);
+    }
+
+    dc_context_unref(tempCon);
+
+    return retval;
+}
+
+
+QString NotificationHelper::notificationTag(const ChatNotification &notif)
+{
+    return QString::number(notif.accID) + "_" + QString::number(notif.chatID) + "_" + QString::number(notif.msgID);
+}
+
+
+void NotificationHelper::composeText(ChatNotification &notif)
+{
+    if (1 == notif.msgCount) {
+        notif.title = notif.sender;
+        notif.body = notif.excerpt;
+    } else {
+        // All messages of the chat are collapsed into one
+        // notification that shows the newest one
+        notif.title = notif.chatName;
+        notif.body = QString(C::gettext("%1 new messages")).arg(notif.msgCount);
+        notif.body.append("\n");
+        notif.body.append(notif.sender + ": " + notif.excerpt);
+    }
+}
+
+
+void NotificationHelper::sendChatNotification(const ChatNotification &notif)
+{
+    QString tag = notificationTag(notif);
+    m_msgCountPerTag.insert(tag, notif.msgCount);
+    sendNotification(notif.title, notif.body, tag, notif.icon);
+}
+
+
+int NotificationHelper::takeMsgCountOfTag(const QString &tag)
+{
+    QHash<QString, int>::iterator it = m_msgCountPerTag.find(tag);
+    if (it == m_msgCountPerTag.end()) {
+        return 1;
+    }
+
+    int retval = it.value();
+    m_msgCountPerTag.erase(it);
+    return retval;
+}
+
+
+int NotificationHelper::msgCountOfTag(const QString &tag) const
+{
+    return m_msgCountPerTag.value(tag, 1);
+}
+
+
+void NotificationHelper::createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar)
+{
+    QString icon;
+    if (showSelfAvatar) {
+        dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
+
+        char* tempText = dc_get_config(tempCon, "selfavatar");
+        icon = tempText;
+        dc_str_unref(tempText);
+    
+        dc_context_unref(tempCon);
+    }
+
+    // use the app icon if the avatar of the account should not be
+    // shown or if no selfavatar is set for the account
+    if (!showSelfAvatar || icon == "") {
+        icon = logoIconPath();
+    }
+
+    QString notifTitle;
+    QString notifBody;
+
+    // The correct way would be to have the corresponding plural cases defined 
+    // in the po files and use ngettext like this:
+    //notifTitle = C::ngettext("New message", "New messages", numberOfMessages);
+    //notifBody = QString(C::ngettext("%1 new message", "%1 new messages", numberOfMessages)).arg(numberOfMessages);
+    //
+    // However, in the xml language files from the DC Transifex project, the specifiers are "few", "many",
+    // "other" - how exactly should that be converted to the po files? It doesn't seem to correspond to
+    // the plural cases as in, e.g., Polish => TODO: check and solve correctly
+    //
+    // Here's a preliminary solution that disregards specifics of languages that
+    // have more than one plural form TODO: check whether the preliminary solution works
+    // at least somewhat in the po files, esp for Polish
+    if (numberOfMessages == 1) {
+        notifTitle = C::gettext("New message");
+        notifBody = QString(C::gettext("%1 new message")).arg(numberOfMessages);
+    } else {
+        notifTitle = C::gettext("New messages");
+        notifBody = QString(C::gettext("%1 new messages")).arg(numberOfMessages);
+    }
+
+    QString tagString;
+    tagString.setNum(accID);
+
+    tagString.append("_summary_");
+
+    QString tempNumQStr;
+    tempNumQStr.setNum(numberOfMessages);
+
+    tagString.append(tempNumQStr);
+
+    sendNotification(notifTitle, notifBody, tagString, icon);
+}
+
+
+QString NotificationHelper::logoIconPath()
+{
+    QString icon = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg";
+    if (!QFile::exists(icon)) {
+        QFile logoFile(":assets/logo.svg");
+        logoFile.copy(icon);
+    }
+    return icon;
+}
@@ -19,24 +19,43 @@
 #ifndef NOTIFICATIONHELPER_H
 #define NOTIFICATIONHELPER_H
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 
+#include <vector>
+
 #include "../deltachat.h"
 
 #include "deltahandler.h"
 #include "emitterthread.h"
 #include "accountsmodel.h"
+#include "pendingNotificationStore.h"
 
 class DeltaHandler;
 class EmitterThread;
 class AccountsModel;
 
-// Not needed in the abstract class, but in two subclasses
-struct IncomingMsgStruct {
+// One notification per chat for a burst of incoming messages,
+// see NotificationHelper::buildChatNotifications()
+struct ChatNotification {
     uint32_t accID;
     int chatID;
+    // The newest message of the burst in this chat. Its ID is
+    // part of the tag, so the notification is removed once this
+    // message has been seen.
     int msgID;
+    // Also contains the messages of a notification of the same
+    // chat that is replaced by this one, see composeText()
+    int msgCount;
+    QString chatName;
+    // sender and excerpt of the newest message
+    QString sender;
+    QString excerpt;
+    QString title;
+    QString body;
+    // empty if the chat has no image
+    QString icon;
 };
 
 /* 
@@ -61,6 +80,15 @@ public:
     virtual void removeNotification(QString tag) = 0;
     virtual void removeActiveNotificationsOfChat(uint32_t accID, int chatID) = 0;
 
+    // Messages of the chat that are still waiting for the incoming
+    // msg bunch event don't need a notification anymore. Has to be
+    // called right when the chat is noticed, not deferred, as
+    // messages arriving afterwards still need one.
+    void removePendingMessagesOfChat(uint32_t accID, int chatID);
+
+protected slots:
+    void processIncomingMessage(uint32_t accID, int chatID, int msgID);
+
 protected:
     // set in constructor
     DeltaHandler* m_deltaHandler;
@@ -73,6 +101,45 @@ protected:
     bool m_enablePushNotifications;
     bool m_detailedPushNotifications;
     bool m_notifyContactRequests;
+
+    // Caching incoming msgs per account and chat. Will then be
+    // processed once the incoming msg bunch event is received.
+    PendingNotificationStore m_pendingNotifications;
+
+    // Creates one notification per chat for the pending messages
+    // of accID. Each chat and the sender of its newest
+    // message are looked up only once. Chats for which no notification
+    // should be created are skipped:
+    // - muted chats
+    // - contact requests if the corresponding setting is off
+    // - the chat the user is currently looking at, if the app is active
+    // - all chats if the user is looking at the chatlist of accID
+    std::vector<ChatNotification> buildChatNotifications(uint32_t accID, const std::vector<PendingChat> &pendingChats) const;
+
+    // <accID>_<chatID>_<msgID>
+    static QString notificationTag(const ChatNotification &notif);
+
+    // Sets title and body from the other fields. Has to be called
+    // again if msgCount is changed.
+    static void composeText(ChatNotification &notif);
+
+    // Number of messages contained in the detailed notifications
+    // that have been sent, key is the tag. Needed to add them up
+    // if a notification is replaced or the present ones are counted
+    // for a summary.
+    QHash<QString, int> m_msgCountPerTag;
+
+    // Sends the notification and records its message count
+    void sendChatNotification(const ChatNotification &notif);
+    // Returns the message count of the tag and removes it. Tags of
+    // notifications not sent in this run of the app count as 1.
+    int takeMsgCountOfTag(const QString &tag);
+    int msgCountOfTag(const QString &tag) const;
+
+    void createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar);
+    static QString logoIconPath();
+
+    virtual void sendNotification(QString summary, QString body, QString tag, QString icon) = 0;
 };
 
 #endif // NOTIFICATIONHELPER_H
@@ -16,18 +16,12 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QFile>
-#include <QStandardPaths>
 #include <QtDBus/QDBusMessage>
 #include <QDBusPendingReply>
 #include <QDBusError>
 
 #include "notificationsFreedesktop.h"
 
-namespace C {
-#include <libintl.h>
-}
-
 
 NotificationsFreedesktop::NotificationsFreedesktop(DeltaHandler* dhandler, dc_accounts_t* accounts, EmitterThread* emthread, AccountsModel* accmodel, QDBusConnection* bus)
     : NotificationHelper(dhandler, accounts, emthread, accmodel), m_bus {bus}
@@ -61,19 +55,6 @@ NotificationsFreedesktop::~NotificationsFreedesktop()
 }
 
 
-void NotificationsFreedesktop::processIncomingMessage(uint32_t accID, int chatID, int msgID)
-{
-    // When the event DC_INCOMING_MSG is received, just store the information in
-    // m_incomingMsgCache. It will be processed when the core has finished
-    // fetching the messages and emits the DC_INCOMING_MSG_BUNCH event.
-    //
-    // Don't create notifications if disabled in settings or if the account is muted
-    if (m_enablePushNotifications && !(m_accountsmodel->accountIsMuted(accID))) {
-        m_incomingMsgCache.push_back(IncomingMsgStruct {accID, chatID, msgID});
-    }
-}
-
-
 void NotificationsFreedesktop::processIncomingMsgBunch(uint32_t accID)
 {
     // The signal for DC_EVENT_INCOMING_MSG_BUNCH is used to
@@ -82,16 +63,17 @@ void NotificationsFreedesktop::processIncomingMsgBunch(uint32_t accID)
     if (!m_enablePushNotifications) {
         // Notifications disabled in the settings, so just
         // remove all cached messages. Done here in addition
-        // to not adding anything to m_incomingMsgCache
+        // to not adding anything to m_pendingNotifications
         // because fetching msgs could take some time and the user
         // might disable the setting in the meantime.
-        m_incomingMsgCache.resize(0);
+        m_pendingNotifications.clear();
         return;
     }
 
     // Aim is to not have more than 9 detailed notifications per
     // IMAP fetch. If there are more, one single summary notification
-    // is generated instead.
+    // is generated instead. Messages of the same chat are collapsed
+    // into one notification, see buildChatNotifications().
     // In contrast to the NotificationsLomiriPostal class, previous
     // notifications are not replaced and not considered in 
     // the generation of summary notifications.
@@ -113,126 +95,12 @@ void NotificationsFreedesktop::processIncomingMsgBunch(uint32_t accID)
     // to handle a large number of notifications on this platform.
     // This is not necessarily true by other implementations.
 
-    // no chat opened if this call returns -1
-    int currentChatID = m_deltaHandler->getCurrentChatId();
-
-    // don't send a notification if the user is looking at the chatlist of
-    // the account for which a message was received...
-    if (accID == m_currentAccID && -1 == currentChatID && QGuiApplication::applicationState() == Qt::ApplicationActive) {
-        // ...but remove all cached IDs for this accID
-        size_t i = 0;
-        size_t endpos = m_incomingMsgCache.size();
-        while (i < endpos) {
-            if (m_incomingMsgCache[i].accID == accID) {
-                m_incomingMsgCache.erase(m_incomingMsgCache.begin() + i);
-                --endpos;
-            } else {
-                // only increase if no item removed
-                ++i;
-            }
-        }
-
-        // In contrast to the similar method in NotificationsLomiriPostal,
-        // we can return here as we are dealing with only one accID.
-        return;
-    }
-
-    // sort out message IDs for which no notification
-    // should be created:
-    // - muted chats
-    // - contact requests if the corresponding setting is off
-    // - the chat the user is currently looking at, if any and if
-    //   the app is active
-    //
-    // Cache the info about whether a notification should
-    // be generated for a certain chat nor not
-    struct SendNotifForChatStruct { int chatID; bool shouldSendNotification; };
-    std::vector<SendNotifForChatStruct> chatInfoVec;
-
-    // The context of accID is needed for several operations later on
-    // (don't exit without unreferencing it!).
-    dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-    // go through m_incomingMsgCache and put only those IDs for which a notification
-    // should be created into messagesToNotify. The vector is of type
-    // IncomingMsgStruct, i.e., contains accID, chatID, msgID
-    std::vector<IncomingMsgStruct> messagesToNotify;
-
-    size_t i = 0;
-    size_t endpos = m_incomingMsgCache.size();
-
-    while (i < endpos) {
-        if (m_incomingMsgCache[i].accID != accID) {
-            // cached incoming message does not belong to the account
-            // for which the DC_EVENT_INCOMING_MSG_BUNCH event
-            // was received, so just leave it in the cache
-            ++i;
-            continue;
-        }
-
-        int tempChatID = m_incomingMsgCache[i].chatID;
-
-        // see if we already know whether a notification has to be
-        // sent for this chat or not
-        bool isInChatInfoVec = false;
-
-        // true by default, will be sent to false if any of the
-        // do-not-notify conditions is fulfilled
-        bool needToSendNotif = true;
-
-        for (size_t j = 0; j < chatInfoVec.size(); ++j) {
-            SendNotifForChatStruct tempStruct = chatInfoVec[j];
-            if (tempStruct.chatID == tempChatID) {
-                isInChatInfoVec = true;
-                needToSendNotif = tempStruct.shouldSendNotification;
-                break;
-            }
-        }
-
-        if (!isInChatInfoVec) {
-            // we did not find it in chatInfoVec, obtain the info
-            // whether a notification has to be sent
-            dc_chat_t* tempChat = dc_get_chat(tempCon, tempChatID);
-
-            // is the chat muted?
-            if (1 == dc_chat_is_muted(tempChat)) {
-                needToSendNotif = false;
-
-            // or is the chat a contact request, and contact requests
-            // should not be shown?
-            } else if (1 == dc_chat_is_contact_request(tempChat) && !m_notifyContactRequests) {
-                needToSendNotif = false;
+    // All core lookups are done here, before any DBus call is made
+    std::vector<ChatNotification> notifications = buildChatNotifications(accID, m_pendingNotifications.takeAccount(accID));
 
-            // or is the user looking at the chat in question?
-            } else if (accID == m_currentAccID && tempChatID == currentChatID && QGuiApplication::applicationState() == Qt::ApplicationActive) {
-                needToSendNotif = false;
-            }
-
-            // add the info about the chat to chatInfoVec
-            chatInfoVec.push_back(SendNotifForChatStruct {tempChatID, needToSendNotif});
-
-            dc_chat_unref(tempChat);
-        }
-
-        // now needToSendNotif is valid
-        if (needToSendNotif) {
-            messagesToNotify.push_back(IncomingMsgStruct { accID, tempChatID, m_incomingMsgCache[i].msgID });
-        }
-
-        // delete the entry from the cache
-        m_incomingMsgCache.erase(m_incomingMsgCache.begin() + i);
-        --endpos;
-        // do not increase i; this has only to be done if no
-        // item is removed (see the "continue" case above where the accID
-        // of the entry in the cache does not equal the one from the event)
-    }
-
-    dc_context_unref(tempCon);
-
-    // messagesToNotify now contains all messages for which a notification
-    // should be sent. Stop here if there are no messages for which
+    // Stop here if there are no messages for which
     // a notification has to be created.
-    if (messagesToNotify.size() == 0) {
+    if (notifications.size() == 0) {
         return;
     }
 
@@ -242,190 +110,88 @@ void NotificationsFreedesktop::processIncomingMsgBunch(uint32_t accID)
         emit newMessageForInactiveAccount();
     }
 
-    // TODO: maybe via the
-    // Check how many notifications are already present
-    // in the system for this account
+    int numberOfMessages {0};
+    for (size_t i = 0; i < notifications.size(); ++i) {
+        numberOfMessages += notifications[i].msgCount;
+    }
 
     // Trigger the notification depending on settings
     // and the number of notifications to be generated
     if (m_detailedPushNotifications) {
-        if ((messagesToNotify.size()) > 9) {
-            // don't send out a notification for each message if there 
-            // are more than 9 messages to notify
-            createSummaryNotification(accID, messagesToNotify.size(), true);
+        if (notifications.size() > 9) {
+            // don't send out a notification for each chat if there 
+            // are more than 9 chats to notify
+            createSummaryNotification(accID, numberOfMessages, true);
         } else {
-            for (size_t l = 0; l < messagesToNotify.size(); ++l) {
-                IncomingMsgStruct tempStruct = messagesToNotify[l];
-                createDetailedNotification(tempStruct.accID, tempStruct.chatID, tempStruct.msgID);
-            }
-        }
-    } else { // if (m_detailedPushNotifications)
-        createSummaryNotification(0, messagesToNotify.size(), false);
-    }
-}
-
+            for (size_t i = 0; i < notifications.size(); ++i) {
+                // A notification of the chat that is still shown
+                // will be replaced by this one (see sendNotification()),
+                // so its messages are added
+                QString startOfTag = QString::number(accID) + "_" + QString::number(notifications[i].chatID) + "_";
+                int previousMsgCount {0};
+                QMap<QString, std::vector<unsigned int>>::const_iterator it;
+                for (it = m_tagNotificationIdCorrelation.constBegin(); it != m_tagNotificationIdCorrelation.constEnd(); ++it) {
+                    if (it.key().startsWith(startOfTag)) {
+                        previousMsgCount += takeMsgCountOfTag(it.key());
+                    }
+                }
 
-void NotificationsFreedesktop::createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar)
-{
-    QString icon;
-    if (showSelfAvatar) {
-        dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-        char* tempText = dc_get_config(tempCon, "selfavatar");
-        icon = tempText;
-        dc_str_unref(tempText);
-    
-        dc_context_unref(tempCon);
-    }
+                if (previousMsgCount > 0) {
+                    notifications[i].msgCount += previousMsgCount;
+                    composeText(notifications[i]);
+                }
 
-    // use the app icon if the avatar of the account should not be
-    // shown or if no selfavatar is set for the account
-    if (!showSelfAvatar || icon == "") {
-        icon = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg";
-        if (!QFile::exists(icon)) {
-            QFile logoFile(":assets/logo.svg");
-            logoFile.copy(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg");
+                sendChatNotification(notifications[i]);
+            }
         }
+    } else { // if (m_detailedPushNotifications)
+        createSummaryNotification(0, numberOfMessages, false);
     }
-
-    QString notifTitle;
-    QString notifBody;
-
-    // The correct way would be to have the corresponding plural cases defined 
-    // in the po files and use ngettext like this:
-    //notifTitle = C::ngettext("New message", "New messages", numberOfMessages);
-    //notifBody = QString(C::ngettext("%1 new message", "%1 new messages", numberOfMessages)).arg(numberOfMessages);
-    //
-    // However, in the xml language files from the DC Transifex project, the specifiers are "few", "many",
-    // "other" - how exactly should that be converted to the po files? It doesn't seem to correspond to
-    // the plural cases as in, e.g., Polish => TODO: check and solve correctly
-    //
-    // Here's a preliminary solution that disregards specifics of languages that
-    // have more than one plural form TODO: check whether the preliminary solution works
-    // at least somewhat in the po files, esp for Polish
-    if (numberOfMessages == 1) {
-        notifTitle = C::gettext("New message");
-        notifBody = QString(C::gettext("%1 new message")).arg(numberOfMessages);
-    } else {
-        notifTitle = C::gettext("New messages");
-        notifBody = QString(C::gettext("%1 new messages")).arg(numberOfMessages);
-    }
-
-    QString tagString;
-    tagString.setNum(accID);
-
-    tagString.append("_summary_");
-
-    QString tempNumQStr;
-    tempNumQStr.setNum(numberOfMessages);
-
-    tagString.append(tempNumQStr);
-
-    sendNotification(notifTitle, notifBody, tagString, icon);
 }
 
 
-void NotificationsFreedesktop::createDetailedNotification(uint32_t accID, int chatID, int msgID)
+void NotificationsFreedesktop::sendNotification(QString summary, QString body, QString tag, QString icon)
 {
-    dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-    if (!tempCon) {
-        qWarning() << "NotificationsFreedesktop::createDetailedNotification(): ERROR: tempCon is NULL";
-        return;
-    }
-
-    dc_chat_t* tempChat = dc_get_chat(tempCon, chatID);
-
-    if (!tempChat) {
-        qDebug() << "NotificationsFreedesktop::createDetailedNotification(): ERROR: tempChat is NULL";
-        dc_context_unref(tempCon);
-        return;
-    }
-
-    QString accNumberString;
-    accNumberString.setNum(accID);
-
-    QString chatNumberString;
-    chatNumberString.setNum(chatID);
-
-    QString msgNumberString;
-    msgNumberString.setNum(msgID);
-
-    dc_msg_t* tempMsg = dc_get_msg(tempCon, msgID);
-    if (!tempMsg) {
-        qWarning() << "NotificationsFreedesktop::createDetailedNotification(): ERROR: tempMsg is NULL";
-        dc_chat_unref(tempChat);
-        dc_context_unref(tempCon);
-        return;
-    }
-
-    dc_lot_t* tempLot = dc_msg_get_summary(tempMsg, tempChat);
-    if (!tempLot) {
-        qWarning() << "NotificationsFreedesktop::createDetailedNotification(): ERROR: tempLot is NULL";
-        dc_chat_unref(tempChat);
-        dc_context_unref(tempCon);
-        dc_msg_unref(tempMsg);
-        return;
-    }
-
-
-    QString fromString;
-    char* tempText = dc_msg_get_override_sender_name(tempMsg);
-    if (!tempText) {
-        tempText = dc_contact_get_display_name(dc_get_contact(tempCon, dc_msg_get_from_id(tempMsg)));
-        fromString = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    } else {
-        fromString = "~";
-        fromString += tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
-
-    QString messageExcerpt("?");
-    tempText = dc_lot_get_text2(tempLot);
-    if (tempText) {
-        messageExcerpt = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
-
-    QString icon("");
-
-    tempText = dc_chat_get_profile_image(tempChat);
-    if (tempText) {
-        icon = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
+    qDebug() << "NotificationsFreedesktop::sendNotification(): Creating notification with tag " << tag;
 
     if (icon == "") {
-        icon = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg";
-        if (!QFile::exists(icon)) {
-            QFile logoFile(":assets/logo.svg");
-            logoFile.copy(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg");
-        }
+        icon = logoIconPath();
     }
 
-    sendNotification(fromString, messageExcerpt, accNumberString + "_" + chatNumberString + "_" + msgNumberString, icon);
-
-    dc_msg_unref(tempMsg);
-    dc_chat_unref(tempChat);
-    dc_context_unref(tempCon);
-    dc_lot_unref(tempLot);
-}
-
-
-void NotificationsFreedesktop::sendNotification(QString summary, QString body, QString tag, QString icon)
-{
-    qDebug() << "NotificationsFreedesktop::sendNotification(): Creating notification with tag " << tag;
-
     // The Notify method expects susssasa{sv}i as argument
     QDBusMessage message = QDBusMessage::createMethodCall("org.freedesktop.Notifications", "/org/freedesktop/Notifications", "org.freedesktop.Notifications", "Notify");
 
     QString app_name("DeltaTouch");
     unsigned int replaces_id {0};
+
+    // Tags of detailed notifications are <accID>_<chatID>_<msgID>. If
+    // a notification of the same chat is still present, it is
+    // updated via replaces_id, any older ones of the chat are closed.
+    QStringList tagParts = tag.split('_');
+    if (tagParts.size() == 3 && tagParts.at(1) != "summary") {
+        QString startOfTag = tagParts.at(0) + "_" + tagParts.at(1) + "_";
+
+        QStringList tagsOfChat;
+        QMap<QString, std::vector<unsigned int>>::const_iterator it;
+        for (it = m_tagNotificationIdCorrelation.constBegin(); it != m_tagNotificationIdCorrelation.constEnd(); ++it) {
+            if (it.key().startsWith(startOfTag)) {
+                tagsOfChat.append(it.key());
+            }
+        }
+
+        for (int i = 0; i < tagsOfChat.size(); ++i) {
+            std::vector<unsigned int> tempVec = m_tagNotificationIdCorrelation.take(tagsOfChat[i]);
+            for (size_t j = 0; j < tempVec.size(); ++j) {
+                if (replaces_id != 0) {
+                    QDBusMessage closeMessage = QDBusMessage::createMethodCall("org.freedesktop.Notifications", "/org/freedesktop/Notifications", "org.freedesktop.Notifications", "CloseNotification");
+                    closeMessage << replaces_id;
+                    m_bus->send(closeMessage);
+                }
+                replaces_id = tempVec[j];
+            }
+        }
+    }
+
     // The "actions" parameter is "as" = array of strings = QStringList,
     // leave it empty
     QStringList actions;
@@ -461,7 +227,7 @@ void NotificationsFreedesktop::getDbusResponseForNotifyCall(QDBusPendingCallWatc
         QDBusError myerror = reply.error();
         qDebug() << "NotificationsFreedesktop::getDbusResponseForNotifyCall(): ERROR: Could not create notification due to DBus error " << myerror.name() << ", message is: " << myerror.message();
         // still remove the entry in m_callTagCorrelation
-        m_callTagCorrelation.remove(watcher);
+        m_msgCountPerTag.remove(m_callTagCorrelation.take(watcher));
 
     } else { // no error, got valid DBus reply
         // the ID of the notification
@@ -488,6 +254,8 @@ void NotificationsFreedesktop::getDbusResponseForNotifyCall(QDBusPendingCallWatc
             m_tagNotificationIdCorrelation.insert(tag, listOfIds);
         } else if (tag != "") {
             qWarning() << "NotificationsFreedesktop::getDbusResponseForNotifyCall(): Warning: Size of m_tagNotificationIdCorrelation is >= 300, not adding any more tag/ID pairs.";
+            // can't be replaced anymore
+            m_msgCountPerTag.remove(tag);
         } else {
             // did not find the tag for this call watcher
             qDebug() << "NotificationsFreedesktop::getDbusResponseForNotifyCall(): ERROR: Call watcher not found in cache, could not attribute notification ID to tag";
@@ -525,6 +293,7 @@ void NotificationsFreedesktop::processNotificationClosedDbusSignal(unsigned int
                     m_tagNotificationIdCorrelation.erase(it);
                     m_tagNotificationIdCorrelation.insert(tempKey, tempVec);
                 } else {
+                    m_msgCountPerTag.remove(it.key());
                     m_tagNotificationIdCorrelation.erase(it);
                 }
                 break;
@@ -541,6 +310,7 @@ void NotificationsFreedesktop::processNotificationClosedDbusSignal(unsigned int
 void NotificationsFreedesktop::removeNotification(QString tag)
 {
     std::vector<unsigned int> tempVec = m_tagNotificationIdCorrelation.take(tag);
+    m_msgCountPerTag.remove(tag);
 
     // if the tag was not found in m_tagNotificationIdCorrelation, tempVec
     // is automatically 0.
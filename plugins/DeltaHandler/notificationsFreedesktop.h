@@ -43,17 +43,11 @@ public:
     void removeActiveNotificationsOfChat(uint32_t accID, int chatID) override;
 
 protected slots:
-    void processIncomingMessage(uint32_t accID, int chatID, int msgID);
     void processIncomingMsgBunch(uint32_t accID);
     void getDbusResponseForNotifyCall(QDBusPendingCallWatcher* call);
     void processNotificationClosedDbusSignal(unsigned int id, unsigned int reason);
 
 protected:
-    // Caching incoming msgs along with their accIDs and chatIDs.
-    // Will then be processed once the incoming msg bunch
-    // event is received.
-    std::vector<IncomingMsgStruct> m_incomingMsgCache;
-
     // When creating a call watcher for the Notify DBus method, the pointer to it
     // is saved along with the tag of the notification. This enables
     // to close the notification later on.
@@ -68,9 +62,10 @@ protected:
     QDBusConnection* m_bus;
 
     // protected methods
-    void createDetailedNotification(uint32_t accID, int chatID, int msgID);
-    void createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar);
-    void sendNotification(QString summary, QString body, QString tag, QString icon);
+
+    // If a notification for the same chat is still shown, it is
+    // replaced instead of adding a new one
+    void sendNotification(QString summary, QString body, QString tag, QString icon) override;
 };
 
 #endif // NOTIFICATIONSFREEDESKTOP_H
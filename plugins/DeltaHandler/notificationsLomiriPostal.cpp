@@ -16,8 +16,6 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QFile>
-#include <QStandardPaths>
 #include <QtDBus/QDBusMessage>
 #include <QDBusPendingReply>
 #include <QDBusError>
@@ -28,10 +26,6 @@
 
 #include "notificationsLomiriPostal.h"
 
-namespace C {
-#include <libintl.h>
-}
-
 
 NotificationsLomiriPostal::NotificationsLomiriPostal(DeltaHandler* dhandler, dc_accounts_t* accounts, EmitterThread* emthread, AccountsModel* accmodel, QDBusConnection* bus)
     : NotificationHelper(dhandler, accounts, emthread, accmodel), m_dbusListPersistentReplyPending {false}, m_dbusRemoveSummaryNotifsPending {false}, m_bus {bus}, m_notifTagsToDeletePendingReply {false}
@@ -55,19 +49,6 @@ NotificationsLomiriPostal::~NotificationsLomiriPostal()
 }
 
 
-void NotificationsLomiriPostal::processIncomingMessage(uint32_t accID, int chatID, int msgID)
-{
-    // When the event DC_INCOMING_MSG is received, just store the information in
-    // m_incomingMsgCache. It will be processed when the core has finished
-    // fetching the messages and emits the DC_INCOMING_MSG_BUNCH event.
-    //
-    // Don't create notifications if disabled in settings or if the account is muted
-    if (m_enablePushNotifications && !(m_accountsmodel->accountIsMuted(accID))) {
-        m_incomingMsgCache.push_back(IncomingMsgStruct {accID, chatID, msgID});
-    }
-}
-
-
 void NotificationsLomiriPostal::processIncomingMsgBunch(uint32_t accID)
 {
     // The signal for DC_EVENT_INCOMING_MSG_BUNCH is used to
@@ -76,10 +57,10 @@ void NotificationsLomiriPostal::processIncomingMsgBunch(uint32_t accID)
     if (!m_enablePushNotifications) {
         // Notifications disabled in the settings, so just
         // remove all cached messages. Done here in addition
-        // to not adding anything to m_incomingMsgCache
+        // to not adding anything to m_pendingNotifications
         // because fetching msgs could take some time and the user
         // might disable the setting in the meantime.
-        m_incomingMsgCache.resize(0);
+        m_pendingNotifications.clear();
         m_accIDsToProcess.resize(0);
         return;
     }
@@ -134,6 +115,17 @@ void NotificationsLomiriPostal::finishProcessIncomingMsgBunch(QDBusPendingCallWa
     } else { // no error, got valid DBus reply
         // the tags of the currently active notifications
         taglist = reply.argumentAt<0>();
+
+        // forget the message counts of notifications that
+        // have been dismissed by the user
+        QHash<QString, int>::iterator countIt = m_msgCountPerTag.begin();
+        while (countIt != m_msgCountPerTag.end()) {
+            if (taglist.contains(countIt.key())) {
+                ++countIt;
+            } else {
+                countIt = m_msgCountPerTag.erase(countIt);
+            }
+        }
     }
 
     call->deleteLater();
@@ -141,136 +133,27 @@ void NotificationsLomiriPostal::finishProcessIncomingMsgBunch(QDBusPendingCallWa
     if (!m_enablePushNotifications) {
         // Notifications disabled in the settings, so just
         // remove all cached messages. Done here in addition
-        // to not adding anything to m_incomingMsgCache
+        // to not adding anything to m_pendingNotifications
         // because fetching msgs could take some time and the user
         // might disable the setting in the meantime.
-        m_incomingMsgCache.resize(0);
+        m_pendingNotifications.clear();
         m_accIDsToProcess.resize(0);
         return;
     }
 
-    // no chat opened if this call returns -1
-    int currentChatID = m_deltaHandler->getCurrentChatId();
-
     for (size_t m = 0; m < m_accIDsToProcess.size(); ++m) {
         // No check for muted account because incoming msgs for muted
-        // accounts are not added to m_incomingMsgCache
+        // accounts are not added to m_pendingNotifications
         uint32_t accID = m_accIDsToProcess[m];
 
-        // don't send a notification if the user is looking at the chatlist of
-        // the account for which a message was received...
-        if (accID == m_currentAccID && -1 == currentChatID && QGuiApplication::applicationState() == Qt::ApplicationActive) {
-            // ...but remove all cached IDs for this accID
-            size_t i = 0;
-            size_t endpos = m_incomingMsgCache.size();
-            while (i < endpos) {
-                if (m_incomingMsgCache[i].accID == accID) {
-                    m_incomingMsgCache.erase(m_incomingMsgCache.begin() + i);
-                    --endpos;
-                } else {
-                    // only increase if no item removed
-                    ++i;
-                }
-            }
-        }
-
-        // sort out message IDs for which no notification
-        // should be created:
-        // - muted chats
-        // - contact requests if the corresponding setting is off
-        // - the chat the user is currently looking at, if any and if
-        //   the app is active
-        //
-        // Cache the info about whether a notification should
-        // be generated for a certain chat nor not
-        struct SendNotifForChatStruct { int chatID; bool shouldSendNotification; };
-        std::vector<SendNotifForChatStruct> chatInfoVec;
-
-        // The context of accID is needed for several operations later on
-        // (don't exit without unreferencing it!).
-        dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-        // go through m_incomingMsgCache and put only those IDs for which a notification
-        // should be created into messagesToNotify. The vector is of type
-        // IncomingMsgStruct, i.e., contains accID, chatID, msgID
-        std::vector<IncomingMsgStruct> messagesToNotify;
-
-
-        size_t i = 0;
-        size_t endpos = m_incomingMsgCache.size();
-
-        while (i < endpos) {
-            if (m_incomingMsgCache[i].accID != accID) {
-                // cached incoming message does not belong to the account
-                // for which the DC_EVENT_INCOMING_MSG_BUNCH event
-                // was received, so just leave it in the cache
-                ++i;
-                continue;
-            }
-
-            int tempChatID = m_incomingMsgCache[i].chatID;
-
-            // see if we already know whether a notification has to be
-            // sent for this chat or not
-            bool isInChatInfoVec = false;
-
-            // true by default, will be sent to false if any of the
-            // do-not-notify conditions is fulfilled
-            bool needToSendNotif = true;
-
-            for (size_t j = 0; j < chatInfoVec.size(); ++j) {
-                SendNotifForChatStruct tempStruct = chatInfoVec[j];
-                if (tempStruct.chatID == tempChatID) {
-                    isInChatInfoVec = true;
-                    needToSendNotif = tempStruct.shouldSendNotification;
-                    break;
-                }
-            }
-
-            if (!isInChatInfoVec) {
-                // we did not find it in chatInfoVec, obtain the info
-                // whether a notification has to be sent
-                dc_chat_t* tempChat = dc_get_chat(tempCon, tempChatID);
+        // All core lookups are done here, one per chat, before any
+        // DBus call is made. Messages of the same chat are collapsed
+        // into one notification.
+        std::vector<ChatNotification> notifications = buildChatNotifications(accID, m_pendingNotifications.takeAccount(accID));
 
-                // is the chat muted?
-                if (1 == dc_chat_is_muted(tempChat)) {
-                    needToSendNotif = false;
-
-                // or is the chat a contact request, and contact requests
-                // should not be shown?
-                } else if (1 == dc_chat_is_contact_request(tempChat) && !m_notifyContactRequests) {
-                    needToSendNotif = false;
-
-                // or is the user looking at the chat in question?
-                } else if (accID == m_currentAccID && tempChatID == currentChatID && QGuiApplication::applicationState() == Qt::ApplicationActive) {
-                    needToSendNotif = false;
-                }
-
-                // add the info about the chat to chatInfoVec
-                chatInfoVec.push_back(SendNotifForChatStruct {tempChatID, needToSendNotif});
-
-                dc_chat_unref(tempChat);
-            }
-
-            // now needToSendNotif is valid
-            if (needToSendNotif) {
-                messagesToNotify.push_back(IncomingMsgStruct { accID, tempChatID, m_incomingMsgCache[i].msgID });
-            }
-
-            // delete the entry from the cache
-            m_incomingMsgCache.erase(m_incomingMsgCache.begin() + i);
-            --endpos;
-            // do not increase i; this has only to be done if no
-            // item is removed (see the "continue" case above where the accID
-            // of the entry in the cache does not equal the one from the event)
-        }
-
-        dc_context_unref(tempCon);
-
-        // messagesToNotify now contains all messages for which a notification
-        // should be sent. Stop here if there are no messages for which
+        // Stop here if there are no messages for which
         // a notification has to be created.
-        if (messagesToNotify.size() == 0) {
+        if (notifications.size() == 0) {
             continue;
         }
 
@@ -280,19 +163,33 @@ void NotificationsLomiriPostal::finishProcessIncomingMsgBunch(QDBusPendingCallWa
             emit newMessageForInactiveAccount();
         }
 
+        int numberOfNewMessages {0};
+        QStringList chatsOfBurst;
+        for (size_t i = 0; i < notifications.size(); ++i) {
+            numberOfNewMessages += notifications[i].msgCount;
+            chatsOfBurst.append(QString::number(accID) + "_" + QString::number(notifications[i].chatID) + "_");
+        }
+
         // Check how many notifications are already present
         // in the system for this account
 
         int numberOfPresentNotifications {0};
+        // Each detailed notification may contain several messages
+        // of its chat, so for the summary, the messages are
+        // counted instead of the notifications
+        int numberOfPresentMsgs {0};
         QStringList tagsToMaybeDelete;
+        // present notifications of chats in this burst, they
+        // are replaced by the new ones
+        QStringList tagsToReplace;
+
+        QString accNumberString;
+        accNumberString.setNum(accID);
 
         for (int n = 0; n < taglist.size(); ++n) {
             QString tempTag = taglist[n];
             QStringList templist = tempTag.split('_');
 
-            QString accNumberString;
-            accNumberString.setNum(accID);
-
             // if details should not be shown in notifications,
             // there are no separate counts per account, so
             // never skip any present notification if !m_detailedPushNotifications
@@ -305,33 +202,54 @@ void NotificationsLomiriPostal::finishProcessIncomingMsgBunch(QDBusPendingCallWa
 
             if (templist.at(1) == "summary") {
                 numberOfPresentNotifications += templist.at(2).toInt();
+                numberOfPresentMsgs += templist.at(2).toInt();
+            } else if (templist.size() == 3 && chatsOfBurst.contains(templist.at(0) + "_" + templist.at(1) + "_")) {
+                tagsToReplace.append(tempTag);
             } else {
                 ++numberOfPresentNotifications;
+                numberOfPresentMsgs += msgCountOfTag(tempTag);
             }
         }
 
         // Trigger the notification depending on settings
         // and the number of notifications to be generated
         if (m_detailedPushNotifications) {
-            if ((messagesToNotify.size() + numberOfPresentNotifications) > 9) {
-                // don't send out a notification for each message if there 
-                // are more than 9 messages to notify
+            if ((static_cast<int>(notifications.size()) + numberOfPresentNotifications) > 9) {
+                // don't send out a notification for each chat if there 
+                // are more than 9 notifications
                 // First, delete the old notifications
+                for (int o = 0; o < tagsToReplace.size(); ++o) {
+                    numberOfPresentMsgs += msgCountOfTag(tagsToReplace[o]);
+                }
                 for (int o = 0; o < tagsToMaybeDelete.size(); ++o) {
                     removeNotification(tagsToMaybeDelete[o]);
                 }
-                createSummaryNotification(accID, messagesToNotify.size() + numberOfPresentNotifications, true);
+                createSummaryNotification(accID, numberOfNewMessages + numberOfPresentMsgs, true);
             } else {
-                for (size_t l = 0; l < messagesToNotify.size(); ++l) {
-                    IncomingMsgStruct tempStruct = messagesToNotify[l];
-                    createDetailedNotification(tempStruct.accID, tempStruct.chatID, tempStruct.msgID);
+                // the messages of a replaced notification are
+                // added to the new one of the same chat
+                QHash<int, int> replacedMsgsPerChat;
+                for (int o = 0; o < tagsToReplace.size(); ++o) {
+                    replacedMsgsPerChat[tagsToReplace[o].section('_', 1, 1).toInt()] += takeMsgCountOfTag(tagsToReplace[o]);
+                    removeNotification(tagsToReplace[o]);
+                }
+                for (size_t l = 0; l < notifications.size(); ++l) {
+                    int replacedMsgs = replacedMsgsPerChat.value(notifications[l].chatID, 0);
+                    if (replacedMsgs > 0) {
+                        notifications[l].msgCount += replacedMsgs;
+                        composeText(notifications[l]);
+                    }
+                    sendChatNotification(notifications[l]);
                 }
             }
         } else { // if (m_detailedPushNotifications)
+            for (int o = 0; o < tagsToReplace.size(); ++o) {
+                numberOfPresentMsgs += msgCountOfTag(tagsToReplace[o]);
+            }
             for (int o = 0; o < tagsToMaybeDelete.size(); ++o) {
                 removeNotification(tagsToMaybeDelete[o]);
             }
-            createSummaryNotification(0, messagesToNotify.size() + numberOfPresentNotifications, false);
+            createSummaryNotification(0, numberOfNewMessages + numberOfPresentMsgs, false);
         }
     }
 
@@ -339,148 +257,6 @@ void NotificationsLomiriPostal::finishProcessIncomingMsgBunch(QDBusPendingCallWa
 }
 
 
-void NotificationsLomiriPostal::createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar)
-{
-    QString icon;
-    if (showSelfAvatar) {
-        dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-        char* tempText = dc_get_config(tempCon, "selfavatar");
-        icon = tempText;
-        dc_str_unref(tempText);
-    
-        dc_context_unref(tempCon);
-    }
-
-    // use the app icon if the avatar of the account should not be
-    // shown or if no selfavatar is set for the account
-    if (!showSelfAvatar || icon == "") {
-        QFile logoFile(":assets/logo.svg");
-        logoFile.copy(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg");
-        icon = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logo.svg";
-    }
-
-    QString notifTitle;
-    QString notifBody;
-
-    // The correct way would be to have the corresponding plural cases defined 
-    // in the po files and use ngettext like this:
-    //notifTitle = C::ngettext("New message", "New messages", numberOfMessages);
-    //notifBody = QString(C::ngettext("%1 new message", "%1 new messages", numberOfMessages)).arg(numberOfMessages);
-    //
-    // However, in the xml language files from the DC Transifex project, the specifiers are "few", "many",
-    // "other" - how exactly should that be converted to the po files? It doesn't seem to correspond to
-    // the plural cases as in, e.g., Polish => TODO: check and solve correctly
-    //
-    // Here's a preliminary solution that disregards specifics of languages that
-    // have more than one plural form TODO: check whether the preliminary solution works
-    // at least somewhat in the po files, esp for Polish
-    if (numberOfMessages == 1) {
-        notifTitle = C::gettext("New message");
-        notifBody = QString(C::gettext("%1 new message")).arg(numberOfMessages);
-    } else {
-        notifTitle = C::gettext("New messages");
-        notifBody = QString(C::gettext("%1 new messages")).arg(numberOfMessages);
-    }
-
-    QString tagString;
-    tagString.setNum(accID);
-
-    tagString.append("_summary_");
-
-    QString tempNumQStr;
-    tempNumQStr.setNum(numberOfMessages);
-
-    tagString.append(tempNumQStr);
-
-    sendNotification(notifTitle, notifBody, tagString, icon);
-}
-
-
-void NotificationsLomiriPostal::createDetailedNotification(uint32_t accID, int chatID, int msgID)
-{
-    dc_context_t* tempCon = dc_accounts_get_account(m_accountsManager, accID);
-
-    if (!tempCon) {
-        qWarning() << "NotificationsLomiriPostal::createDetailedNotification(): ERROR: tempCon is NULL";
-        return;
-    }
-
-    dc_chat_t* tempChat = dc_get_chat(tempCon, chatID);
-
-    if (!tempChat) {
-        qDebug() << "NotificationsLomiriPostal::createDetailedNotification(): ERROR: tempChat is NULL";
-        dc_context_unref(tempCon);
-        return;
-    }
-
-    QString accNumberString;
-    accNumberString.setNum(accID);
-
-    QString chatNumberString;
-    chatNumberString.setNum(chatID);
-
-    QString msgNumberString;
-    msgNumberString.setNum(msgID);
-
-    dc_msg_t* tempMsg = dc_get_msg(tempCon, msgID);
-    if (!tempMsg) {
-        qWarning() << "NotificationsLomiriPostal::createDetailedNotification(): ERROR: tempMsg is NULL";
-        dc_chat_unref(tempChat);
-        dc_context_unref(tempCon);
-        return;
-    }
-
-    dc_lot_t* tempLot = dc_msg_get_summary(tempMsg, tempChat);
-    if (!tempLot) {
-        qWarning() << "NotificationsLomiriPostal::createDetailedNotification(): ERROR: tempLot is NULL";
-        dc_chat_unref(tempChat);
-        dc_context_unref(tempCon);
-        dc_msg_unref(tempMsg);
-        return;
-    }
-
-
-    QString fromString;
-    char* tempText = dc_msg_get_override_sender_name(tempMsg);
-    if (!tempText) {
-        tempText = dc_contact_get_display_name(dc_get_contact(tempCon, dc_msg_get_from_id(tempMsg)));
-        fromString = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    } else {
-        fromString = "~";
-        fromString += tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
-
-    QString messageExcerpt("?");
-    tempText = dc_lot_get_text2(tempLot);
-    if (tempText) {
-        messageExcerpt = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
-
-    QString icon("");
-
-    tempText = dc_chat_get_profile_image(tempChat);
-    if (tempText) {
-        icon = tempText;
-        dc_str_unref(tempText);
-        tempText = nullptr;
-    }
-
-    sendNotification(fromString, messageExcerpt, accNumberString + "_" + chatNumberString + "_" + msgNumberString, icon);
-
-    dc_msg_unref(tempMsg);
-    dc_chat_unref(tempChat);
-    dc_context_unref(tempCon);
-    dc_lot_unref(tempLot);
-}
-
-
 void NotificationsLomiriPostal::sendNotification(QString summary, QString body, QString tag, QString icon)
 {
     qDebug() << "NotificationsLomiriPostal::sendNotification(): creating notification with tag " << tag;
@@ -551,6 +327,7 @@ void NotificationsLomiriPostal::sendNotification(QString summary, QString body,
 void NotificationsLomiriPostal::removeNotification(QString tag)
 {
     qDebug() << "NotificationsLomiriPostal::removeNotification(): removing tag " << tag;
+    m_msgCountPerTag.remove(tag);
 
     QDBusMessage message;
     message = QDBusMessage::createMethodCall("com.lomiri.Postal", "/com/lomiri/Postal/deltatouch_2elotharketterer", "com.lomiri.Postal", "ClearPersistent");
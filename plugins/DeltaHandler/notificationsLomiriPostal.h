@@ -42,17 +42,12 @@ public:
     void removeActiveNotificationsOfChat(uint32_t accID, int chatID) override;
 
 protected slots:
-    void processIncomingMessage(uint32_t accID, int chatID, int msgID);
     void processIncomingMsgBunch(uint32_t accID);
     void finishProcessIncomingMsgBunch(QDBusPendingCallWatcher* call);
     void finishRemoveSummaryNotification(QDBusPendingCallWatcher* call);
     void finishRemoveActiveNotificationsOfChat(QDBusPendingCallWatcher* call);
 
 protected:
-    // Caching incoming msgs along with their accIDs and chatIDs.
-    // Will then be processed once the incoming msg bunch
-    // event is received.
-    std::vector<IncomingMsgStruct> m_incomingMsgCache;
     std::vector<uint32_t> m_accIDsToProcess;
     bool m_dbusListPersistentReplyPending;
 
@@ -69,9 +64,7 @@ protected:
     bool m_notifTagsToDeletePendingReply;
 
     // protected methods
-    void createDetailedNotification(uint32_t accID, int chatID, int msgID);
-    void createSummaryNotification(uint32_t accID, int numberOfMessages, bool showSelfAvatar);
-    void sendNotification(QString summary, QString body, QString tag, QString icon);
+    void sendNotification(QString summary, QString body, QString tag, QString icon) override;
 };
 
 #endif // NOTIFICATIONSLOMIRIPOSTAL_H
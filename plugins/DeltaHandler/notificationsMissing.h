@@ -37,6 +37,9 @@ public:
     Q_INVOKABLE void removeSummaryNotification(uint32_t accID) override {};
     void removeNotification(QString tag) override {};
     void removeActiveNotificationsOfChat(uint32_t accID, int chatID) override {};
+
+protected:
+    void sendNotification(QString summary, QString body, QString tag, QString icon) override {};
 };
 
 #endif // NOTIFICATIONSMISSING_H
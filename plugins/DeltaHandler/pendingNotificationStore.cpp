@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pendingNotificationStore.h"
+
+
+void PendingNotificationStore::add(uint32_t accID, int chatID, int msgID)
+{
+    AccountBucket &bucket = m_accounts[accID];
+
+    QHash<int, std::vector<int>>::iterator it = bucket.msgsPerChat.find(chatID);
+    if (it == bucket.msgsPerChat.end()) {
+        bucket.chatOrder.push_back(chatID);
+        it = bucket.msgsPerChat.insert(chatID, std::vector<int>());
+    }
+
+    it.value().push_back(msgID);
+}
+
+
+std::vector<PendingChat> PendingNotificationStore::takeAccount(uint32_t accID)
+{
+    std::vector<PendingChat> retval;
+
+    QHash<uint32_t, AccountBucket>::iterator accIt = m_accounts.find(accID);
+    if (accIt == m_accounts.end()) {
+        return retval;
+    }
+
+    AccountBucket &bucket = accIt.value();
+    retval.reserve(bucket.msgsPerChat.size());
+
+    for (size_t i = 0; i < bucket.chatOrder.size(); ++i) {
+        int chatID = bucket.chatOrder[i];
+
+        QHash<int, std::vector<int>>::iterator chatIt = bucket.msgsPerChat.find(chatID);
+        if (chatIt == bucket.msgsPerChat.end()) {
+            // removed via removeChat() or already taken
+            // because the chat was listed twice
+            continue;
+        }
+
+        retval.push_back(PendingChat { chatID, std::vector<int>() });
+        retval.back().msgIDs.swap(chatIt.value());
+
+        bucket.msgsPerChat.erase(chatIt);
+    }
+
+    m_accounts.erase(accIt);
+
+    return retval;
+}
+
+
+void PendingNotificationStore::removeChat(uint32_t accID, int chatID)
+{
+    QHash<uint32_t, AccountBucket>::iterator accIt = m_accounts.find(accID);
+    if (accIt == m_accounts.end()) {
+        return;
+    }
+
+    accIt.value().msgsPerChat.remove(chatID);
+
+    if (accIt.value().msgsPerChat.isEmpty()) {
+        m_accounts.erase(accIt);
+    }
+}
+
+
+void PendingNotificationStore::clear()
+{
+    m_accounts.clear();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PENDINGNOTIFICATIONSTORE_H
+#define PENDINGNOTIFICATIONSTORE_H
+
+#include <QtCore>
+#include <vector>
+
+// The pending messages of one chat, oldest first
+struct PendingChat {
+    int chatID;
+    std::vector<int> msgIDs;
+};
+
+/*
+ * Incoming messages that wait for DC_EVENT_INCOMING_MSG_BUNCH before
+ * notifications are created for them. Bucketed by account and chat,
+ * so adding a message, taking all messages of an account and removing
+ * a chat (e.g., because it has been noticed in the meantime) don't
+ * depend on the number of pending messages of other accounts or chats.
+ */
+class PendingNotificationStore {
+
+public:
+    void add(uint32_t accID, int chatID, int msgID);
+
+    // Removes all messages of the account from the store and returns
+    // them grouped by chat. The chats are ordered by the arrival of
+    // their first pending message.
+    std::vector<PendingChat> takeAccount(uint32_t accID);
+
+    void removeChat(uint32_t accID, int chatID);
+    void clear();
+
+private:
+    struct AccountBucket {
+        // Chats in order of arrival. Removed chats are not erased
+        // from here but skipped in takeAccount(), so a chat may be
+        // listed more than once.
+        std::vector<int> chatOrder;
+        QHash<int, std::vector<int>> msgsPerChat;
+    };
+
+    QHash<uint32_t, AccountBucket> m_accounts;
+};
+
+#endif // PENDINGNOTIFICATIONSTORE_H
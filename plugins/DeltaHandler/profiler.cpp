@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+
+
+std::atomic<bool> Profiler::s_enabled {false};
+
+
+Profiler& Profiler::instance()
+{
+    // thread safe initialization since C++11
+    static Profiler profiler;
+    return profiler;
+}
+
+
+Profiler::Profiler()
+    : m_traceEvents(maxTraceEvents), m_nextTraceEvent {0}, m_traceWrapped {false}
+{
+    m_clock.start();
+}
+
+
+void Profiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+qint64 Profiler::now() const
+{
+    return m_clock.nsecsElapsed() / 1000;
+}
+
+
+void Profiler::recordDuration(const char* name, qint64 start, qint64 duration)
+{
+    int index = bucketIndex(duration);
+
+    QMutexLocker locker(&m_mutex);
+
+    Histogram &histogram = m_histograms[name];
+    ++histogram.count;
+    ++histogram.buckets[index];
+    if (duration > histogram.max) {
+        histogram.max = duration;
+    }
+
+    if (duration >= minTraceDuration) {
+        TraceEvent &event = m_traceEvents[m_nextTraceEvent];
+        event.name = name;
+        event.threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+        event.start = start;
+        event.duration = duration;
+
+        ++m_nextTraceEvent;
+        if (m_nextTraceEvent == maxTraceEvents) {
+            m_nextTraceEvent = 0;
+            m_traceWrapped = true;
+        }
+    }
+}
+
+
+void Profiler::incrementCounter(const char* name, qint64 delta)
+{
+    QMutexLocker locker(&m_mutex);
+    m_counters[name] += delta;
+}
+
+
+QVariantList Profiler::summary() const
+{
+    // The same name can be present with different pointers if
+    // the literal is used in several translation units, so
+    // merge by the actual string
+    QMap<QString, Histogram> histograms;
+    QMap<QString, qint64> counters;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        QHash<const char*, Histogram>::const_iterator it;
+        for (it = m_histograms.constBegin(); it != m_histograms.constEnd(); ++it) {
+            Histogram &merged = histograms[QString(it.key())];
+            merged.count += it.value().count;
+            merged.max = std::max(merged.max, it.value().max);
+            for (int i = 0; i < bucketCount; ++i) {
+                merged.buckets[i] += it.value().buckets[i];
+            }
+        }
+
+        QHash<const char*, qint64>::const_iterator counterIt;
+        for (counterIt = m_counters.constBegin(); counterIt != m_counters.constEnd(); ++counterIt) {
+            counters[QString(counterIt.key())] += counterIt.value();
+        }
+    }
+
+    QVariantList retval;
+
+    QMap<QString, Histogram>::const_iterator it;
+    for (it = histograms.constBegin(); it != histograms.constEnd(); ++it) {
+        QVariantMap entry;
+        entry.insert("name", it.key());
+        entry.insert("count", it.value().count);
+        entry.insert("p50", percentile(it.value(), 0.5) / 1000.0);
+        entry.insert("p99", percentile(it.value(), 0.99) / 1000.0);
+        entry.insert("max", it.value().max / 1000.0);
+        retval.append(entry);
+    }
+
+    QMap<QString, qint64>::const_iterator counterIt;
+    for (counterIt = counters.constBegin(); counterIt != counters.constEnd(); ++counterIt) {
+        QVariantMap entry;
+        entry.insert("name", counterIt.key());
+        entry.insert("value", counterIt.value());
+        retval.append(entry);
+    }
+
+    return retval;
+}
+
+
+QString Profiler::exportChromeTrace() const
+{
+    std::vector<TraceEvent> events;
+    QHash<const char*, qint64> counters;
+    qint64 timestamp = now();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_traceWrapped) {
+            events.assign(m_traceEvents.begin() + m_nextTraceEvent, m_traceEvents.end());
+        }
+        events.insert(events.end(), m_traceEvents.begin(), m_traceEvents.begin() + m_nextTraceEvent);
+        counters = m_counters;
+    }
+
+    QJsonArray traceEvents;
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        QJsonObject obj;
+        obj.insert("name", QString(events[i].name));
+        obj.insert("cat", QString("deltatouch"));
+        obj.insert("ph", QString("X"));
+        obj.insert("ts", static_cast<double>(events[i].start));
+        obj.insert("dur", static_cast<double>(events[i].duration));
+        obj.insert("pid", 1);
+        obj.insert("tid", static_cast<double>(events[i].threadId));
+        traceEvents.append(obj);
+    }
+
+    // counters only as their current value at the end of the trace
+    QHash<const char*, qint64>::const_iterator it;
+    for (it = counters.constBegin(); it != counters.constEnd(); ++it) {
+        QJsonObject args;
+        args.insert("value", static_cast<double>(it.value()));
+
+        QJsonObject obj;
+        obj.insert("name", QString(it.key()));
+        obj.insert("ph", QString("C"));
+        obj.insert("ts", static_cast<double>(timestamp));
+        obj.insert("pid", 1);
+        obj.insert("args", args);
+        traceEvents.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", traceEvents);
+    root.insert("displayTimeUnit", QString("ms"));
+
+    QString filename("deltatouch-trace-");
+    filename.append(QDateTime::currentDateTime().toString("yyyy_MM_dd-hh_mm_ss"));
+    filename.append(".json");
+
+    QFile traceFile(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/" + filename);
+    if (!traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Profiler::exportChromeTrace(): Could not open " << traceFile.fileName();
+        return QString();
+    }
+
+    traceFile.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    traceFile.close();
+
+    return filename;
+}
+
+
+void Profiler::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_histograms.clear();
+    m_counters.clear();
+    m_nextTraceEvent = 0;
+    m_traceWrapped = false;
+}
+
+
+int Profiler::bucketIndex(qint64 duration)
+{
+    if (duration <= 0) {
+        return 0;
+    }
+
+    quint64 value = static_cast<quint64>(duration);
+    int msb = 63 - qCountLeadingZeroBits(value);
+
+    // the two bits below the most significant one
+    int sub;
+    if (msb >= 2) {
+        sub = static_cast<int>((value >> (msb - 2)) & 3);
+    } else {
+        sub = static_cast<int>((value << (2 - msb)) & 3);
+    }
+
+    int index = 1 + msb * 4 + sub;
+    return std::min(index, bucketCount - 1);
+}
+
+
+qint64 Profiler::bucketValue(int index)
+{
+    // inverse of bucketIndex(), returns the lower bound
+    if (index <= 0) {
+        return 0;
+    }
+
+    int msb = (index - 1) / 4;
+    int sub = (index - 1) % 4;
+
+    if (msb >= 2) {
+        return static_cast<qint64>(4 + sub) << (msb - 2);
+    } else {
+        return static_cast<qint64>(4 + sub) >> (2 - msb);
+    }
+}
+
+
+qint64 Profiler::percentile(const Histogram &histogram, double fraction)
+{
+    if (histogram.count == 0) {
+        return 0;
+    }
+
+    qint64 rank = static_cast<qint64>(fraction * histogram.count);
+    if (rank >= histogram.count) {
+        rank = histogram.count - 1;
+    }
+
+    qint64 seen {0};
+    for (int i = 0; i < bucketCount; ++i) {
+        seen += histogram.buckets[i];
+        if (seen > rank) {
+            // the lower bound of the bucket is off by up to 25 %,
+            // but never report more than the actual maximum
+            return std::min(bucketValue(i), histogram.max);
+        }
+    }
+
+    return histogram.max;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QtCore>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Compiled in by default, but recording is switched off at
+// runtime until enabled on the Profiler page, see
+// Profiler::setEnabled(). Define as 0 to compile it out.
+#ifndef DT_ENABLE_PROFILER
+#define DT_ENABLE_PROFILER 1
+#endif
+
+// One completed scope, for the Chrome trace export
+struct TraceEvent {
+    const char* name;
+    quint64 threadId;
+    // both in microseconds, start relative to the start of the profiler
+    qint64 start;
+    qint64 duration;
+};
+
+/*
+ * Collects timings (via ScopedTimer / DT_PROFILE_SCOPE) and counters
+ * (via DT_PROFILE_COUNT) of the hot paths. For each name, a histogram
+ * with logarithmic buckets is kept, so p50/p99 can be shown on the
+ * Profiler page at any time without storing all samples. Additionally,
+ * the most recent scopes are kept as trace events, they can be exported
+ * in the Chrome trace event format (open in chrome://tracing or
+ * ui.perfetto.dev).
+ *
+ * Names have to be string literals, they are stored as pointers.
+ * Thread safe.
+ *
+ * Nothing is recorded while disabled (the default), the only cost
+ * of DT_PROFILE_SCOPE and DT_PROFILE_COUNT is then a relaxed load
+ * of s_enabled.
+ */
+class Profiler {
+
+public:
+    static Profiler& instance();
+
+    static bool isEnabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool enabled);
+
+    // microseconds since start of the profiler
+    qint64 now() const;
+
+    void recordDuration(const char* name, qint64 start, qint64 duration);
+    void incrementCounter(const char* name, qint64 delta = 1);
+
+    // One QVariantMap per name, sorted by name. Timings have the keys
+    // name, count, p50, p99 and max (the latter three in ms), counters
+    // have the keys name and value.
+    QVariantList summary() const;
+
+    // Writes the trace events into a file in the cache dir,
+    // returns the file name (without path) or an empty string
+    // in case of an error
+    QString exportChromeTrace() const;
+
+    void reset();
+
+private:
+    Profiler();
+
+    // Four buckets per power of two, enough for
+    // durations of up to ~12 days in microseconds
+    static constexpr int bucketCount = 1 + 4 * 40;
+    static constexpr size_t maxTraceEvents = 20000;
+    // Shorter scopes only go into the histograms, otherwise
+    // ChatModel::data() would push everything else out of
+    // the trace
+    static constexpr qint64 minTraceDuration = 20;
+
+    struct Histogram {
+        qint64 count {0};
+        qint64 max {0};
+        std::array<quint32, bucketCount> buckets {};
+    };
+
+    static int bucketIndex(qint64 duration);
+    static qint64 bucketValue(int index);
+    static qint64 percentile(const Histogram &histogram, double fraction);
+
+    static std::atomic<bool> s_enabled;
+
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_mutex;
+    QHash<const char*, Histogram> m_histograms;
+    QHash<const char*, qint64> m_counters;
+
+    // ring buffer
+    std::vector<TraceEvent> m_traceEvents;
+    size_t m_nextTraceEvent;
+    bool m_traceWrapped;
+};
+
+// Records the time from construction to destruction. Does nothing
+// if the profiler was disabled at construction.
+class ScopedTimer {
+
+public:
+    explicit ScopedTimer(const char* name)
+        : m_name(name), m_start(Profiler::isEnabled() ? Profiler::instance().now() : -1) {}
+
+    ~ScopedTimer() {
+        if (m_start >= 0) {
+            Profiler &profiler = Profiler::instance();
+            profiler.recordDuration(m_name, m_start, profiler.now() - m_start);
+        }
+    }
+
+private:
+    const char* m_name;
+    // -1 if not recording
+    qint64 m_start;
+};
+
+#if DT_ENABLE_PROFILER
+#define DT_PROFILE_CONCAT_IMPL(a, b) a##b
+#define DT_PROFILE_CONCAT(a, b) DT_PROFILE_CONCAT_IMPL(a, b)
+#define DT_PROFILE_SCOPE(name) ScopedTimer DT_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define DT_PROFILE_COUNT(name) do { if (Profiler::isEnabled()) { Profiler::instance().incrementCounter(name); } } while (0)
+#else
+#define DT_PROFILE_SCOPE(name) do {} while (0)
+#define DT_PROFILE_COUNT(name) do {} while (0)
+#endif
+
+#endif // PROFILER_H
@@ -1457,7 +1457,8 @@ MainView {
 
                 TextField {
                     id: chatlistSearchField
-                    width: parent.width < units.gu(45) ? parent.width - units.gu(4) : units.gu(41)
+                    // leaves room for msgSearchButton
+                    width: (parent.width < units.gu(45) ? parent.width - units.gu(4) : units.gu(41)) - msgSearchButton.width - units.gu(1)
                     anchors {
                         left: parent.left
                         leftMargin: units.gu(2)
@@ -1493,6 +1494,20 @@ MainView {
                     }
                 }
 
+                Button {
+                    id: msgSearchButton
+                    anchors {
+                        left: chatlistSearchField.right
+                        leftMargin: units.gu(1)
+                        verticalCenter: chatlistSearchField.verticalCenter
+                    }
+                    // TODO: string not translated yet
+                    text: i18n.tr("Messages")
+                    visible: chatlistSearchField.visible && DeltaHandler.hasConfiguredAccount
+                    // searches the messages of all chats instead of the chat names
+                    onClicked: extraStack.push(Qt.resolvedUrl('pages/GlobalSearch.qml'), { "initialQuery": chatlistSearchField.displayText })
+                }
+
                 ListItem {
                     id: dividerItem
                     height: divider.height
@@ -1641,45 +1656,33 @@ MainView {
                 ListItem {
                     id: chatListItem
 
-                    //property var thisChatID: model.chatId
-                    property var chatlistEntry: model.chatlistEntry; //JSON.parse(model.chatlistEntry)["result"]["" + thisChatID]
-                    property bool isArchiveLink: chatlistEntry.kind === "ArchiveLink"
+                    property int thisChatID: model.chatId
+                    property bool isArchiveLink: model.isArchiveLink
                     property string chatPicPath: ""
                     property var previewIconSource
                     property bool previewStatusActive
-                    property string avatarInitial
                     property bool mouseHovers: hoverMouse.enabled && hoverMouse.containsMouse
-                    property int thisChatID: (JSON.parse(model.basicChatInfo)).result.id
-
-                    onChatlistEntryChanged: {
-                        isArchiveLink = chatlistEntry.kind === "ArchiveLink"
-                        if (isArchiveLink) {
-                            let chatInfo = JSON.parse(model.basicChatInfo)
-                            setChatPic(chatInfo.result.profileImage)
-                         } else {
-                             setChatPic(chatlistEntry.avatarPath)
-                         }
-
-                         setPreviewStatusIcon()
-                    }
+
+                    // The roles are passed via properties to be able to
+                    // react only if the respective value has actually changed
+                    property string avatarPath: model.avatarPath
+                    property int summaryStatus: model.summaryStatus
+
+                    onAvatarPathChanged: setChatPic(avatarPath)
+                    onSummaryStatusChanged: setPreviewStatusIcon()
 
                     function setChatPic(path) {
-                       if (path != null) {
+                       if (path !== "") {
                            let lengthToSubtract = ("" + StandardPaths.writableLocation(StandardPaths.AppConfigLocation)).length - 6
                            let temp = path.substring(lengthToSubtract)
                            chatPicPath = StandardPaths.locate(StandardPaths.AppConfigLocation, temp)
                        } else {
                            chatPicPath = ""
-                           if (chatlistEntry.name === "") {
-                               avatarInitial = "#"
-                           } else {
-                               avatarInitial = chatlistEntry.name.charAt(0).toUpperCase()
-                           }
                        }
                     }
 
                     function setPreviewStatusIcon() {
-                        let tempstate = DeltaHandler.intToMessageStatus(chatlistEntry.summaryStatus)
+                        let tempstate = DeltaHandler.intToMessageStatus(summaryStatus)
                         switch (tempstate) {
                             case DeltaHandler.StatePending:
                                 if (root.darkmode) {
@@ -1707,17 +1710,7 @@ MainView {
                     }
 
                     Component.onCompleted: {
-                        if (isArchiveLink) {
-                            // does not work, setChatPic is not accessible in the arrow expression
-                            // TODO: why not? how to deal with this?
-                            //JSONRPC.setSendRequest((request) => DeltaHandler.sendJsonrpcRequest(request))
-                            //JSONRPC.client.getBasicChatInfo(model.accountId, thisChatID).then((chatInfo) => { setChatPic(chatInfo.profileImage) })
-                            let chatInfo = JSON.parse(model.basicChatInfo)
-                            setChatPic(chatInfo.result.profileImage)
-                       } else {
-                           setChatPic(chatlistEntry.avatarPath)
-                       }
-
+                       setChatPic(avatarPath)
                        setPreviewStatusIcon()
                     }
 
@@ -1755,11 +1748,11 @@ MainView {
                     }
 
                     leadingActions: isArchiveLink ? null : leadingChatAction
-                    trailingActions: isArchiveLink ? null : (chatlistEntry.isArchived ? trailingChatActionsArchived : trailingChatActions)
+                    trailingActions: isArchiveLink ? null : (model.isArchived ? trailingChatActionsArchived : trailingChatActions)
 
                     ListItemLayout {
                         id: chatlistLayout
-                        title.text: isArchiveLink ? i18n.tr("Archived Chats") : chatlistEntry.name
+                        title.text: isArchiveLink ? i18n.tr("Archived Chats") : model.chatName
 
                         // needed for right-to-left text such as Arabic
                         title.horizontalAlignment: Text.AlignLeft
@@ -1767,7 +1760,7 @@ MainView {
                         title.font.pixelSize: scaledFontSizeInPixels
                         title.color: (thisChatID === root.activeChatId && chatViewIsOpen) ? root.selfMessageSeenTextColor : (mouseHovers ? root.selfMessageSentTextColor : theme.palette.normal.backgroundText)
                         //title.color: (thisChatID === root.activeChatId && chatViewIsOpen) ? theme.palette.normal.focusText : (mouseHovers ? theme.palette.focused.backgroundText : theme.palette.normal.backgroundText)
-                        subtitle.text: isArchiveLink ? null : ((chatlistEntry.summaryText1 === "" ? "" : chatlistEntry.summaryText1 + ": ") + chatlistEntry.summaryText2)
+                        subtitle.text: isArchiveLink ? null : ((model.summaryText1 === "" ? "" : model.summaryText1 + ": ") + model.summaryText2)
                         subtitle.horizontalAlignment: Text.AlignLeft
                         subtitle.font.pixelSize: scaledFontSizeInPixelsSmaller
                         subtitle.color: title.color
@@ -1793,13 +1786,13 @@ MainView {
                             Label {
                                 id: avatarInitialLabel
                                 visible: chatPicPath === ""
-                                text: avatarInitial
+                                text: model.avatarInitial
                                 font.pixelSize: parent.height * 0.6
                                 color: "white"
                                 anchors.centerIn: parent
                             }
 
-                            color: chatlistEntry.color
+                            color: model.chatColor
                             sourceFillMode: LomiriShape.PreserveAspectCrop
                             aspect: LomiriShape.Flat
                         }
@@ -1823,7 +1816,7 @@ MainView {
                                     top: dateAndMsgCount.top
                                 }
                                 source: "../assets/verified.svg"
-                                visible: chatlistEntry.isProtected
+                                visible: model.isProtected
                             }
  
                             Icon {
@@ -1838,7 +1831,7 @@ MainView {
                                 //name: "audio-speakers-muted-symbolic"
                                 source: "qrc:///assets/suru-icons/audio-speakers-muted-symbolic.svg"
                                 color: chatlistLayout.title.color
-                                visible: chatlistEntry.isMuted
+                                visible: model.isMuted
 
                             }
 
@@ -1853,13 +1846,13 @@ MainView {
                                 //name: "pinned"
                                 source: "qrc:///assets/suru-icons/pinned.svg"
                                 color: chatlistLayout.title.color
-                                visible: chatlistEntry.isPinned
+                                visible: model.isPinned
 
                             }
 
                             Label {
                                 id: timestamp
-                                text: isArchiveLink ? "" : (chatlistEntry.lastUpdated !== null ? DeltaHandler.timeToString(chatlistEntry.lastUpdated, true) : "")
+                                text: isArchiveLink ? "" : DeltaHandler.timeToString(model.lastUpdated)
                                 anchors {
                                     right: pinnedIcon.visible ? pinnedIcon.left : dateAndMsgCount.right
                                     rightMargin: pinnedIcon.visible ? units.gu(0.5) : 0
@@ -1880,7 +1873,7 @@ MainView {
 
                             Loader {
                                 id: previewStatusLoader
-                                //active: chatlistEntry.summaryStatus !== DeltaHandler.StateUnknown && !chatlistEntry.isContactRequest && chatlistEntry.freshMessageCounter === 0
+                                //active: model.summaryStatus !== DeltaHandler.StateUnknown && !model.isContactRequest && model.freshMsgCount === 0
                                 active: previewStatusActive
                                 height: timestamp.height
                                 width: height * 2
@@ -1917,7 +1910,7 @@ MainView {
                                 }
                                 color: root.unreadMessageCounterColor
                                 border.color: contactRequestLabel.color
-                                visible: chatlistEntry.isContactRequest
+                                visible: model.isContactRequest
                             } // Rectangle id: contactRequestRect
 
                             LomiriShape {
@@ -1931,9 +1924,9 @@ MainView {
                                     right: dateAndMsgCount.right
                                     //rightMargin: units.gu(1)
                                 }
-                                backgroundColor: chatlistEntry.isMuted ? (root.darkmode ? "#202020" : "#e0e0e0") : root.unreadMessageCounterColor
+                                backgroundColor: model.isMuted ? (root.darkmode ? "#202020" : "#e0e0e0") : root.unreadMessageCounterColor
                                 
-                                visible: !chatlistEntry.isContactRequest && chatlistEntry.freshMessageCounter > 0
+                                visible: !model.isContactRequest && model.freshMsgCount > 0
 
                                 Label {
                                     id: newMsgCountLabel
@@ -1942,10 +1935,10 @@ MainView {
                                         topMargin: units.gu(0.3)
                                         horizontalCenter: newMsgCountShape.horizontalCenter
                                     }
-                                    text: chatlistEntry.freshMessageCounter > 99 ? "99+" : chatlistEntry.freshMessageCounter
+                                    text: model.freshMsgCount > 99 ? "99+" : model.freshMsgCount
                                     fontSize: root.scaledFontSizeSmaller
                                     font.bold: true
-                                    color: chatlistEntry.isMuted && !root.darkmode ? "black" : "white"
+                                    color: model.isMuted && !root.darkmode ? "black" : "white"
                                 }
                             }
                         } // Rectangle id: dateAndMsgCount
@@ -198,6 +198,29 @@ Page {
                 }
             }
 
+            ListItem {
+                height: profilerLayout.height + (divider.visible ? divider.height : 0)
+                width: advancedSettingsPage.width
+
+                ListItemLayout {
+                    id: profilerLayout
+                    // TODO: string not translated yet
+                    title.text: i18n.tr("Profiler")
+                    title.font.bold: true
+
+                    Icon {
+                        //name: "go-next"
+                        source: "qrc:///assets/suru-icons/go-next.svg"
+                        SlotsLayout.position: SlotsLayout.Trailing;
+                        width: units.gu(2)
+                    }
+                }
+
+                onClicked: {
+                    extraStack.push(Qt.resolvedUrl("Profiler.qml"))
+                }
+            }
+
             Rectangle {
                 id: profileSpecificSeparator
                 height: profileSpecificSeparatorLabel.contentHeight + units.gu(4)
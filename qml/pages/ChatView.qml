@@ -334,6 +334,16 @@ Page {
             updateChatData()
         }
 
+        onMessageSendingFailed: {
+            // chatID is from the messageSendingFailed signal
+            if (chatID === chatViewPage.pageChatID) {
+                PopupUtils.open(Qt.resolvedUrl("ErrorMessage.qml"),
+                chatViewPage,
+                // TODO: string not translated yet
+                {"text": i18n.tr("Message could not be sent") , "title": i18n.tr("Error") })
+            }
+        }
+
         onNewChatConfigured: {
             // chatID is from the newChatConfigured signal
             chatViewPage.pageChatID = chatID
@@ -2138,7 +2148,7 @@ Page {
         //cacheBuffer: 0
 
         Component.onCompleted: {
-            if (DeltaHandler.chatmodel.getUnreadMessageBarIndex() > 0) {
+            if (DeltaHandler.chatmodel.getUnreadMessageBarIndex() > 0 || DeltaHandler.chatmodel.hasMsgToJumpTo()) {
                 unreadJumpTimer.start()
             }
         }
@@ -2937,6 +2947,15 @@ Page {
                 }
             } // end Icon id: sendIcon
 
+            // a message of this chat is still being sent, which may
+            // take a while for large attachments
+            ActivityIndicator {
+                id: sendingIndicator
+                anchors.fill: parent
+                running: DeltaHandler.chatmodel.sendingInProgress
+                visible: running
+            }
+
             MouseArea {
                 anchors.fill: parent
                 onClicked: {
@@ -3225,7 +3244,14 @@ Page {
         repeat: false
         triggeredOnStart: false
         onTriggered: {
-            view.positionViewAtIndex(DeltaHandler.chatmodel.getUnreadMessageBarIndex(), ListView.End)
+            // A message to jump to is set if the chat has been
+            // opened from the global search
+            let jumpIndex = DeltaHandler.chatmodel.takeMsgToJumpToIndex()
+            if (jumpIndex >= 0) {
+                messageJump(jumpIndex)
+            } else {
+                view.positionViewAtIndex(DeltaHandler.chatmodel.getUnreadMessageBarIndex(), ListView.End)
+            }
         }
     }
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.12
+import Lomiri.Components 1.3
+
+import DeltaHandler 1.0
+
+// Searches the messages of all chats, see GlobalSearchModel
+// in the C++ part. Opened from the search field of the chatlist.
+Page {
+    id: globalSearchPage
+
+    // text of the chatlist search field when this page was opened
+    property string initialQuery: ""
+
+    function startSearch() {
+        if (searchField.displayText === "") {
+            DeltaHandler.globalsearchmodel.clear()
+        } else {
+            DeltaHandler.globalsearchmodel.search(searchField.displayText, allAccountsSwitch.checked)
+        }
+    }
+
+    Component.onCompleted: {
+        searchField.text = initialQuery
+        searchField.forceActiveFocus()
+    }
+
+    Component.onDestruction: {
+        // stops running searches and releases the contexts
+        DeltaHandler.globalsearchmodel.clear()
+    }
+
+    header: PageHeader {
+        id: header
+        // TODO: string not translated yet
+        title: i18n.tr("Search Messages")
+
+        leadingActionBar.actions: [
+            Action {
+                //iconName: "go-previous"
+                iconSource: "qrc:///assets/suru-icons/go-previous.svg"
+                text: i18n.tr("Back")
+                onTriggered: {
+                    extraStack.pop()
+                }
+            }
+        ]
+    }
+
+    TextField {
+        id: searchField
+        width: parent.width - units.gu(4)
+        anchors {
+            left: parent.left
+            leftMargin: units.gu(2)
+            top: header.bottom
+            topMargin: units.gu(1)
+        }
+        // see chatlistSearchField in Main.qml
+        inputMethodHints: Qt.ImhNoPredictiveText
+        placeholderText: i18n.tr("Search")
+
+        onDisplayTextChanged: {
+            // don't start a search for each typed character
+            searchDelayTimer.restart()
+        }
+
+        onFocusChanged: {
+            if (root.oskViaDbus) {
+                if (focus) {
+                    DeltaHandler.openOskViaDbus()
+                } else {
+                    DeltaHandler.closeOskViaDbus()
+                }
+            }
+        }
+    }
+
+    Timer {
+        id: searchDelayTimer
+        interval: 300
+        repeat: false
+        triggeredOnStart: false
+        onTriggered: startSearch()
+    }
+
+    ListItem {
+        id: allAccountsItem
+        height: allAccountsLayout.height + (divider.visible ? divider.height : 0)
+        width: parent.width
+        anchors {
+            top: searchField.bottom
+            topMargin: units.gu(1)
+        }
+
+        ListItemLayout {
+            id: allAccountsLayout
+            // TODO: string not translated yet
+            title.text: i18n.tr("Search in all profiles")
+
+            ActivityIndicator {
+                id: searchingIndicator
+                SlotsLayout.position: SlotsLayout.Trailing
+                running: DeltaHandler.globalsearchmodel.searching
+                visible: running
+            }
+
+            Switch {
+                id: allAccountsSwitch
+                SlotsLayout.position: SlotsLayout.Last
+                checked: false
+                onCheckedChanged: startSearch()
+            }
+        }
+    }
+
+    Label {
+        id: noResultsLabel
+        anchors {
+            top: allAccountsItem.bottom
+            topMargin: units.gu(2)
+            horizontalCenter: parent.horizontalCenter
+        }
+        // TODO: string not translated yet
+        text: i18n.tr("No messages found")
+        visible: searchField.displayText !== "" && !searchDelayTimer.running && !DeltaHandler.globalsearchmodel.searching && DeltaHandler.globalsearchmodel.resultCount === 0
+    }
+
+    ListView {
+        id: resultView
+        clip: true
+        anchors {
+            top: allAccountsItem.bottom
+            left: parent.left
+            right: parent.right
+            bottom: parent.bottom
+        }
+        model: DeltaHandler.globalsearchmodel
+
+        delegate: ListItem {
+            id: resultItem
+            height: resultLayout.height + (divider.visible ? divider.height : 0)
+            width: resultView.width
+            divider.visible: true
+
+            onClicked: {
+                if (!root.chatOpenAlreadyClicked) {
+                    if (!root.hasTwoColumns) {
+                        root.chatOpenAlreadyClicked = true
+                    }
+                    DeltaHandler.globalsearchmodel.openResult(index)
+                    // The chat is shown in the layout below extraStack.
+                    // Popping has to be done afterwards as the results
+                    // are cleared when this page is destroyed.
+                    extraStack.pop()
+                }
+            }
+
+            ListItemLayout {
+                id: resultLayout
+                // the profile is only of interest if all are searched
+                title.text: allAccountsSwitch.checked ? model.chatName + " (" + model.accountName + ")" : model.chatName
+                title.font.bold: true
+                subtitle.text: model.summary
+                subtitle.maximumLineCount: 2
+                subtitle.wrapMode: Text.WordWrap
+
+                Label {
+                    id: dateLabel
+                    SlotsLayout.position: SlotsLayout.Trailing
+                    text: model.date
+                    fontSize: "small"
+                }
+            }
+        }
+    }
+} // end Page id: globalSearchPage
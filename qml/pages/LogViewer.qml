@@ -39,6 +39,10 @@ Page {
 
     property var fullpath
 
+    // if true, only the recent core events are shown instead of the
+    // log file, see EventLog in the C++ part
+    property bool showCoreEventsOnly: false
+
     function showExportSuccess(exportedPath) {
         // Only for non-Ubuntu Touch platforms
         if (exportedPath === "") {
@@ -101,6 +105,16 @@ Page {
                 text: i18n.tr("Help")
                 onTriggered: update()
             },
+
+            Action {
+                iconSource: showCoreEventsOnly ? "qrc:///assets/suru-icons/view-off.svg" : "qrc:///assets/suru-icons/view-on.svg"
+                // TODO: strings not translated yet
+                text: showCoreEventsOnly ? i18n.tr("Full Log") : i18n.tr("Core Events")
+                onTriggered: {
+                    showCoreEventsOnly = !showCoreEventsOnly
+                    update()
+                }
+            },
             
             Action {
                 //iconName: "save-as"
@@ -129,6 +143,14 @@ Page {
     }
 
     function update() {
+        if (showCoreEventsOnly) {
+            // kept in memory, no need to read the file
+            logViewerPage.currentDateString = new Date().toLocaleString(locale, "yyyy_MM_dd-hh_mm_ss")
+            logText.text = DeltaHandler.getEventLog().replace(/\n/g, "\n\n")
+            scrollView.flickableItem.contentY = scrollView.flickableItem.contentHeight - scrollView.height
+            return
+        }
+
         var xhr = new XMLHttpRequest;
         xhr.open("GET", StandardPaths.locate(StandardPaths.CacheLocation, "/logfile.txt"));
         xhr.onreadystatechange = function() {
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2024  Lothar Ketterer
+ *
+ * This file is part of the app "DeltaTouch".
+ *
+ * DeltaTouch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * DeltaTouch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.12
+import Lomiri.Components 1.3
+import Lomiri.Components.Popups 1.3
+import Qt.labs.platform 1.1
+
+import DeltaHandler 1.0
+
+// Shows the timings collected by the Profiler class in
+// the C++ part. Recording has to be switched on here
+// first, it's off after each start of the app.
+Page {
+    id: profilerPage
+
+    property var summary: []
+
+    property var fullpath
+
+    function update() {
+        summary = DeltaHandler.getProfilerSummary()
+    }
+
+    function formatMs(value) {
+        return value.toFixed(value < 10 ? 2 : 0) + " ms"
+    }
+
+    function showExportSuccess(exportedPath) {
+        // Only for non-Ubuntu Touch platforms
+        if (exportedPath === "") {
+            // error, file was not exported
+            PopupUtils.open(Qt.resolvedUrl("ErrorMessage.qml"),
+            profilerPage,
+            // TODO: string not translated yet
+            {"text": i18n.tr("File could not be saved") , "title": i18n.tr("Error") })
+        } else {
+            PopupUtils.open(Qt.resolvedUrl("InfoPopup.qml"),
+            profilerPage,
+            // TODO: string not translated yet
+            {"text": i18n.tr("Saved file ") + exportedPath })
+        }
+    }
+
+    header: PageHeader {
+        id: header
+        // TODO: string not translated yet
+        title: i18n.tr("Profiler")
+
+        Loader {
+            // Only for non-Ubuntu Touch platforms
+            id: fileExpLoader
+        }
+
+        Connections {
+            // Only for non-Ubuntu Touch platforms
+            target: fileExpLoader.item
+            onFolderSelected: {
+                let exportedPath = DeltaHandler.chatmodel.exportFileToFolder(fullpath, urlOfFolder)
+                showExportSuccess(exportedPath)
+                fileExpLoader.source = ""
+            }
+            onCancelled: {
+                fileExpLoader.source = ""
+            }
+        }
+
+        leadingActionBar.actions: [
+            Action {
+                //iconName: "go-previous"
+                iconSource: "qrc:///assets/suru-icons/go-previous.svg"
+                text: i18n.tr("Back")
+                onTriggered: {
+                    extraStack.pop()
+                }
+            }
+        ]
+
+        trailingActionBar.actions: [
+            Action {
+                iconSource: "qrc:///assets/suru-icons/reload.svg"
+                // TODO: string not translated yet
+                text: i18n.tr("Refresh")
+                onTriggered: update()
+            },
+
+            Action {
+                iconSource: "qrc:///assets/suru-icons/delete.svg"
+                // TODO: string not translated yet
+                text: i18n.tr("Reset")
+                onTriggered: {
+                    DeltaHandler.resetProfiler()
+                    update()
+                }
+            },
+
+            Action {
+                iconSource: "qrc:///assets/suru-icons/save-as.svg"
+                // TODO: string not translated yet
+                text: i18n.tr("Export Trace")
+                onTriggered: {
+                    // The trace is written to the cache dir first, which
+                    // is removed on shutdown, so it has to be exported
+                    // from there like the log in LogViewer.qml
+                    let traceFile = DeltaHandler.exportProfilerTrace()
+                    if (traceFile === "") {
+                        PopupUtils.open(Qt.resolvedUrl("ErrorMessage.qml"),
+                        profilerPage,
+                        // TODO: string not translated yet
+                        { "text": i18n.tr("File could not be saved"), "title": i18n.tr("Error") })
+                        return
+                    }
+
+                    fullpath = StandardPaths.locate(StandardPaths.CacheLocation, traceFile)
+
+                    // different code depending on platform
+                    if (root.onUbuntuTouch) {
+                        extraStack.push(Qt.resolvedUrl("FileExportDialog.qml"), {"url": fullpath, "conType": DeltaHandler.FileType})
+                    } else {
+                        // non-Ubuntu Touch
+                        fileExpLoader.source = "FileExportDialog.qml"
+
+                        // TODO: String not translated yet
+                        fileExpLoader.item.title = i18n.tr("Choose folder to save trace")
+                        fileExpLoader.item.setFileType(DeltaHandler.FileType)
+                        fileExpLoader.item.open()
+                    }
+                }
+            }
+        ]
+    }
+
+    Component.onCompleted: update()
+
+    ListItem {
+        id: recordingItem
+        anchors {
+            top: header.bottom
+            left: parent.left
+            right: parent.right
+        }
+        height: recordingLayout.height + (divider.visible ? divider.height : 0)
+
+        ListItemLayout {
+            id: recordingLayout
+            // TODO: string not translated yet
+            title.text: i18n.tr("Record Timings")
+            title.font.bold: true
+            // TODO: string not translated yet
+            summary.text: i18n.tr("Slightly slows down the app while enabled. Is switched off again when the app is restarted.")
+            summary.wrapMode: Text.WordWrap
+            summary.maximumLineCount: 4
+
+            Switch {
+                id: recordingSwitch
+                SlotsLayout.position: SlotsLayout.Trailing
+                checked: DeltaHandler.profilerIsEnabled()
+                onCheckedChanged: {
+                    if (recordingSwitch.checked != DeltaHandler.profilerIsEnabled()) {
+                        DeltaHandler.setProfilerEnabled(recordingSwitch.checked)
+                    }
+                }
+            }
+        }
+    }
+
+    ListView {
+        id: summaryView
+        anchors {
+            top: recordingItem.bottom
+            left: parent.left
+            right: parent.right
+            bottom: parent.bottom
+        }
+        clip: true
+        model: profilerPage.summary
+
+        delegate: ListItem {
+            height: summaryLayout.height + (divider.visible ? divider.height : 0)
+            width: summaryView.width
+
+            ListItemLayout {
+                id: summaryLayout
+                title.text: modelData.name
+                title.font.bold: true
+                // counters only have name and value
+                // TODO: strings not translated yet
+                subtitle.text: modelData.value !== undefined ? i18n.tr("count: %1").arg(modelData.value)
+                    : i18n.tr("n: %1, p50: %2, p99: %3, max: %4").arg(modelData.count).arg(formatMs(modelData.p50)).arg(formatMs(modelData.p99)).arg(formatMs(modelData.max))
+            }
+        }
+    }
+} // end Page id: profilerPage